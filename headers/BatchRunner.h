@@ -0,0 +1,80 @@
+#ifndef NES_EMULATOR_BATCHRUNNER_H
+#define NES_EMULATOR_BATCHRUNNER_H
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "CPU.h"
+#include "IdleDetector.h"
+#include "Optimizer.h"
+
+// How a batch job ended
+enum class BatchStatus
+{
+    Finished,        // PC reached the end address
+    BudgetExhausted, // Ran its full instruction budget
+    Timeout,         // Ran past its wall-clock limit
+    LoadError,       // Program or data image could not be loaded
+    Halted,          // Ran a HLT
+    Idle             // Stuck in a loop that can never reach a new state (see IdleDetector.h)
+};
+
+// One program run: its own CPU and RAM, loaded from a program and data image
+struct BatchJob
+{
+    std::string name;
+    std::string programPath;
+    std::string dataPath;
+    uint16_t end_address;  // 0 runs to the end of the loaded program
+    uint64_t budget;       // Maximum instructions executed
+    uint64_t timeoutMs;    // Wall-clock limit, 0 for none
+    std::string cacheDir = "";  // Converted images of text programs; empty parses the text every time
+    size_t memorySize = RAM::defaultSize; // Bytes of address space, up to RAM::maxSize
+};
+
+struct BatchResult
+{
+    BatchStatus status;
+    uint64_t instructions;
+    uint64_t precomputed;  // Of those, instructions replayed from a prefix another job of the batch ran
+    uint64_t microseconds;
+    uint16_t PC;
+    uint16_t SP;
+    uint8_t A;
+    uint64_t memoryHash; // FNV-1a of the final RAM contents
+    uint64_t errorCount; // Lines the job wrote to its error log
+    std::string error;   // First error line, if any
+};
+
+// Runs independent CPU/RAM instances on a work-stealing pool. Instances never
+// dump RAM.txt and report errors into their own buffer, so workers share nothing.
+class BatchRunner
+{
+public:
+    static constexpr uint64_t defaultBudget = 1000000;
+    static constexpr uint64_t sliceSize = 65536; // Instructions run between timeout checks
+    static constexpr int statusCount = 6;
+
+    // With optimize, jobs that load the same program and data share its precomputed prefix (see Optimizer.h)
+    BatchRunner(unsigned threadCount, ExecutionEngine engine, bool optimize = false);
+
+    std::vector<BatchResult> run(const std::vector<BatchJob> &jobs) const;
+    static BatchResult runJob(const BatchJob &job, ExecutionEngine engine, PrefixCache *prefixes = nullptr);
+
+    // Manifest lines: "<program> <data> [name=N] [end=A] [budget=N] [timeout=MS] [memory=BYTES]", '#' starts a comment.
+    // A program ending in .sccimg is a binary image and its data may be "-".
+    // Relative paths are resolved against the manifest's directory; missing keys come from defaults
+    static bool parseManifest(const std::string &path, const BatchJob &defaults, std::vector<BatchJob> &jobs, std::string &error);
+    // Aggregate report as JSON
+    static void writeReport(std::ostream &out, const std::vector<BatchJob> &jobs, const std::vector<BatchResult> &results,
+                            unsigned threadCount, double wallSeconds);
+    static const char *statusName(BatchStatus status);
+
+private:
+    unsigned threadCount;
+    ExecutionEngine engine;
+    bool optimize;
+};
+
+#endif // NES_EMULATOR_BATCHRUNNER_H
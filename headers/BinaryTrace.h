@@ -0,0 +1,156 @@
+#ifndef NES_EMULATOR_BINARYTRACE_H
+#define NES_EMULATOR_BINARYTRACE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Binary execution trace behind SCC --trace. Configure with -DEMULATOR_BINARY_TRACE=OFF
+// (EMULATOR_BINARY_TRACE=0) to compile every hook out; otherwise a CPU without a
+// TraceWriter attached pays one null check per instruction and memory access.
+#ifndef EMULATOR_BINARY_TRACE
+#define EMULATOR_BINARY_TRACE 1
+#endif
+
+enum class TraceKind : uint8_t
+{
+    Instruction = 0,  // Fetched and about to execute: value is the opcode, address the operand
+    Read = 1,         // Data or stack byte read by the instruction
+    Write = 2,        // Accepted store
+    RejectedWrite = 3 // Store refused by RAM (code region, or a stack store outside the stack)
+};
+
+// One record per instruction and per memory access. Accesses carry the sequence
+// number of the instruction that made them
+struct TraceRecord
+{
+    uint64_t sequence; // Instructions traced before this one
+    uint16_t pc;
+    uint16_t address;
+    TraceKind kind;
+    uint8_t value;
+    uint8_t A;      // Accumulator before the instruction, or when the access was made
+    uint8_t status; // STATUS before the instruction; 0 for accesses
+};
+
+// Trace files (.scctrace). All fields are little-endian:
+//   header  16 bytes: "SCCT", version, record size, reserved
+//   records 16 bytes each: sequence, pc, address, kind, value, A, status
+namespace TraceFormat
+{
+    constexpr uint32_t MAGIC = 0x54434353; // "SCCT"
+    constexpr uint16_t VERSION = 1;
+    constexpr size_t headerSize = 16;
+    constexpr size_t recordSize = 16;
+
+    void encode(const TraceRecord &record, uint8_t *out);
+    TraceRecord decode(const uint8_t *in);
+}
+
+// Single-producer, single-consumer ring of records. The CPU thread pushes and the
+// writer thread pops; neither takes a lock
+class TraceRing
+{
+public:
+    explicit TraceRing(size_t capacity); // Rounded up to a power of two
+
+    bool tryPush(const TraceRecord &record)
+    {
+        uint64_t head = this->head.load(std::memory_order_relaxed);
+        if (head - cachedTail == slots.size())
+        {
+            cachedTail = tail.load(std::memory_order_acquire);
+            if (head - cachedTail == slots.size())
+                return false;
+        }
+        slots[head & mask] = record;
+        this->head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+    // Move up to max records into out. Returns how many
+    size_t pop(TraceRecord *out, size_t max);
+
+private:
+    std::vector<TraceRecord> slots;
+    uint64_t mask;
+    alignas(64) std::atomic<uint64_t> head; // Next slot the producer fills
+    uint64_t cachedTail;                    // Producer's last view of tail
+    alignas(64) std::atomic<uint64_t> tail; // Next slot the consumer drains
+};
+
+// Streams records to a trace file from a background thread. A full ring makes the
+// producer wait for the writer rather than lose records; getStalls() counts how often
+class TraceWriter
+{
+public:
+    static constexpr bool enabled = EMULATOR_BINARY_TRACE != 0;
+    static constexpr size_t defaultCapacity = 1 << 16;
+
+    TraceWriter();
+    ~TraceWriter();
+    TraceWriter(const TraceWriter &) = delete;
+    TraceWriter &operator=(const TraceWriter &) = delete;
+
+    bool open(const std::string &path, std::string &error, size_t capacity = defaultCapacity);
+    // Write out every record pushed so far and close the file. False if a write failed
+    bool close();
+
+    void instruction(uint16_t pc, uint8_t opcode, uint16_t operand, uint8_t A, uint8_t status)
+    {
+        push(TraceRecord{sequence++, pc, operand, TraceKind::Instruction, opcode, A, status});
+    }
+    void access(TraceKind kind, uint16_t pc, uint16_t address, uint8_t value, uint8_t A)
+    {
+        push(TraceRecord{sequence - 1, pc, address, kind, value, A, 0});
+    }
+
+    uint64_t getRecordCount() const { return records; }
+    uint64_t getStalls() const { return stalls; }
+
+private:
+    void push(const TraceRecord &record)
+    {
+        while (!ring->tryPush(record))
+        {
+            stalls++;
+            std::this_thread::yield();
+        }
+        records++;
+    }
+    void run();
+
+    std::unique_ptr<TraceRing> ring;
+    std::ofstream file;
+    std::thread worker;
+    std::atomic<bool> stopping;
+    std::atomic<bool> failed;
+    uint64_t sequence;
+    uint64_t records;
+    uint64_t stalls;
+};
+
+// Reads a trace file one record at a time
+class TraceReader
+{
+public:
+    bool open(const std::string &path, std::string &error);
+    bool next(TraceRecord &record); // False at the end of the file
+    bool truncated() const { return partial; } // The file ended inside a record
+
+private:
+    std::ifstream file;
+    bool partial = false;
+};
+
+// Decoder output: one line per record, or Chrome/Perfetto trace event JSON in which one
+// instruction is one microsecond. Returns the number of records written
+uint64_t writeTraceText(TraceReader &reader, std::ostream &out, uint64_t limit = UINT64_MAX);
+uint64_t writeChromeTrace(TraceReader &reader, std::ostream &out, uint64_t limit = UINT64_MAX);
+
+#endif // NES_EMULATOR_BINARYTRACE_H
@@ -2,31 +2,91 @@
 #define NES_EMULATOR_6502_H
 
 #include "RAM.h" // Include the header file for RAM
+#include "BinaryTrace.h"
+#include "DecodeCache.h"
+#include "Cache.h"
+#include "Counters.h"
+#include "LazyFlags.h"
+#include "Timing.h"
 #include <bitset>
-class CacheRegister
+#include <memory>
+#include <string>
+
+// Data cache geometry (configure with -DEMULATOR_CACHE_SETS/WAYS/LINE_SIZE).
+// The default of one set with three one-byte ways matches the original three cache registers.
+#ifndef CPU_CACHE_SETS
+#define CPU_CACHE_SETS 1
+#endif
+#ifndef CPU_CACHE_WAYS
+#define CPU_CACHE_WAYS 3
+#endif
+#ifndef CPU_CACHE_LINE_SIZE
+#define CPU_CACHE_LINE_SIZE 1
+#endif
+
+using DataCache = SetAssociativeCache<CPU_CACHE_SETS, CPU_CACHE_WAYS, CPU_CACHE_LINE_SIZE>;
+
+// Interpreter core used by process_instructions
+enum class ExecutionEngine
 {
-public:
-    uint16_t location; // Memory location stored in the cache register
-    uint8_t value;     // Value at the memory location stored in the cache register
+    Reference, // Fetch three bytes and switch on the opcode every step
+    Decoded,   // Run from the pre-decoded instruction cache
+    Threaded,  // Pre-decoded cache with direct-threaded (computed goto) dispatch
+    Jit        // Basic blocks compiled to x86-64 (Jit.h); threaded dispatch elsewhere
+};
+
+// Parses "reference", "decoded", "threaded" or "jit"
+bool parseEngine(const std::string &name, ExecutionEngine &engine);
 
-    CacheRegister() : location(0), value(0) {} // Default constructor
+class UndoJournal;
+class JitCompiler;
+
+// Register file and data cache, as captured by CPU::snapshot
+struct CPUSnapshot
+{
+    uint16_t PC;
+    uint16_t SP;
+    uint8_t A;
+    uint8_t STATUS;
+    DataCache cache;
 };
 
 class CPU
 {
 public:
-CacheRegister cache[3];
+    DataCache cache;
+    ExecutionEngine engine;
+    DecodeCache decoded;
+    UndoJournal *journal; // When set, every instruction is journaled for reverse execution (reference path only)
+    TimingModel *timing;  // When set in a build with EMULATOR_TIMING, every instruction is timed (reference path only)
+    FusionProfile *fusionProfile; // When set, fall-through instruction pairs are counted (reference path only)
+    TraceWriter *tracer;  // When set, every instruction and data access is recorded (the JIT engine runs threaded)
     uint16_t PC;    // 16-bit Program Counter
     uint16_t SP;    // 8-bit Stack Pointer
     uint8_t A;      // 8-bit Accumulator
     uint8_t STATUS; // Status flag register. Status flags are in order (-)(C)(Z)(I)(D)(B)(O)(N)
+    LazyFlags flags; // C, Z, O and N set since STATUS was last written; read STATUS through getStatus()
+
+    uint8_t getStatus() const { return flags.apply(STATUS); }
+    void setStatus(uint8_t value)
+    {
+        STATUS = value;
+        flags.clear();
+    }
+
+    // B (bit 2) is the halt flag: HLT (opcode 0b1000) sets it, and run() executes nothing
+    // while it is set. Clear it to resume after the HLT
+    static constexpr uint8_t haltFlag = 0x04;
+    bool isHalted() const { return (STATUS & haltFlag) != 0; }
 
     CPU();
     ~CPU();
 
     void executeInstruction(RAM &ram, uint8_t opcode, uint16_t address);
+    void traceFetch(uint8_t opcode, uint16_t address);
+    void traceExecute(uint16_t address);
     void updateCache(uint16_t location, uint8_t value);
-    uint8_t getCachedValue(uint16_t location);
+    bool getCachedValue(uint16_t location, uint8_t &value); // False on a cache miss
 
     void ADC(RAM &ram, uint16_t address);
     void SBC(RAM &ram, uint16_t address);
@@ -36,8 +96,64 @@ CacheRegister cache[3];
     void JMP(RAM &ram, uint16_t address);
     void PSH(RAM &ram);
     void POP(RAM &ram);
+    void HLT();
+    void NOP(uint8_t opcode);
     void process_instructions(RAM &ram, uint16_t start_address, uint16_t end_address);
+    // Execute from PC until PC reaches end_address, a HLT runs or budget instructions have run. Returns the number executed
+    uint64_t run(RAM &ram, uint16_t end_address, uint64_t budget);
+    void step(RAM &ram); // Fetch, execute and advance past the instruction at PC
+    uint64_t run_decoded(RAM &ram, uint16_t end_address, uint64_t budget);
+    uint64_t run_threaded(RAM &ram, uint16_t end_address, uint64_t budget);
+    uint64_t run_jit(RAM &ram, uint16_t end_address, uint64_t budget);
+
+    CPUSnapshot snapshot() const { return CPUSnapshot{PC, SP, A, getStatus(), cache}; }
+    void restore(const CPUSnapshot &snapshot);
+
+    // Counters since construction or the last reset (see Counters.h)
+    CPUCounters getCounters() const { return counters; } // Snapshot
+    void resetCounters() { counters = CPUCounters{}; }
+    void writeCountersJson(std::ostream &out) const { counters.writeJson(out); }
     // Add more methods as needed
+
+private:
+    void countOpcode(uint8_t opcode)
+    {
+        if constexpr (CPUCounters::enabled)
+            counters.executed[DecodeCache::opcodeIndex(opcode)]++;
+    }
+    uint8_t readMemory(RAM &ram, uint16_t address)
+    {
+        if constexpr (CPUCounters::enabled)
+            counters.reads[static_cast<int>(regionOf(address))]++;
+        return ram.readByte(address);
+    }
+    // Stores made by instructions: journaled and counted
+    void storeData(RAM &ram, uint16_t address, uint8_t value);
+    void storeStack(RAM &ram, uint16_t address, uint8_t value);
+    void traceAccess(TraceKind kind, uint16_t address, uint8_t value)
+    {
+        if constexpr (TraceWriter::enabled)
+        {
+            if (tracer != nullptr)
+                tracer->access(kind, PC, address, value, A);
+        }
+    }
+    void countWrite(uint16_t address, bool accepted)
+    {
+        if constexpr (CPUCounters::enabled)
+        {
+            if (accepted)
+                counters.writes[static_cast<int>(regionOf(address))]++;
+            else
+                counters.rejectedWrites++;
+        }
+    }
+
+    // True when every cached byte is a data-region byte equal to RAM, so reading RAM directly gives the same values
+    bool cacheMatchesRAM(const RAM &ram) const;
+
+    CPUCounters counters;
+    std::unique_ptr<JitCompiler> jit; // Created on the first run_jit
 };
 
 #endif // NES_EMULATOR_6502_H
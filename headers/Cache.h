@@ -0,0 +1,370 @@
+#ifndef NES_EMULATOR_CACHE_H
+#define NES_EMULATOR_CACHE_H
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define SCC_CACHE_SSE2 1
+#else
+#define SCC_CACHE_SSE2 0
+#endif
+
+// Which way of a full set gets evicted
+enum class ReplacementPolicy
+{
+    LRU,      // Least recently used
+    FIFO,     // Oldest fill
+    Random,   // Pseudo-random way
+    PseudoLRU // Bit-PLRU: one MRU bit per way, cleared once every way is marked
+};
+
+// Parses "lru", "fifo", "random" or "plru"
+inline bool parseReplacementPolicy(const std::string &name, ReplacementPolicy &policy)
+{
+    if (name == "lru")
+        policy = ReplacementPolicy::LRU;
+    else if (name == "fifo")
+        policy = ReplacementPolicy::FIFO;
+    else if (name == "random")
+        policy = ReplacementPolicy::Random;
+    else if (name == "plru")
+        policy = ReplacementPolicy::PseudoLRU;
+    else
+        return false;
+    return true;
+}
+
+struct CacheStats
+{
+    uint64_t hits;
+    uint64_t misses;
+};
+
+// Set-associative byte cache. Every line keeps a tag, a valid bit and a per-byte
+// valid mask, so a line can be allocated from a single byte store without a fill
+// from RAM. Wide sets (8+ ways) compare all tags with SSE2 when it is available.
+template <size_t Sets, size_t Ways, size_t LineSize>
+class SetAssociativeCache
+{
+    static_assert(Sets > 0 && (Sets & (Sets - 1)) == 0, "Sets must be a power of two");
+    static_assert(LineSize > 0 && LineSize <= 64 && (LineSize & (LineSize - 1)) == 0, "LineSize must be a power of two up to 64");
+    static_assert(Ways > 0 && Ways <= 64, "Ways must be between 1 and 64");
+
+public:
+    static constexpr size_t sets = Sets;
+    static constexpr size_t ways = Ways;
+    static constexpr size_t lineSize = LineSize;
+
+    explicit SetAssociativeCache(ReplacementPolicy policy = ReplacementPolicy::LRU)
+        : policy(policy), clock(0), randomState(0x2545F491), stats{0, 0}
+    {
+        clear();
+    }
+
+    // Returns true and the cached byte on a hit
+    bool lookup(uint16_t address, uint8_t &value)
+    {
+        Set &set = sets_[setIndex(address)];
+        int way = findWay(set, tagOf(address));
+        if (way >= 0 && (set.byteValid[way] >> offsetOf(address) & 1))
+        {
+            touch(set, way, false);
+            value = set.data[way][offsetOf(address)];
+            stats.hits++;
+            return true;
+        }
+        stats.misses++;
+        return false;
+    }
+
+    // Write-allocate: store the byte, claiming a line for it on a miss
+    void update(uint16_t address, uint8_t value)
+    {
+        uint16_t evicted;
+        store<false>(address, value, evicted);
+    }
+
+    // update, reporting whether claiming the line evicted another and that line's first address
+    bool updateEvicting(uint16_t address, uint8_t value, uint16_t &evicted)
+    {
+        return store<true>(address, value, evicted);
+    }
+
+    // Everything one access to address can change: the way it hits or would claim, that
+    // way's line, its set's masks and the replacement state. Taken before the access and
+    // put back by restoreLine, it undoes the access exactly
+    struct LineState
+    {
+        uint16_t address;
+        uint8_t way;
+        uint16_t tag;
+        uint64_t validWays;
+        uint64_t mruBits;
+        uint64_t byteValid;
+        uint64_t stamp;
+        uint64_t clock;
+        uint32_t randomState;
+        uint8_t data[LineSize];
+    };
+
+    LineState saveLine(uint16_t address) const
+    {
+        const Set &set = sets_[setIndex(address)];
+        int way = findWay(set, tagOf(address));
+        if (way < 0)
+        {
+            uint32_t random = randomState;
+            way = chooseVictim(set, random);
+        }
+        LineState state{address, static_cast<uint8_t>(way), set.tags[way], set.validWays, set.mruBits, set.byteValid[way],
+                        set.stamp[way], clock, randomState, {}};
+        std::copy(std::begin(set.data[way]), std::end(set.data[way]), state.data);
+        return state;
+    }
+
+    void restoreLine(const LineState &state)
+    {
+        Set &set = sets_[setIndex(state.address)];
+        set.tags[state.way] = state.tag;
+        set.validWays = state.validWays;
+        set.mruBits = state.mruBits;
+        set.byteValid[state.way] = state.byteValid;
+        set.stamp[state.way] = state.stamp;
+        std::copy(std::begin(state.data), std::end(state.data), set.data[state.way]);
+        clock = state.clock;
+        randomState = state.randomState;
+    }
+
+    void invalidate(uint16_t address)
+    {
+        Set &set = sets_[setIndex(address)];
+        int way = findWay(set, tagOf(address));
+        if (way >= 0)
+        {
+            set.validWays &= ~(uint64_t(1) << way);
+        }
+    }
+
+    void clear()
+    {
+        for (Set &set : sets_)
+        {
+            set = Set{};
+        }
+    }
+
+    ReplacementPolicy getPolicy() const { return policy; }
+    void setPolicy(ReplacementPolicy newPolicy)
+    {
+        policy = newPolicy;
+        clear();
+    }
+
+    const CacheStats &getStats() const { return stats; }
+    void resetStats() { stats = CacheStats{0, 0}; }
+
+    // True if the byte at address is cached (no statistics or replacement side effects)
+    bool contains(uint16_t address) const
+    {
+        const Set &set = sets_[setIndex(address)];
+        int way = findWay(set, tagOf(address));
+        return way >= 0 && (set.byteValid[way] >> offsetOf(address) & 1);
+    }
+
+    // Calls visit(address, value) for every cached byte
+    template <typename Visitor>
+    void forEachValid(Visitor visit) const
+    {
+        for (size_t index = 0; index < Sets; index++)
+        {
+            const Set &set = sets_[index];
+            for (size_t way = 0; way < Ways; way++)
+            {
+                if ((set.validWays >> way & 1) == 0)
+                {
+                    continue;
+                }
+                for (size_t offset = 0; offset < LineSize; offset++)
+                {
+                    if (set.byteValid[way] >> offset & 1)
+                    {
+                        visit(static_cast<uint32_t>((set.tags[way] * Sets + index) * LineSize + offset), set.data[way][offset]);
+                    }
+                }
+            }
+        }
+    }
+
+private:
+    // Tag array padded to whole SSE2 vectors; padding ways are never valid
+    static constexpr size_t paddedWays = (Ways + 7) / 8 * 8;
+
+    struct Set
+    {
+        alignas(16) uint16_t tags[paddedWays];
+        uint64_t validWays;       // Bit per way
+        uint64_t mruBits;         // PseudoLRU state
+        uint64_t byteValid[Ways]; // Bit per byte of each line
+        uint64_t stamp[Ways];     // Last use (LRU) or fill time (FIFO)
+        uint8_t data[Ways][LineSize];
+    };
+
+    static constexpr size_t setIndex(uint16_t address) { return (address / LineSize) & (Sets - 1); }
+    static constexpr size_t offsetOf(uint16_t address) { return address & (LineSize - 1); }
+    static constexpr uint16_t tagOf(uint16_t address) { return static_cast<uint16_t>(address / LineSize / Sets); }
+
+    static int findWay(const Set &set, uint16_t tag)
+    {
+#if SCC_CACHE_SSE2
+        if constexpr (Ways >= 8)
+        {
+            const __m128i needle = _mm_set1_epi16(static_cast<short>(tag));
+            for (size_t base = 0; base < paddedWays; base += 8)
+            {
+                __m128i tags = _mm_load_si128(reinterpret_cast<const __m128i *>(set.tags + base));
+                // Narrow the eight 16-bit lane masks to bytes so movemask yields one bit per way
+                __m128i equal = _mm_packs_epi16(_mm_cmpeq_epi16(tags, needle), _mm_setzero_si128());
+                uint64_t matches = static_cast<uint64_t>(_mm_movemask_epi8(equal) & 0xFF) << base & set.validWays;
+                if (matches != 0)
+                {
+                    return std::countr_zero(matches);
+                }
+            }
+            return -1;
+        }
+#endif
+        for (size_t way = 0; way < Ways; way++)
+        {
+            if ((set.validWays >> way & 1) && set.tags[way] == tag)
+            {
+                return static_cast<int>(way);
+            }
+        }
+        return -1;
+    }
+
+    template <bool Report>
+    bool store(uint16_t address, uint8_t value, uint16_t &evicted)
+    {
+        const size_t index = setIndex(address);
+        Set &set = sets_[index];
+        uint16_t tag = tagOf(address);
+        int way = findWay(set, tag);
+        bool replaced = false;
+        if (way < 0)
+        {
+            way = victim(set);
+            if constexpr (Report)
+            {
+                if (set.validWays >> way & 1)
+                {
+                    evicted = static_cast<uint16_t>((set.tags[way] * Sets + index) * LineSize);
+                    replaced = true;
+                }
+            }
+            set.tags[way] = tag;
+            set.validWays |= uint64_t(1) << way;
+            set.byteValid[way] = 0;
+            touch(set, way, true);
+        }
+        else
+        {
+            touch(set, way, false);
+        }
+        set.data[way][offsetOf(address)] = value;
+        set.byteValid[way] |= uint64_t(1) << offsetOf(address);
+        return replaced;
+    }
+
+    void touch(Set &set, int way, bool filled)
+    {
+        switch (policy)
+        {
+        case ReplacementPolicy::LRU:
+            set.stamp[way] = ++clock;
+            break;
+        case ReplacementPolicy::FIFO:
+            if (filled)
+            {
+                set.stamp[way] = ++clock;
+            }
+            break;
+        case ReplacementPolicy::PseudoLRU:
+        {
+            const uint64_t allWays = Ways == 64 ? ~uint64_t(0) : (uint64_t(1) << Ways) - 1;
+            set.mruBits |= uint64_t(1) << way;
+            if ((set.mruBits & allWays) == allWays)
+            {
+                set.mruBits = uint64_t(1) << way;
+            }
+            break;
+        }
+        case ReplacementPolicy::Random:
+            break;
+        }
+    }
+
+    int victim(const Set &set)
+    {
+        return chooseVictim(set, randomState);
+    }
+
+    // The way a miss in set claims; random is the Random policy's generator state
+    int chooseVictim(const Set &set, uint32_t &random) const
+    {
+        // Fill empty ways first
+        for (size_t way = 0; way < Ways; way++)
+        {
+            if ((set.validWays >> way & 1) == 0)
+            {
+                return static_cast<int>(way);
+            }
+        }
+
+        switch (policy)
+        {
+        case ReplacementPolicy::Random:
+        {
+            random ^= random << 13;
+            random ^= random >> 17;
+            random ^= random << 5;
+            return static_cast<int>(random % Ways);
+        }
+        case ReplacementPolicy::PseudoLRU:
+            for (size_t way = 0; way < Ways; way++)
+            {
+                if ((set.mruBits >> way & 1) == 0)
+                {
+                    return static_cast<int>(way);
+                }
+            }
+            return 0;
+        default:
+        {
+            // LRU and FIFO both evict the smallest stamp
+            size_t oldest = 0;
+            for (size_t way = 1; way < Ways; way++)
+            {
+                if (set.stamp[way] < set.stamp[oldest])
+                {
+                    oldest = way;
+                }
+            }
+            return static_cast<int>(oldest);
+        }
+        }
+    }
+
+    Set sets_[Sets];
+    ReplacementPolicy policy;
+    uint64_t clock;
+    uint32_t randomState;
+    CacheStats stats;
+};
+
+#endif // NES_EMULATOR_CACHE_H
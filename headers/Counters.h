@@ -0,0 +1,50 @@
+#ifndef NES_EMULATOR_COUNTERS_H
+#define NES_EMULATOR_COUNTERS_H
+
+#include <cstdint>
+#include <iostream>
+
+// Execution counters. Configure with -DEMULATOR_COUNTERS=OFF (EMULATOR_COUNTERS=0)
+// to compile every increment out of the interpreter.
+#ifndef EMULATOR_COUNTERS
+#define EMULATOR_COUNTERS 1
+#endif
+
+// RAM regions, as enforced by the RAM write functions
+enum class MemoryRegion
+{
+    Instruction = 0, // 0x000-0x0FF
+    Stack = 1,       // 0x100-0x1FF
+    Data = 2         // 0x200 and up
+};
+
+inline MemoryRegion regionOf(uint16_t address)
+{
+    return address < 0x100 ? MemoryRegion::Instruction : address < 0x200 ? MemoryRegion::Stack : MemoryRegion::Data;
+}
+
+// What the CPU did since the last reset. RAM traffic counts the accesses the CPU
+// issues: the decoded and threaded engines fetch from the decode cache, so they
+// report fewer instruction-region reads than the reference engine.
+struct CPUCounters
+{
+    static constexpr bool enabled = EMULATOR_COUNTERS != 0;
+    static constexpr int opcodeSlots = 10; // ADC..POP, HLT, then every unsupported opcode
+    static constexpr int regionCount = 3;
+
+    uint64_t executed[opcodeSlots];
+    uint64_t cacheHits;
+    uint64_t cacheMisses;
+    uint64_t cacheUpdates;
+    uint64_t reads[regionCount];
+    uint64_t writes[regionCount]; // Accepted writes
+    uint64_t rejectedWrites;      // Writes RAM refused (wrong region or out of range)
+
+    uint64_t instructions() const;
+    void writeJson(std::ostream &out) const;
+
+    static const char *opcodeName(int slot);
+    static const char *regionName(MemoryRegion region);
+};
+
+#endif // NES_EMULATOR_COUNTERS_H
@@ -0,0 +1,78 @@
+#ifndef NES_EMULATOR_DECODECACHE_H
+#define NES_EMULATOR_DECODECACHE_H
+
+#include "Fusion.h"
+#include <cstdint>
+
+class CPU;
+class RAM;
+
+// One pre-decoded instruction of the program region
+struct DecodedInstruction
+{
+    using Handler = void (*)(CPU &cpu, RAM &ram, const DecodedInstruction &instruction);
+
+    Handler handler;      // nullptr until the instruction has been decoded
+    Handler pairHandler;  // Runs this instruction and the next as a fused pair, or nullptr
+    const void *target;   // Threaded-dispatch jump target (of the pair, if fused), set when decoded for CPU::run_threaded
+    uint16_t operand;     // 16-bit address operand
+    uint16_t nextOperand; // The next instruction's, when fused
+    uint8_t opcode;
+    uint8_t nextOpcode;
+    int8_t fused;         // Index in SCC_FUSED_PAIRS, or -1
+};
+
+// Decodes the instruction space (0x000-0x0FF) once into {handler, operand}
+// records. Writes through RAM::writeInstructionByte only invalidate the
+// entries that overlap the written byte, or the byte of a pair fused onto them.
+// An entry whose instruction and the next form a pair the fusion table allows
+// carries both, so the engines can run the two in one dispatch.
+class DecodeCache
+{
+public:
+    static constexpr uint16_t programSize = 0x100;
+    static constexpr uint8_t opcodeCount = 10; // ADC..POP, HLT, plus the unsupported-opcode NOP
+    static constexpr int targetCount = opcodeCount + fusedPairCount; // Threaded targets: one per opcode, then per fused pair
+
+    DecodeCache();
+
+    // Drop entries for code written to ram since the last call
+    void synchronize(const RAM &ram);
+    // Decoded instruction at pc, or nullptr if pc is outside the cacheable program region.
+    // With a targets table (indexed by opcodeIndex, then opcodeCount + fused pair) the entry's threaded-dispatch
+    // target is filled in too.
+    const DecodedInstruction *lookup(const RAM &ram, uint16_t pc, const void *const *targets = nullptr)
+    {
+        // Instructions straddling into stack space can change under us, so they are not cached
+        if (pc > programSize - 3)
+        {
+            return nullptr;
+        }
+        const DecodedInstruction &entry = entries[pc];
+        if (entry.handler == nullptr || (targets != nullptr && entry.target == nullptr))
+        {
+            decode(ram, pc, targets);
+        }
+        return &entry;
+    }
+    void invalidate(uint16_t address);
+    void invalidateAll();
+
+    // Pairs to fuse from now on (default FusionTable::all()). Drops every entry
+    void setFusion(const FusionTable &table);
+    const FusionTable &getFusion() const { return fusion; }
+
+    static DecodedInstruction::Handler handlerFor(uint8_t opcode);
+    static DecodedInstruction::Handler pairHandlerFor(int pair);
+    static uint8_t opcodeIndex(uint8_t opcode) { return opcode < opcodeCount - 1 ? opcode : opcodeCount - 1; }
+
+private:
+    void decode(const RAM &ram, uint16_t pc, const void *const *targets);
+
+    DecodedInstruction entries[programSize];
+    FusionTable fusion;
+    uint64_t ramId;           // RAM the entries were decoded from
+    uint64_t seenCodeWrites;  // RAM::getCodeWriteCount() at the last synchronize
+};
+
+#endif // NES_EMULATOR_DECODECACHE_H
@@ -3,10 +3,15 @@
 
 #pragma once
 
+#include <cstdlib>
 #include <iostream>
 #include <fstream>
 #include <string>
 #include <bitset>
 #include <sstream>
 #include "CPU.h"
+#include "IdleDetector.h"
+#include "Loader.h"
+#include "MultiCore.h"
+#include "Translator.h"
 // TODO: Reference additional headers your program requires here.
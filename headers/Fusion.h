@@ -0,0 +1,83 @@
+#ifndef NES_EMULATOR_FUSION_H
+#define NES_EMULATOR_FUSION_H
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+
+// Adjacent instruction pairs with a fused handler, which runs both in one dispatch.
+// Picked from FusionProfiles of the shipped program and the benchmark mixes; HLT,
+// JMP and unsupported opcodes never come first, so the pair always runs to its end.
+#define SCC_FUSED_PAIRS(X)                                                                          \
+    X(LDA, ADC) X(LDA, AND) X(LDA, LDA) X(ADC, SBC) X(SBC, ADC) X(SBC, AND) X(AND, EOR) X(EOR, ADC) \
+    X(ADC, JMP) X(SBC, JMP) X(PSH, PSH) X(PSH, POP) X(POP, POP) X(POP, PSH)
+
+namespace opcodes
+{
+    constexpr uint8_t ADC = 0b0000;
+    constexpr uint8_t SBC = 0b0001;
+    constexpr uint8_t LDA = 0b0010;
+    constexpr uint8_t AND = 0b0011;
+    constexpr uint8_t EOR = 0b0100;
+    constexpr uint8_t JMP = 0b0101;
+    constexpr uint8_t PSH = 0b0110;
+    constexpr uint8_t POP = 0b0111;
+    constexpr uint8_t HLT = 0b1000;
+}
+
+#define SCC_FUSED_COUNT(first, second) +1
+constexpr int fusedPairCount = 0 SCC_FUSED_PAIRS(SCC_FUSED_COUNT);
+#undef SCC_FUSED_COUNT
+
+// Index of the fused pair (first, second) in SCC_FUSED_PAIRS, or -1 if it has none
+int fusedPairIndex(uint8_t first, uint8_t second);
+
+// Fall-through instruction pairs seen while running: pairs[a][b] counts an instruction
+// in opcode slot b (see CPUCounters) executed straight after the one 3 bytes before it,
+// in slot a. Jumps are not pairs. Collected by the reference loop while attached to
+// CPU::fusionProfile
+struct FusionProfile
+{
+    static constexpr int slots = 10;
+
+    uint64_t pairs[slots][slots];
+    uint16_t lastPC;
+    uint8_t lastSlot;
+    bool hasLast;
+
+    void record(uint16_t pc, uint8_t opcode)
+    {
+        uint8_t slot = opcode < slots - 1 ? opcode : slots - 1;
+        if (hasLast && pc == static_cast<uint16_t>(lastPC + 3))
+            pairs[lastSlot][slot]++;
+        lastPC = pc;
+        lastSlot = slot;
+        hasLast = true;
+    }
+    uint64_t total() const;
+
+    // One "FIRST SECOND count" line per pair seen, most frequent first
+    void write(std::ostream &out) const;
+    // Adds the counts of a profile written by write(). False (with error set) on a malformed line
+    bool read(std::istream &in, std::string &error);
+};
+
+// The fused pairs a DecodeCache forms
+class FusionTable
+{
+public:
+    static FusionTable all() { return FusionTable((1u << fusedPairCount) - 1); }
+    static FusionTable none() { return FusionTable(0); }
+    // The fused pairs making up at least minShare of the pairs in profile
+    static FusionTable fromProfile(const FusionProfile &profile, double minShare = 0.01);
+
+    bool allows(int pair) const { return pair >= 0 && (mask >> pair & 1) != 0; }
+    uint32_t getMask() const { return mask; }
+
+private:
+    explicit FusionTable(uint32_t mask) : mask(mask) {}
+
+    uint32_t mask;
+};
+
+#endif // NES_EMULATOR_FUSION_H
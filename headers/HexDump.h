@@ -0,0 +1,24 @@
+#ifndef NES_EMULATOR_HEXDUMP_H
+#define NES_EMULATOR_HEXDUMP_H
+
+#include <cstddef>
+#include <cstdint>
+
+// Renders RAM.txt lines: "Address 0x0240: " then every byte as two hex digits and a
+// space, "| ", the bytes as printable ASCII ('.' otherwise) and a newline. Every line
+// has the same length, so a dump is one preallocated buffer written in place.
+// Full lines are converted 16 bytes at a time with SSSE3 nibble lookups when the host
+// has them (checked once at run time); other hosts use a table-driven scalar loop.
+class HexDump
+{
+public:
+    static constexpr size_t bytesPerLine = 64;
+    static constexpr size_t lineLength = 16 + bytesPerLine * 3 + 2 + bytesPerLine + 1;
+
+    // Writes exactly lineLength chars to out. Bytes past count are shown as blanks
+    static void formatLine(uint16_t address, const uint8_t *bytes, size_t count, char *out);
+
+    static const char *implementation(); // "ssse3" or "scalar"
+};
+
+#endif // NES_EMULATOR_HEXDUMP_H
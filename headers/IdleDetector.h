@@ -0,0 +1,71 @@
+#ifndef NES_EMULATOR_IDLEDETECTOR_H
+#define NES_EMULATOR_IDLEDETECTOR_H
+
+#include <cstdint>
+
+class CPU;
+class RAM;
+
+// Why runUntilHalt returned
+enum class RunOutcome
+{
+    Halted,         // A HLT ran (PC is past it)
+    Idle,           // Stuck in a loop that can never reach a new state
+    EndReached,     // PC reached end_address
+    BudgetExhausted // Ran the full instruction budget
+};
+
+// Finds runs that only revisit earlier states. The machine state (registers, STATUS and
+// a RAM hash) is sampled every interval instructions and fed to Brent's
+// cycle detection: execution is deterministic, so once a sample repeats, every later
+// sample repeats too. RAM with device pages is never reported idle, since a device can
+// change what the next read returns.
+class IdleDetector
+{
+public:
+    static constexpr uint64_t defaultInterval = 65536;
+
+    explicit IdleDetector(uint64_t interval = defaultInterval);
+
+    uint64_t getInterval() const { return interval; }
+    uint64_t untilSample() const { return interval - sinceSample; } // Instructions until the next sample is due
+    // Account for instructions run since the last call; takes a sample when one is due.
+    // True once a sample matches the one Brent's algorithm is holding
+    bool advance(uint64_t executed, const CPU &cpu, const RAM &ram);
+    uint64_t getCycleSamples() const { return cycleSamples; } // Cycle length in samples once found, else 0
+    void reset();
+
+private:
+    struct State
+    {
+        uint16_t PC;
+        uint16_t SP;
+        uint8_t A;
+        uint8_t STATUS;
+        uint64_t ram;
+
+        bool operator==(const State &) const = default;
+    };
+    static State capture(const CPU &cpu, const RAM &ram);
+
+    uint64_t interval;
+    uint64_t sinceSample;
+    State tortoise;
+    bool haveTortoise;
+    uint64_t power;  // Brent: the tortoise moves to the hare whenever lambda reaches power
+    uint64_t lambda;
+    uint64_t cycleSamples;
+};
+
+struct RunResult
+{
+    RunOutcome outcome;
+    uint64_t executed;
+};
+
+// Run from cpu.PC until a HLT, end_address, an idle loop or budget instructions, whichever
+// comes first. A JMP to itself is idle as soon as it is reached; any other loop is found by
+// detector, which keeps its samples across calls so a caller can run in slices
+RunResult runUntilHalt(CPU &cpu, RAM &ram, uint16_t end_address, uint64_t budget, IdleDetector &detector);
+
+#endif // NES_EMULATOR_IDLEDETECTOR_H
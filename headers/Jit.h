@@ -0,0 +1,92 @@
+#ifndef NES_EMULATOR_JIT_H
+#define NES_EMULATOR_JIT_H
+
+#include "LazyFlags.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#if defined(__x86_64__) && (defined(__unix__) || defined(__APPLE__))
+#define SCC_JIT_X64 1
+#else
+#define SCC_JIT_X64 0
+#endif
+
+class RAM;
+
+// Guest registers passed in and out of compiled code
+struct JitRegisters
+{
+    uint16_t PC;
+    uint16_t SP;
+    uint8_t A;
+    LazyFlags flags;
+};
+
+// One compiled trace: the instructions executed from start, following jumps, up to the
+// first one the compiler cannot handle or the first repeat of an instruction.
+struct JitBlock
+{
+    // Runs the block up to maxIterations times (only a block whose trace returns to its
+    // start repeats) and returns the number of instructions executed. A side exit stops
+    // before an instruction whose inline check fails, with registers set to that point.
+    using Code = uint64_t (*)(uint8_t *stackPage, JitRegisters *registers, uint64_t maxIterations);
+
+    Code code;
+    uint16_t start;
+    uint16_t highestPC;              // Highest instruction address, for the end_address check
+    std::vector<uint8_t> opcodes;    // Per instruction, for the CPU counters
+    std::vector<uint16_t> dataWrites; // Addresses stored by ADC/SBC
+    bool writesStack;                // Contains PSH
+};
+
+// x86-64 translator for the program region. A and SP live in host registers; PC is a
+// constant within a block and is only written back at exits. Blocks only contain data
+// operands on plain RAM pages inside 0x200..RAM::size(), where writeByte always succeeds
+// and the data cache can only hold copies of RAM, so compiled code reads and writes the
+// host pages (RAM::pageData) directly.
+// PSH and POP keep the writeStackByte/readByte range checks inline as side exits.
+// Flag records are only stored for the last ADC/SBC and the last flag-setting result
+// before each exit; the ones a later instruction overwrites first are never emitted.
+// Code writes (RAM::getCodeWriteCount) and layout changes flush every block.
+class JitCompiler
+{
+public:
+    static constexpr bool supported = SCC_JIT_X64 != 0;
+    static constexpr size_t arenaSize = 1024 * 1024;
+    static constexpr size_t maxBlockLength = 128; // Instructions
+
+    JitCompiler();
+    ~JitCompiler();
+    JitCompiler(const JitCompiler &) = delete;
+    JitCompiler &operator=(const JitCompiler &) = delete;
+
+    // Drop every block if ram is a different RAM, its instruction space was written or its pages moved
+    void synchronize(const RAM &ram);
+    // Block starting at pc, compiled on first use. nullptr if the instruction at pc cannot be compiled
+    const JitBlock *lookup(RAM &ram, uint16_t pc);
+    uint64_t getCompiledBlocks() const { return compiledBlocks; }
+
+private:
+    enum class SlotState : uint8_t
+    {
+        Unknown,
+        Compiled,
+        Uncompilable
+    };
+
+    bool compile(RAM &ram, uint16_t pc, JitBlock &compiled);
+    uint8_t *reserve(size_t length);
+    void flush();
+
+    JitBlock blocks[0x100];
+    SlotState state[0x100];
+    uint8_t *arena;   // Executable once written; writable only while a block is being emitted
+    size_t arenaUsed;
+    uint64_t ramId;
+    uint64_t seenCodeWrites;
+    uint64_t seenLayout;
+    uint64_t compiledBlocks;
+};
+
+#endif // NES_EMULATOR_JIT_H
@@ -0,0 +1,75 @@
+#ifndef NES_EMULATOR_LAZYFLAGS_H
+#define NES_EMULATOR_LAZYFLAGS_H
+
+#include <cstdint>
+
+// C, Z, O and N of the STATUS register, evaluated on demand. The ALU instructions only
+// record what they computed: ADC and SBC their operands (the source of C and O) and
+// every flag-setting instruction its 8-bit result (the source of Z and N). apply()
+// derives the flags when something reads STATUS, which no instruction does.
+//
+// ADC (M = A + M) sets C on a carry out of bit 7 and O on signed overflow.
+// SBC (M = M - A) sets C when no borrow was needed (M >= A) and O on signed overflow.
+// Both set Z and N from the stored result; LDA, AND, EOR and POP set them from A.
+struct LazyFlags
+{
+    // STATUS bits, in the order (-)(C)(Z)(I)(D)(B)(O)(N)
+    static constexpr uint8_t carry = 0x40;
+    static constexpr uint8_t zero = 0x20;
+    static constexpr uint8_t overflow = 0x02;
+    static constexpr uint8_t negative = 0x01;
+
+    enum Kind : uint8_t
+    {
+        None = 0, // C and O are as stored in STATUS
+        Add = 1,
+        Subtract = 2
+    };
+
+    uint8_t kind;      // Last ADC/SBC
+    uint8_t lhs;       // Its operands: result = lhs + rhs or lhs - rhs
+    uint8_t rhs;
+    uint8_t result;    // Last flag-setting result
+    uint8_t hasResult; // 0 while Z and N are as stored in STATUS
+
+    void arithmetic(Kind operation, uint8_t left, uint8_t right, uint8_t value)
+    {
+        kind = operation;
+        lhs = left;
+        rhs = right;
+        result = value;
+        hasResult = 1;
+    }
+    void logic(uint8_t value)
+    {
+        result = value;
+        hasResult = 1;
+    }
+    void clear()
+    {
+        kind = None;
+        hasResult = 0;
+    }
+
+    // status with the pending flags folded in
+    uint8_t apply(uint8_t status) const
+    {
+        if (kind != None)
+        {
+            uint8_t value = kind == Add ? static_cast<uint8_t>(lhs + rhs) : static_cast<uint8_t>(lhs - rhs);
+            bool carried = kind == Add ? lhs + rhs > 0xFF : lhs >= rhs;
+            // Signed overflow: the operands' signs make the result's sign impossible
+            uint8_t signs = kind == Add ? static_cast<uint8_t>(~(lhs ^ rhs) & (lhs ^ value)) : static_cast<uint8_t>((lhs ^ rhs) & (lhs ^ value));
+            status = static_cast<uint8_t>(status & ~(carry | overflow));
+            status |= (carried ? carry : 0) | (signs & 0x80 ? overflow : 0);
+        }
+        if (hasResult)
+        {
+            status = static_cast<uint8_t>(status & ~(zero | negative));
+            status |= (result == 0 ? zero : 0) | (result & 0x80 ? negative : 0);
+        }
+        return status;
+    }
+};
+
+#endif // NES_EMULATOR_LAZYFLAGS_H
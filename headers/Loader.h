@@ -0,0 +1,40 @@
+#ifndef NES_EMULATOR_LOADER_H
+#define NES_EMULATOR_LOADER_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "RAM.h"
+
+// Loads programs into RAM, either from the text formats of instructions.txt and
+// data.txt or from binary program images (see ProgramImage.h).
+class ProgramLoader
+{
+public:
+    static constexpr uint16_t dataStart = 0x0200;
+
+    // Program lines hold three 8-bit binary words (opcode, address high, address low),
+    // loaded from 0x0000. end_address is one past the last byte loaded
+    static bool loadTextProgram(RAM &ram, const std::string &path, uint16_t &end_address, std::string &error);
+    // Data files hold characters written one per byte from dataStart; whitespace is skipped
+    static bool loadTextData(RAM &ram, const std::string &path, std::string &error);
+
+    // Text parsers shared by the loaders and the image converter
+    static bool parseTextProgram(const std::string &path, std::vector<uint8_t> &bytes, std::string &error);
+    static bool parseTextData(const std::string &path, std::vector<uint8_t> &bytes, std::string &error);
+
+    // Map a binary image and copy its segments into ram
+    static bool loadImage(RAM &ram, const std::string &path, uint16_t &entry, uint16_t &end_address, std::string &error);
+    // Convert a text program and its data into one image (entry 0x0000, end at the end of the program)
+    static bool convertText(const std::string &programPath, const std::string &dataPath, const std::string &imagePath, std::string &error);
+    // Load a text program through an image cached in cacheDir, converting it only when
+    // the cached image is missing or the text files changed since it was written
+    static bool loadCached(RAM &ram, const std::string &programPath, const std::string &dataPath, const std::string &cacheDir,
+                           uint16_t &entry, uint16_t &end_address, std::string &error);
+
+private:
+    static bool readFile(const std::string &path, std::string &contents);
+    static uint64_t sourceStamp(const std::string &programPath, const std::string &dataPath);
+};
+
+#endif // NES_EMULATOR_LOADER_H
@@ -0,0 +1,94 @@
+#ifndef NES_EMULATOR_LOCKSTEP_H
+#define NES_EMULATOR_LOCKSTEP_H
+
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "CPU.h"
+
+// Differential testing of an execution engine against the reference interpreter.
+// Both run the same randomly generated program and data on their own CPU and RAM,
+// a block of instructions at a time, and after every block the registers, the number
+// of instructions executed and a hash of RAM must agree. The data cache and the
+// counters are engine-specific (JIT blocks invalidate lines instead of updating them)
+// and are not compared.
+
+// One generated program. Programs run from 0x0000 to the end of program
+struct LockstepCase
+{
+    std::vector<uint8_t> program; // Whole three-byte instructions
+    std::vector<uint8_t> data;    // Loaded from 0x0200
+    uint64_t budget;              // Instructions run on each side at most
+};
+
+struct LockstepOptions
+{
+    ExecutionEngine engine = ExecutionEngine::Jit;
+    uint64_t programs = 100000;
+    uint64_t seed = 1;          // Case i is generated from seed and i alone, whatever the thread count
+    unsigned threadCount = 1;
+    size_t maxLength = 24;      // Instructions per generated program
+    uint64_t budget = 512;
+    uint64_t blockSize = 32;    // Instructions between state comparisons
+};
+
+struct LockstepDivergence
+{
+    uint64_t index;          // Case number that diverged first
+    LockstepCase original;   // As generated
+    LockstepCase reduced;    // Shrunk reproducer
+    uint64_t instruction;    // Instructions the reproducer runs before the states differ
+    std::string reason;      // First difference, e.g. "A 0x12 != 0x13"
+};
+
+struct LockstepReport
+{
+    uint64_t programs;     // Cases compared
+    uint64_t instructions; // Executed by the reference side
+    double seconds;
+    bool diverged;
+    LockstepDivergence divergence; // Lowest diverging case, when diverged
+};
+
+class LockstepHarness
+{
+public:
+    // Runs the engine side: same contract as CPU::run. Tests substitute a faulty one
+    using Runner = std::function<uint64_t(CPU &cpu, RAM &ram, uint16_t end_address, uint64_t budget)>;
+
+    static constexpr uint64_t shardSize = 1024; // Cases per pool task
+
+    explicit LockstepHarness(const LockstepOptions &options);
+
+    void setRunner(Runner runner) { this->runner = std::move(runner); }
+    const LockstepOptions &getOptions() const { return options; }
+
+    // Generate, compare and, on the first divergence, shrink
+    LockstepReport run() const;
+
+    LockstepCase generate(uint64_t index) const;
+    // True when both sides agree. Otherwise reason describes the first difference and
+    // instruction is how many instructions both had run when it was seen
+    bool check(const LockstepCase &testCase, uint64_t blockSize, std::string &reason, uint64_t &instruction) const;
+    // Smallest program, data and budget found that still diverge
+    LockstepCase shrink(const LockstepCase &testCase) const;
+
+    // Program lines in the instructions.txt format
+    static void writeProgram(std::ostream &out, const LockstepCase &testCase);
+    // A .sccimg of the case plus a one-line scc_batch manifest with its budget
+    static bool writeReproducer(const std::string &imagePath, const std::string &manifestPath, const LockstepCase &testCase,
+                                std::string &error);
+
+private:
+    struct Workspace;
+    bool check(Workspace &workspace, const LockstepCase &testCase, uint64_t blockSize, std::string &reason,
+               uint64_t &instruction, uint64_t *executed) const;
+    bool diverges(Workspace &workspace, const LockstepCase &testCase) const;
+
+    LockstepOptions options;
+    Runner runner; // Empty runs cpu.run with options.engine
+};
+
+#endif // NES_EMULATOR_LOCKSTEP_H
@@ -0,0 +1,24 @@
+#ifndef NES_EMULATOR_MEMORYDEVICE_H
+#define NES_EMULATOR_MEMORYDEVICE_H
+
+#include <cstdint>
+
+// What a 256-byte page of the address space is routed to (see RAM::mapROM and RAM::mapDevice)
+enum class PageKind : uint8_t
+{
+    RAM,   // Plain memory, allocated on its first write
+    ROM,   // Read-only memory: stores are rejected
+    Device // Every access is handed to a MemoryDevice
+};
+
+// Memory-mapped device. read and write are only called on the CPU's thread; the RAM.txt
+// dump, snapshots and scc_view never touch device pages and see them as zero.
+class MemoryDevice
+{
+public:
+    virtual ~MemoryDevice() = default;
+    virtual uint8_t read(uint16_t address) = 0;
+    virtual bool write(uint16_t address, uint8_t value) = 0; // False rejects the store
+};
+
+#endif // NES_EMULATOR_MEMORYDEVICE_H
@@ -0,0 +1,93 @@
+#ifndef NES_EMULATOR_MULTICORE_H
+#define NES_EMULATOR_MULTICORE_H
+
+#include "CPU.h"
+#include <atomic>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Coherence traffic seen by one core, or summed over all of them
+struct CoherenceCounters
+{
+    uint64_t readHits;
+    uint64_t readMisses;
+    uint64_t writeHits;          // Stores to a line already held in E or M
+    uint64_t writeMisses;
+    uint64_t busReads;           // BusRd: read misses
+    uint64_t busReadExclusive;   // BusRdX: stores to lines not held at all
+    uint64_t upgrades;           // BusUpgr: stores to lines held in S
+    uint64_t invalidations;      // Copies dropped from other cores' caches
+    uint64_t interventions;      // E or M lines downgraded to S by another core's read
+    uint64_t writebacks;         // M lines downgraded, invalidated or evicted
+    uint64_t retries;            // Directory updates that lost a race and went again
+
+    void add(const CoherenceCounters &other);
+    void writeJson(std::ostream &out) const;
+};
+
+struct MultiCoreReport
+{
+    std::vector<uint64_t> executed; // Per core
+    std::vector<bool> halted;
+    std::vector<CoherenceCounters> cores;
+    CoherenceCounters total;
+    double seconds;
+
+    void writeJson(std::ostream &out) const;
+};
+
+// N CPUs, each on its own host thread, executing against one RAM. RAM is the point of
+// coherence: data bytes are read with atomic loads and ADC/SBC update them with atomic
+// fetch_add/fetch_sub, so no store is lost and no thread takes a lock on plain RAM pages.
+// Each core's data cache holds tags under an invalidation-based MESI protocol: a
+// directory word per cache line (sharer bits plus exclusive and modified bits, updated
+// by compare-and-swap) decides hits, misses and the bus traffic they cost, and a core
+// whose bit another core's store cleared misses on its next access.
+//
+// Each core has a private 256-byte stack at 0x100-0x1FF and its own registers and flags.
+// Instructions, ROM and device pages, and stores the data region would refuse, go
+// through RAM's ordinary methods under one lock. Running allocates every data page up
+// front. There is no per-instruction trace, and run() ignores CPU::engine.
+class MultiCore
+{
+public:
+    static constexpr size_t maxCores = 16;
+
+    MultiCore(RAM &ram, size_t coreCount);
+    ~MultiCore();
+    MultiCore(const MultiCore &) = delete;
+    MultiCore &operator=(const MultiCore &) = delete;
+
+    size_t getCoreCount() const { return cores.size(); }
+    CPU &core(size_t index);
+    uint8_t readStack(size_t index, uint16_t address) const; // A byte of core index's private stack
+
+    // Run every core from its PC until a HLT, end_address or budget instructions. False
+    // (with error set) for an unsupported core count. Errors the cores report are written to
+    // the calling thread's errorLog() after they stop, core by core
+    bool run(uint16_t end_address, uint64_t budget, MultiCoreReport &report, std::string &error);
+
+private:
+    struct Core;
+
+    void execute(Core &core, uint16_t end_address, uint64_t budget);
+    uint8_t fetch(uint16_t address);
+    uint8_t read(Core &core, uint16_t address);
+    uint8_t modify(Core &core, uint16_t address, uint8_t operand, bool subtract);
+    void claimLine(Core &core, uint16_t address, bool exclusive, bool wasPresent);
+    void fillLine(Core &core, uint16_t address);
+    void releaseLine(Core &core, size_t line);
+    uint8_t loadShared(uint16_t address);
+
+    RAM &ram;
+    std::vector<std::unique_ptr<Core>> cores;
+    std::unique_ptr<std::atomic<uint32_t>[]> directory; // One word per data cache line
+    std::vector<uint8_t *> hostPages;                    // RAM pages, nullptr for ROM and devices
+    std::mutex busLock;                                  // Guards RAM's own methods
+};
+
+#endif // NES_EMULATOR_MULTICORE_H
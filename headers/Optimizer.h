@@ -0,0 +1,85 @@
+#ifndef NES_EMULATOR_OPTIMIZER_H
+#define NES_EMULATOR_OPTIMIZER_H
+
+#include "CPU.h"
+#include <cstdint>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Where the path from the entry stops being followed
+enum class PathEnd
+{
+    End,    // Reaches end_address
+    Halt,   // Reaches a HLT (not part of the path)
+    Loop,   // Returns to an instruction already on the path, and repeats from there forever
+    Unknown // Leaves the code region, whose bytes the program itself may change
+};
+
+// One instruction on the path
+struct InstructionFacts
+{
+    uint16_t pc;
+    uint8_t opcode;
+    uint16_t operand;
+    bool repeats; // In the loop rather than the prefix
+};
+
+// Control flow of a loaded program. Every instruction has exactly one successor (a JMP
+// to x resumes at x + 3, anything else at pc + 3) and stores never reach the code
+// region, so the control-flow graph from the entry is one path: a straight-line prefix
+// that runs once, then an exit or a loop that repeats forever.
+struct ProgramAnalysis
+{
+    std::vector<InstructionFacts> path; // In execution order: the prefix, then the loop
+    size_t prefixLength;                // Instructions before the loop, or before the exit
+    PathEnd end;
+    bool touchesDevices;                // Some data access on the path may reach a device page
+
+    // Instructions a fresh run executes exactly once, in order, before anything repeats
+    bool prefixPrecomputable() const { return prefixLength > 0 && !touchesDevices; }
+    void writeJson(std::ostream &out) const;
+};
+
+// Analyse the program from cpu.PC and cpu.SP in ram
+ProgramAnalysis analyzeProgram(const CPU &cpu, const RAM &ram, uint16_t end_address);
+
+// The effect of running a program's prefix, captured from one run and replayed by later
+// runs that start from the same state. Only the last value stored to each byte is kept
+struct PrecomputedPrefix
+{
+    uint64_t instructions = 0;
+    CPUSnapshot cpu;
+    std::vector<std::pair<uint16_t, uint8_t>> writes; // Bytes the prefix changed, with their final values
+    std::string log;                                  // What the prefix wrote to the error log
+};
+
+// Run analysis.prefixLength instructions and record their effect in prefix. errors is the
+// run's error log, so the prefix can replay what it adds. False (with prefix.instructions
+// set to the number that ran) if the run stopped early
+bool capturePrefix(CPU &cpu, RAM &ram, uint16_t end_address, const ProgramAnalysis &analysis, const std::ostringstream &errors,
+                   PrecomputedPrefix &prefix);
+// Leave cpu and ram as if the prefix had just run
+void applyPrefix(CPU &cpu, RAM &ram, const PrecomputedPrefix &prefix);
+
+// Prefixes shared by the runs of one batch, keyed by whatever identifies their starting state
+class PrefixCache
+{
+public:
+    // The prefix stored under key, or nullptr. claimed is set for the one caller that should capture it
+    std::shared_ptr<const PrecomputedPrefix> find(const std::string &key, bool &claimed);
+    void store(const std::string &key, const PrecomputedPrefix &prefix);
+
+private:
+    std::mutex lock;
+    std::map<std::string, std::shared_ptr<const PrecomputedPrefix>> entries;
+    std::set<std::string> claims;
+};
+
+#endif // NES_EMULATOR_OPTIMIZER_H
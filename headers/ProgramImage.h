@@ -0,0 +1,72 @@
+#ifndef NES_EMULATOR_PROGRAMIMAGE_H
+#define NES_EMULATOR_PROGRAMIMAGE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class RAM;
+
+// Which RAM region a segment is loaded into
+enum class SegmentKind : uint16_t
+{
+    Code = 0,  // 0x000-0x0FF
+    Stack = 1, // 0x100-0x1FF
+    Data = 2   // 0x200 and up
+};
+
+struct ImageSegment
+{
+    uint16_t address;
+    SegmentKind kind;
+    const uint8_t *bytes;
+    uint32_t length;
+};
+
+// Compact binary program image (.sccimg). All fields are little-endian:
+//   header   32 bytes: "SCCI", version, segment count, entry, end address, source stamp
+//   segments 12 bytes each: address, kind, payload offset, length
+//   payload  raw segment bytes
+// Images are mapped read-only and copied into RAM segment by segment.
+class ProgramImage
+{
+public:
+    static constexpr uint32_t MAGIC = 0x49434353; // "SCCI"
+    static constexpr uint16_t VERSION = 1;
+    static constexpr size_t headerSize = 32;
+    static constexpr size_t segmentEntrySize = 12;
+
+    ProgramImage();
+    ~ProgramImage();
+    ProgramImage(const ProgramImage &) = delete;
+    ProgramImage &operator=(const ProgramImage &) = delete;
+
+    bool open(const std::string &path, std::string &error);
+    void close();
+    // Copy every segment into ram
+    bool loadInto(RAM &ram) const;
+
+    uint16_t getEntry() const { return entry; }
+    uint16_t getEnd() const { return end; }
+    uint64_t getSourceStamp() const { return sourceStamp; } // Identifies the text a cached image was converted from
+    const std::vector<ImageSegment> &getSegments() const { return segments; }
+
+    // Written to a temporary file and renamed, so readers never see a partial image
+    static bool write(const std::string &path, uint16_t entry, uint16_t end, uint64_t sourceStamp,
+                      const std::vector<ImageSegment> &segments, std::string &error);
+
+private:
+    bool parse(std::string &error);
+
+    const uint8_t *base;
+    size_t length;
+    bool mapped;                // base is an mmap, otherwise it points into buffer
+    std::vector<uint8_t> buffer; // File contents where mmap is unavailable
+    uint16_t entry;
+    uint16_t end;
+    uint64_t sourceStamp;
+    std::vector<ImageSegment> segments;
+};
+
+#endif // NES_EMULATOR_PROGRAMIMAGE_H
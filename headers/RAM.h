@@ -6,22 +6,147 @@
 #include <iomanip>
 #include <iostream>
 #include <fstream>
+#include <atomic>
+#include <memory>
+#include <array>
+#include "MemoryDevice.h"
+#include "RAMDumper.h"
+#include "SharedRAM.h"
+#include "Trace.h"
 
+// Immutable copy of RAM at one point in time. Pages nobody wrote between two
+// snapshots are shared between them, so snapshots are cheap to take and keep.
+class RAMSnapshot
+{
+public:
+    static constexpr size_t pageSize = 256;
+    using Page = std::array<uint8_t, pageSize>;
+
+    bool empty() const { return pages.empty(); }
+
+private:
+    friend class RAM;
+    std::vector<std::shared_ptr<const Page>> pages;
+};
+
+// The address space is a table of 256-byte pages. RAM pages are allocated on their
+// first store (until then they read as zero from one shared page), so a 64 KB space
+// only costs memory for the pages a program touches. Pages in the data region can be
+// remapped to ROM or to a MemoryDevice; reads of ordinary memory are a table lookup.
 class RAM {
 public:
+    static constexpr size_t pageSize = RAMSnapshot::pageSize;
+    static constexpr size_t defaultSize = 2 * 1024;
+    static constexpr size_t maxSize = 0x10000; // Everything a 16-bit address reaches
+    static constexpr const char *defaultDumpPath = "RAM.txt";
+
     RAM();
+    explicit RAM(DumpMode dumpMode, std::chrono::milliseconds dumpInterval = RAMDumper::defaultInterval);
+    // size is rounded up to whole pages and capped at maxSize. dumpPath is the dump file for every dump mode
+    explicit RAM(size_t size, DumpMode dumpMode = DumpMode::Interval, std::chrono::milliseconds dumpInterval = RAMDumper::defaultInterval,
+                 const std::string &dumpPath = defaultDumpPath);
     ~RAM();
 
+    size_t size() const { return memorySize; }
+    void setDumpMode(DumpMode mode, std::chrono::milliseconds interval = RAMDumper::defaultInterval);
+    const RAMDumper *getDumper() const { return dumper.get(); }
+    const std::string &getDumpPath() const { return dumpPath; }
+    bool mapShared(const std::string &name); // Move memory into /dev/shm/<name> for scc_view
+
+    // Instruction space writes are logged so decoded-instruction caches can invalidate precisely
+    static constexpr uint16_t codeWriteLogSize = 64;
+    uint64_t getId() const { return id; }
+    uint64_t getCodeWriteCount() const { return codeWriteCount; }
+    uint16_t getCodeWrite(uint64_t index) const { return codeWriteLog[index % codeWriteLogSize]; }
+
 
     uint8_t readByte(uint16_t address) const;
-    void writeByte(uint16_t address, uint8_t value);
-    void writeStackByte(uint16_t address, uint8_t value);
-    void writeInstructionByte(uint16_t address, uint8_t value);
+    // Writes return false when the address is out of range or outside the function's region
+    bool writeByte(uint16_t address, uint8_t value);
+    bool writeStackByte(uint16_t address, uint8_t value);
+    bool writeInstructionByte(uint16_t address, uint8_t value);
+    // Bulk copy of a loaded image segment, with no per-byte region checks or write log
+    bool loadBytes(uint16_t address, const uint8_t *data, size_t length);
+    // Bus layout. Regions are whole pages inside the data region (0x200..size()). ROM starts as
+    // a copy of data (zero filled past length); loadBytes and restore can still write it
+    bool mapROM(uint16_t address, size_t length, const uint8_t *data, size_t dataLength);
+    bool mapDevice(uint16_t address, size_t length, MemoryDevice *device);
+    PageKind getPageKind(uint16_t address) const { return kinds[address / pageSize]; }
+    uint64_t getLayoutVersion() const { return layoutVersion; } // Changes whenever pages move or are remapped
+    size_t getAllocatedPages() const;
+    // Hash of every byte in [0, size()), eight bytes at a time. Device pages count as zero.
+    // Only meaningful for comparing two RAMs of the same size within one process
+    uint64_t contentHash() const;
+
+    // Direct access for compiled code: the host page holding address if it is RAM (allocating
+    // it), otherwise nullptr. Valid until the layout version changes. Callers report what they
+    // stored with markStored
+    uint8_t *pageData(uint16_t address);
+    void markStored(size_t address, size_t length);
+    // Copy-on-write snapshots: snapshot() copies only pages written since the last snapshot or
+    // restore, and restore() copies back only the pages that differ from the snapshot
+    RAMSnapshot snapshot();
+    bool restore(const RAMSnapshot &snapshot, size_t *pagesCopied = nullptr);
     void dump_memory_at_address(uint16_t address, std::ostream& outFile) const;
-    void dump_memory() const;  // Declaration for the dump_memory function
+    // Render the RAM.txt line starting at address into HexDump::lineLength chars
+    void formatDumpLine(uint16_t address, char *out) const;
+    void dump_memory() const;  // Sync point: RAM.txt reflects every store made so far
 
 private:
-    std::vector<uint8_t> memory;
+    static constexpr size_t maxPages = maxSize / pageSize;
+
+    // Relaxed atomic byte access so the dump thread can read while the CPU writes. Only the
+    // CPU's thread changes the page tables, so it can read them relaxed; other threads use
+    // peekByte, which pairs with the release that publishes a zeroed page
+    uint8_t loadByte(uint16_t address) const
+    {
+        uint8_t *page = readPages[address / pageSize].load(std::memory_order_relaxed);
+        if (page != nullptr) [[likely]]
+        {
+            return std::atomic_ref<uint8_t>(page[address % pageSize]).load(std::memory_order_relaxed);
+        }
+        return devices[address / pageSize]->read(address);
+    }
+    // loadByte without device side effects, for the dump thread and snapshots
+    uint8_t peekByte(size_t address) const
+    {
+        uint8_t *page = readPages[address / pageSize].load(std::memory_order_acquire);
+        return page != nullptr ? std::atomic_ref<uint8_t>(page[address % pageSize]).load(std::memory_order_relaxed) : 0;
+    }
+    bool storeByte(uint16_t address, uint8_t value); // False for ROM and refused device stores
+    void rawStore(size_t address, uint8_t value);     // Any page but a device page, ROM included
+    uint8_t *allocatePage(size_t page);
+    uint8_t *backingPage(size_t page); // Writable storage behind a RAM or ROM page, allocated if needed
+    bool checkRegion(uint16_t address, size_t length, const char *what) const;
+    void logCodeWrite(uint16_t address)
+    {
+        codeWriteLog[codeWriteCount % codeWriteLogSize] = address;
+        codeWriteCount++;
+    }
+    void markPageDirty(size_t address) { pageDirty[address / RAMSnapshot::pageSize / 64] |= uint64_t(1) << (address / RAMSnapshot::pageSize % 64); }
+    bool isPageDirty(size_t page) const { return pageDirty[page / 64] >> (page % 64) & 1; }
+    void publishStore(size_t address, size_t length); // Shared image generation and RAM.txt dirty lines
+
+    size_t memorySize;
+    // Page tables cover the whole 16-bit space, so a lookup is one indexed load off this
+    std::atomic<uint8_t *> readPages[maxPages];  // nullptr routes to the device
+    std::atomic<uint8_t *> writePages[maxPages]; // nullptr for ROM, devices and unallocated RAM
+    PageKind kinds[maxPages];
+    MemoryDevice *devices[maxPages];
+    std::unique_ptr<RAMSnapshot::Page> ownedPages[maxPages]; // Empty slots are unallocated (or shared)
+    size_t pageCount;
+    uint64_t layoutVersion;
+    std::string dumpPath;
+    std::unique_ptr<RAMDumper> dumper;
+    std::unique_ptr<SharedRAMImage> shared;
+
+    uint64_t id; // Unique per RAM instance, so caches never mistake a new RAM for an old one
+    uint64_t codeWriteCount;
+    uint16_t codeWriteLog[codeWriteLogSize];
+
+    // Snapshot the memory matched at the last snapshot or restore, and the pages written since
+    std::vector<std::shared_ptr<const RAMSnapshot::Page>> baseline;
+    std::vector<uint64_t> pageDirty;
     // Add more private members as needed
 };
 
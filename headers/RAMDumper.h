@@ -0,0 +1,72 @@
+#ifndef NES_EMULATOR_RAMDUMPER_H
+#define NES_EMULATOR_RAMDUMPER_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class RAM;
+
+// How RAM.txt is kept up to date
+enum class DumpMode
+{
+    Disabled, // Never write RAM.txt
+    Manual,   // Write RAM.txt only at explicit sync points (RAM::dump_memory)
+    Interval, // A background thread flushes dirty lines on a fixed interval
+    Immediate // Every store rewrites its own line before it returns
+};
+
+// "off", "manual", "interval" or "immediate"
+bool parseDumpMode(const std::string &name, DumpMode &mode);
+
+// Tracks which 64-byte lines of RAM changed since the last flush and writes
+// them to the dump file, either from a background thread or on request.
+// The file stays open between flushes: the first flush writes it whole, later
+// ones write each run of changed lines at its fixed offset with pwrite.
+class RAMDumper
+{
+public:
+    static constexpr uint16_t bytesPerLine = 64;
+    static constexpr std::chrono::milliseconds defaultInterval{100};
+
+    RAMDumper(const RAM &ram, const std::string &path, DumpMode mode, std::chrono::milliseconds interval);
+    ~RAMDumper();
+
+    void markDirty(uint16_t address); // Called by RAM after every store
+    void markAllDirty();
+    void sync(); // Flush now; RAM.txt reflects every store made before the call
+
+    DumpMode getMode() const { return mode; }
+    std::chrono::milliseconds getInterval() const { return interval; }
+    uint64_t getFlushCount() const { return flushCount.load(std::memory_order_relaxed); }
+    uint64_t getBytesWritten() const { return bytesWritten.load(std::memory_order_relaxed); }
+
+private:
+    void run();
+    void flush(); // Caller holds flushMutex
+    bool writeAt(size_t offset, size_t length);
+
+    const RAM &ram;
+    std::string path;
+    DumpMode mode;
+    std::chrono::milliseconds interval;
+
+    std::vector<std::atomic<uint64_t>> dirty; // One bit per dump line
+    size_t lineCount;
+    std::vector<char> text;                   // Rendered file: every line at a fixed offset
+    std::atomic<uint64_t> flushCount;
+    std::atomic<uint64_t> bytesWritten;
+    int fd; // RAM.txt, open from the first flush on; -1 before it or on hosts without pwrite
+
+    std::mutex flushMutex;
+    std::condition_variable wake;
+    bool stopping;
+    std::thread worker;
+};
+
+#endif // NES_EMULATOR_RAMDUMPER_H
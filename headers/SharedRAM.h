@@ -0,0 +1,51 @@
+#ifndef NES_EMULATOR_SHAREDRAM_H
+#define NES_EMULATOR_SHAREDRAM_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Header at the start of a RAM image published in shared memory. The memory
+// bytes start at SharedRAMImage::dataOffset.
+struct SharedRAMHeader
+{
+    static constexpr uint32_t MAGIC = 0x4D415253; // "SRAM"
+    static constexpr uint32_t VERSION = 1;
+
+    uint32_t magic;
+    uint32_t version;
+    uint32_t size;                    // Number of memory bytes in the image
+    std::atomic<uint32_t> attached;   // 1 while the emulator has the image mapped
+    std::atomic<uint64_t> generation; // Bumped after every store
+};
+
+// A RAM image mapped from /dev/shm. The emulator creates it read-write, viewers
+// attach to it read-only.
+class SharedRAMImage
+{
+public:
+    static constexpr size_t dataOffset = 64;
+
+    SharedRAMImage();
+    ~SharedRAMImage();
+    SharedRAMImage(const SharedRAMImage &) = delete;
+    SharedRAMImage &operator=(const SharedRAMImage &) = delete;
+
+    bool create(const std::string &name, uint32_t size); // Owner side; unlinks the image on destruction
+    bool attach(const std::string &name);                // Read-only viewer side
+    void close();
+
+    bool isOpen() const { return header != nullptr; }
+    SharedRAMHeader *getHeader() const { return header; }
+    uint8_t *getData() const { return data; }
+
+private:
+    std::string path;
+    SharedRAMHeader *header;
+    uint8_t *data;
+    size_t length;
+    bool owner;
+};
+
+#endif // NES_EMULATOR_SHAREDRAM_H
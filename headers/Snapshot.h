@@ -0,0 +1,29 @@
+#ifndef NES_EMULATOR_SNAPSHOT_H
+#define NES_EMULATOR_SNAPSHOT_H
+
+#include "CPU.h"
+
+// Everything needed to rerun a program from the same starting state
+struct MachineSnapshot
+{
+    CPUSnapshot cpu;
+    RAMSnapshot ram;
+};
+
+inline MachineSnapshot takeSnapshot(const CPU &cpu, RAM &ram)
+{
+    return MachineSnapshot{cpu.snapshot(), ram.snapshot()};
+}
+
+// Costs time proportional to the RAM pages written since the snapshot was taken or last restored
+inline bool restoreSnapshot(CPU &cpu, RAM &ram, const MachineSnapshot &snapshot, size_t *pagesCopied = nullptr)
+{
+    if (!ram.restore(snapshot.ram, pagesCopied))
+    {
+        return false;
+    }
+    cpu.restore(snapshot.cpu);
+    return true;
+}
+
+#endif // NES_EMULATOR_SNAPSHOT_H
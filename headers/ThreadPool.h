@@ -0,0 +1,51 @@
+#ifndef NES_EMULATOR_THREADPOOL_H
+#define NES_EMULATOR_THREADPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Work-stealing pool. Every worker owns a deque: it pops its own tasks from the
+// back and, when that runs dry, steals from the front of another worker's deque,
+// so a few long-running jobs never leave the other cores idle.
+class WorkStealingPool
+{
+public:
+    explicit WorkStealingPool(unsigned threadCount);
+    ~WorkStealingPool();
+
+    unsigned getThreadCount() const { return static_cast<unsigned>(workers.size()); }
+    // Tasks are dealt round-robin onto the worker deques
+    void submit(std::function<void()> task);
+    // Block until every submitted task has finished
+    void wait();
+
+private:
+    struct Queue
+    {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    bool popLocal(size_t index, std::function<void()> &task);
+    bool steal(size_t index, std::function<void()> &task);
+    void workerLoop(size_t index);
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> workers;
+    std::mutex stateMutex;
+    std::condition_variable workAvailable;
+    std::condition_variable allDone;
+    std::atomic<size_t> queued;  // Tasks submitted and not yet popped
+    std::atomic<size_t> pending; // Tasks submitted but not yet finished
+    size_t nextQueue;
+    bool stopping;
+};
+
+#endif // NES_EMULATOR_THREADPOOL_H
@@ -0,0 +1,74 @@
+#ifndef NES_EMULATOR_TIMING_H
+#define NES_EMULATOR_TIMING_H
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+
+// Cycle-level timing model. Configure with -DEMULATOR_TIMING=ON (EMULATOR_TIMING=1);
+// otherwise every hook is discarded by the compiler and CPU::timing is never read.
+// Applied per target like the trace level, so CPU keeps the same layout either way.
+#ifndef EMULATOR_TIMING
+#define EMULATOR_TIMING 0
+#endif
+
+// Stage latencies and stall penalties, in cycles
+struct TimingConfig
+{
+    uint32_t fetch = 1;
+    uint32_t decode = 1;
+    uint32_t execute = 1;
+    uint32_t cacheHit = 1;   // Data access served by the data cache
+    uint32_t cacheMiss = 10; // Data access that misses, and every stack access (the stack is not cached)
+    uint32_t hazard = 2;     // Reading the address the previous instruction stored: no store forwarding
+};
+
+// Parses "fetch=2,miss=20,...": keys fetch, decode, execute, hit, miss and hazard. Unnamed fields keep their values
+bool parseTimingConfig(const std::string &text, TimingConfig &config);
+
+struct TimingReport
+{
+    uint64_t instructions;
+    uint64_t cycles;
+    uint64_t fill;            // Cycles before the first instruction completes, beyond one issue slot
+    uint64_t cacheHitStalls;
+    uint64_t cacheMissStalls; // Including stack accesses
+    uint64_t hazardStalls;
+    uint64_t controlStalls;   // Refetching after a JMP
+
+    double cpi() const { return instructions ? static_cast<double>(cycles) / static_cast<double>(instructions) : 0.0; }
+    void writeJson(std::ostream &out) const;
+};
+
+// An in-order fetch/decode/execute pipeline that freezes as a whole on every stall.
+// Without stalls it completes one instruction per slowest-stage latency after filling;
+// each instruction then adds its memory penalty (per data cache lookup, or the miss
+// penalty for PSH/POP), a hazard penalty when it reads the address the instruction
+// before it stored, and a JMP adds fetch + decode while the pipeline refills from the
+// target. The CPU feeds it from the reference loop, which it selects while attached.
+class TimingModel
+{
+public:
+    static constexpr bool enabled = EMULATOR_TIMING != 0;
+
+    explicit TimingModel(const TimingConfig &config = TimingConfig{});
+
+    // A data cache lookup made by the instruction being executed
+    void dataAccess(bool hit) { (hit ? pendingHits : pendingMisses)++; }
+    // The instruction finished: charge it and its stalls
+    void retire(uint8_t opcode, uint16_t operand);
+
+    const TimingConfig &getConfig() const { return config; }
+    TimingReport getReport() const { return report; }
+    void reset();
+
+private:
+    TimingConfig config;
+    TimingReport report;
+    uint32_t pendingHits;
+    uint32_t pendingMisses;
+    bool lastStored;
+    uint16_t lastStoreAddress;
+};
+
+#endif // NES_EMULATOR_TIMING_H
@@ -0,0 +1,44 @@
+#ifndef NES_EMULATOR_TRACE_H
+#define NES_EMULATOR_TRACE_H
+
+#include <iostream>
+
+// Compile-time verbosity of the interpreter. Configure with -DEMULATOR_TRACE=OFF
+// (EMULATOR_TRACE_LEVEL=0) for a silent build in which every per-instruction and
+// per-store message is discarded by the compiler. Errors are always reported.
+#ifndef EMULATOR_TRACE_LEVEL
+#define EMULATOR_TRACE_LEVEL 1
+#endif
+
+enum class TraceLevel
+{
+    Silent = 0, // No console output on the hot path
+    Trace = 1   // Opcode, binary and per-instruction messages, plus RAM write logs
+};
+
+template <TraceLevel Level>
+struct TracePolicy
+{
+    static constexpr TraceLevel level = Level;
+    static constexpr bool enabled = Level != TraceLevel::Silent;
+};
+
+using ActiveTrace = TracePolicy<static_cast<TraceLevel>(EMULATOR_TRACE_LEVEL)>;
+
+// Where the CPU and RAM report errors on this thread: std::cerr unless a batch
+// worker redirects it, so parallel instances never contend on one stream
+inline thread_local std::ostream *errorStream = &std::cerr;
+
+inline std::ostream &errorLog()
+{
+    static thread_local std::ostream discard(nullptr);
+    return errorStream != nullptr ? *errorStream : discard;
+}
+
+// nullptr discards every message
+inline void setErrorLog(std::ostream *stream)
+{
+    errorStream = stream;
+}
+
+#endif // NES_EMULATOR_TRACE_H
@@ -0,0 +1,73 @@
+#ifndef NES_EMULATOR_TRANSLATOR_H
+#define NES_EMULATOR_TRANSLATOR_H
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+class CPU;
+class RAM;
+
+// Ahead-of-time translation of the instruction space into C++. Every instruction
+// address becomes a label whose code calls the CPU method for its opcode with the
+// operand as a constant, and JMPs become gotos, so there is no fetch or decode left.
+// The generated file is compiled into a shared object and loaded by TranslatedProgram,
+// which resolves the CPU and RAM methods it calls from the loading executable.
+// Those methods stay out of line, so the compiler cannot inline or fold an instruction's
+// semantics into its neighbours: the gain is the removed dispatch, not constant folding.
+// Inlining them would compile the trace level, counters and cache into the object and
+// tie it to one build configuration.
+
+// Bump whenever TranslatedProgramInfo or the CPU methods generated code calls change
+constexpr uint32_t translatedAbiVersion = 2;
+
+// Exported by every translated shared object through translatedEntryPoint
+struct TranslatedProgramInfo
+{
+    uint32_t abiVersion;
+    uint32_t cpuSize; // sizeof(CPU) and sizeof(RAM) where the program was compiled:
+    uint32_t ramSize; // a different cache geometry or class layout changes them
+    const uint8_t *program; // The instruction space it was translated from (DecodeCache::programSize bytes)
+    uint64_t (*run)(CPU &cpu, RAM &ram, uint16_t end_address, uint64_t budget);
+};
+
+constexpr const char *translatedEntryPoint = "scc_translated_program";
+
+class ProgramTranslator
+{
+public:
+    // Write a translation unit for the DecodeCache::programSize bytes at program
+    static void translate(const uint8_t *program, const std::string &source, std::ostream &out);
+    // Compile a translated file into a shared object with the compiler and flags this project was built with
+    static bool compile(const std::string &sourcePath, const std::string &libraryPath, std::string &error);
+};
+
+// A translated program loaded with dlopen
+class TranslatedProgram
+{
+public:
+    TranslatedProgram();
+    ~TranslatedProgram();
+    TranslatedProgram(const TranslatedProgram &) = delete;
+    TranslatedProgram &operator=(const TranslatedProgram &) = delete;
+
+    // Fails on a missing entry point or an ABI, CPU or RAM mismatch
+    bool load(const std::string &path, std::string &error);
+    bool isLoaded() const { return info != nullptr; }
+
+    // Same contract as CPU::run. Falls back to cpu.run while a journal is attached or when
+    // ram's instruction space no longer holds the translated program
+    uint64_t run(CPU &cpu, RAM &ram, uint16_t end_address, uint64_t budget);
+
+private:
+    bool matches(const RAM &ram);
+    void unload();
+
+    void *handle;
+    const TranslatedProgramInfo *info;
+    uint64_t checkedRam; // RAM id and code write count at the last comparison
+    uint64_t checkedCodeWrites;
+    bool checkedMatch;
+};
+
+#endif // NES_EMULATOR_TRANSLATOR_H
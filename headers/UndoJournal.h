@@ -0,0 +1,70 @@
+#ifndef NES_EMULATOR_UNDOJOURNAL_H
+#define NES_EMULATOR_UNDOJOURNAL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <vector>
+#include "Snapshot.h"
+
+// Reverse execution. While attached to a CPU (CPU::journal) every executed
+// instruction records the registers it started with, the byte it overwrote and,
+// for ADC..EOR, the data cache line it touched, in a fixed-size ring. Every checkpointInterval instructions a MachineSnapshot
+// is kept as well, so stepping back further than the ring reaches restores the
+// nearest checkpoint and re-executes forward to the target.
+class UndoJournal
+{
+public:
+    static constexpr size_t defaultCapacity = 65536;
+    static constexpr uint64_t defaultCheckpointInterval = 16384;
+    static constexpr size_t defaultCheckpointCount = 16;
+
+    explicit UndoJournal(size_t capacity = defaultCapacity, uint64_t checkpointInterval = defaultCheckpointInterval,
+                         size_t checkpointCount = defaultCheckpointCount);
+
+    // Called by the CPU before each instruction, and by its stores before they write
+    void record(const CPU &cpu, RAM &ram);
+    void recordWrite(uint16_t address, uint8_t previous);
+
+    // Undo the last steps instructions. Returns how many were undone (fewer if history runs out)
+    uint64_t stepBack(CPU &cpu, RAM &ram, uint64_t steps);
+    // Undo back to just before the most recent journaled write to address. False if none is left in the ring
+    bool runBackToWrite(CPU &cpu, RAM &ram, uint16_t address);
+
+    uint64_t getPosition() const { return position; } // Instructions recorded since the journal started
+    size_t size() const { return count; }             // Instructions undoable from the ring alone
+    size_t getCheckpointCount() const { return checkpoints.size(); }
+    void clear();
+
+private:
+    struct Entry
+    {
+        uint16_t PC;
+        uint16_t SP;
+        uint16_t writeAddress;
+        uint8_t A;
+        uint8_t STATUS;
+        uint8_t previous;  // Byte at writeAddress before the instruction
+        bool wrote;
+        bool cached;       // The instruction reads (and may fill or evict) a cache line
+        DataCache::LineState line;
+    };
+    struct Checkpoint
+    {
+        uint64_t position;
+        MachineSnapshot state;
+    };
+
+    Entry &newest() { return entries[(head + entries.size() - 1) % entries.size()]; }
+    void undoNewest(CPU &cpu, RAM &ram);
+
+    std::vector<Entry> entries;
+    size_t head;  // Slot the next entry goes into
+    size_t count; // Valid entries, newest just before head
+    uint64_t position;
+    uint64_t checkpointInterval;
+    size_t checkpointCount;
+    std::deque<Checkpoint> checkpoints; // Oldest first
+};
+
+#endif // NES_EMULATOR_UNDOJOURNAL_H
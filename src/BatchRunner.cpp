@@ -0,0 +1,350 @@
+#include "BatchRunner.h"
+#include "Loader.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+namespace
+{
+    uint64_t hashMemory(const RAM &ram)
+    {
+        uint64_t hash = 0xcbf29ce484222325ULL;
+        for (size_t address = 0; address < ram.size(); address++)
+        {
+            hash ^= ram.readByte(static_cast<uint16_t>(address));
+            hash *= 0x100000001b3ULL;
+        }
+        return hash;
+    }
+
+    // Fills in errorCount and error from everything the job logged
+    void collectErrors(const std::string &log, BatchResult &result)
+    {
+        result.errorCount = static_cast<uint64_t>(std::count(log.begin(), log.end(), '\n'));
+        result.error = log.substr(0, log.find('\n'));
+    }
+
+    bool isImagePath(const std::string &path)
+    {
+        return std::filesystem::path(path).extension() == ".sccimg";
+    }
+
+    // Decimal or 0x-prefixed hex; false unless the whole string is a number
+    bool parseNumber(const std::string &text, uint64_t &value)
+    {
+        if (text.empty())
+        {
+            return false;
+        }
+        char *end = nullptr;
+        value = std::strtoull(text.c_str(), &end, 0);
+        return *end == '\0';
+    }
+
+    // Jobs with equal keys start from the same state
+    std::string prefixKey(const BatchJob &job, uint16_t end_address)
+    {
+        return job.programPath + '\n' + job.dataPath + '\n' + std::to_string(job.memorySize) + '\n' + std::to_string(end_address);
+    }
+
+    // The first slice of an optimized job. The instructions before the program's loop (or
+    // exit) only ever see the loaded state, so the first job of a batch to run them records
+    // their effect and later jobs replay it. The rest of the chunk the prefix falls in runs
+    // as runUntilHalt would run it, so idle checks land on the same instructions as in a
+    // plain run
+    RunResult startFromPrefix(const std::string &key, CPU &cpu, RAM &ram, uint16_t end_address, uint64_t budget, IdleDetector &detector,
+                              PrefixCache &prefixes, const std::ostringstream &errors, uint64_t &precomputed)
+    {
+        bool claimed = false;
+        std::shared_ptr<const PrecomputedPrefix> prefix = prefixes.find(key, claimed);
+        uint64_t chunk = std::min(detector.untilSample(), budget);
+        uint64_t ran = 0;
+        if (prefix != nullptr && prefix->instructions <= chunk)
+        {
+            applyPrefix(cpu, ram, *prefix);
+            ran = precomputed = prefix->instructions;
+        }
+        else if (claimed)
+        {
+            ProgramAnalysis analysis = analyzeProgram(cpu, ram, end_address);
+            if (!analysis.prefixPrecomputable() || analysis.prefixLength > chunk)
+            {
+                return runUntilHalt(cpu, ram, end_address, budget, detector);
+            }
+            PrecomputedPrefix captured;
+            if (capturePrefix(cpu, ram, end_address, analysis, errors, captured))
+            {
+                prefixes.store(key, captured);
+            }
+            ran = captured.instructions;
+        }
+        else
+        {
+            return runUntilHalt(cpu, ram, end_address, budget, detector);
+        }
+
+        ran += cpu.run(ram, end_address, chunk - ran);
+        if (detector.advance(ran, cpu, ram))
+        {
+            return RunResult{RunOutcome::Idle, ran};
+        }
+        RunResult rest = runUntilHalt(cpu, ram, end_address, budget - ran, detector);
+        return RunResult{rest.outcome, ran + rest.executed};
+    }
+
+    void writeJsonString(std::ostream &out, const std::string &text)
+    {
+        out << '"';
+        for (char c : text)
+        {
+            if (c == '"' || c == '\\')
+                out << '\\' << c;
+            else if (static_cast<unsigned char>(c) < 0x20)
+                out << ' ';
+            else
+                out << c;
+        }
+        out << '"';
+    }
+}
+
+BatchRunner::BatchRunner(unsigned threadCount, ExecutionEngine engine, bool optimize)
+    : threadCount(threadCount), engine(engine), optimize(optimize)
+{
+}
+
+std::vector<BatchResult> BatchRunner::run(const std::vector<BatchJob> &jobs) const
+{
+    std::vector<BatchResult> results(jobs.size());
+    PrefixCache prefixes;
+    WorkStealingPool pool(threadCount);
+    for (size_t i = 0; i < jobs.size(); i++)
+    {
+        // Each task writes only its own result slot
+        pool.submit([&, i] { results[i] = runJob(jobs[i], engine, optimize ? &prefixes : nullptr); });
+    }
+    pool.wait();
+    return results;
+}
+
+BatchResult BatchRunner::runJob(const BatchJob &job, ExecutionEngine engine, PrefixCache *prefixes)
+{
+    using Clock = std::chrono::steady_clock;
+    const Clock::time_point started = Clock::now();
+
+    BatchResult result{BatchStatus::Finished, 0, 0, 0, 0, 0, 0, 0, 0, ""};
+    std::ostringstream errors;
+    std::ostream *previousLog = errorStream;
+    setErrorLog(&errors);
+
+    RAM ram(job.memorySize, DumpMode::Disabled);
+    CPU cpu;
+    cpu.engine = engine;
+
+    uint16_t entry = 0x0000;
+    uint16_t programEnd = 0;
+    std::string loadError;
+    bool loaded;
+    if (isImagePath(job.programPath))
+    {
+        loaded = ProgramLoader::loadImage(ram, job.programPath, entry, programEnd, loadError);
+    }
+    else if (!job.cacheDir.empty() && job.dataPath != "-")
+    {
+        loaded = ProgramLoader::loadCached(ram, job.programPath, job.dataPath, job.cacheDir, entry, programEnd, loadError);
+    }
+    else
+    {
+        loaded = ProgramLoader::loadTextProgram(ram, job.programPath, programEnd, loadError) &&
+                 (job.dataPath == "-" || ProgramLoader::loadTextData(ram, job.dataPath, loadError));
+    }
+    if (!loaded)
+    {
+        setErrorLog(previousLog);
+        result.status = BatchStatus::LoadError;
+        result.errorCount = 1;
+        result.error = loadError;
+        return result;
+    }
+
+    const uint16_t end_address = job.end_address != 0 ? job.end_address : programEnd;
+    const Clock::time_point deadline = started + std::chrono::milliseconds(job.timeoutMs);
+    cpu.PC = entry;
+    IdleDetector detector;
+    RunOutcome outcome = RunOutcome::BudgetExhausted;
+
+    while (result.instructions < job.budget)
+    {
+        uint64_t sliceBudget = std::min(sliceSize, job.budget - result.instructions);
+        RunResult slice = result.instructions == 0 && prefixes != nullptr
+                              ? startFromPrefix(prefixKey(job, end_address), cpu, ram, end_address, sliceBudget, detector, *prefixes, errors,
+                                                result.precomputed)
+                              : runUntilHalt(cpu, ram, end_address, sliceBudget, detector);
+        result.instructions += slice.executed;
+        outcome = slice.outcome;
+        if (outcome != RunOutcome::BudgetExhausted || (job.timeoutMs != 0 && Clock::now() >= deadline))
+        {
+            break;
+        }
+    }
+
+    if (outcome == RunOutcome::EndReached)
+        result.status = BatchStatus::Finished;
+    else if (outcome == RunOutcome::Halted)
+        result.status = BatchStatus::Halted;
+    else if (outcome == RunOutcome::Idle)
+        result.status = BatchStatus::Idle;
+    else if (result.instructions >= job.budget)
+        result.status = BatchStatus::BudgetExhausted;
+    else
+        result.status = BatchStatus::Timeout;
+
+    setErrorLog(previousLog);
+    result.PC = cpu.PC;
+    result.SP = cpu.SP;
+    result.A = cpu.A;
+    result.memoryHash = hashMemory(ram);
+    collectErrors(errors.str(), result);
+    result.microseconds = static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - started).count());
+    return result;
+}
+
+bool BatchRunner::parseManifest(const std::string &path, const BatchJob &defaults, std::vector<BatchJob> &jobs, std::string &error)
+{
+    std::ifstream manifest(path);
+    if (!manifest.is_open())
+    {
+        error = "Error opening manifest " + path;
+        return false;
+    }
+
+    const std::filesystem::path base = std::filesystem::path(path).parent_path();
+    auto resolve = [&base](const std::string &file)
+    {
+        std::filesystem::path filePath(file);
+        return (filePath.is_absolute() ? filePath : base / filePath).string();
+    };
+
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(manifest, line))
+    {
+        lineNumber++;
+        line = line.substr(0, line.find('#'));
+        std::istringstream iss(line);
+        std::string program, data;
+        if (!(iss >> program))
+        {
+            continue; // Blank or comment
+        }
+        if (!(iss >> data))
+        {
+            error = path + ":" + std::to_string(lineNumber) + ": expected <program> <data>";
+            return false;
+        }
+
+        BatchJob job = defaults;
+        job.name = program;
+        job.programPath = resolve(program);
+        job.dataPath = data == "-" ? data : resolve(data);
+
+        std::string option;
+        while (iss >> option)
+        {
+            size_t equals = option.find('=');
+            std::string key = option.substr(0, equals);
+            std::string value = equals == std::string::npos ? "" : option.substr(equals + 1);
+            uint64_t number = 0;
+            bool valid = true;
+            if (key == "name" && !value.empty())
+                job.name = value;
+            else if (key == "end" && (valid = parseNumber(value, number) && number <= 0xFFFF))
+                job.end_address = static_cast<uint16_t>(number);
+            else if (key == "budget" && (valid = parseNumber(value, number)))
+                job.budget = number;
+            else if (key == "timeout" && (valid = parseNumber(value, number)))
+                job.timeoutMs = number;
+            else if (key == "memory" && (valid = parseNumber(value, number) && number > 0 && number <= RAM::maxSize))
+                job.memorySize = static_cast<size_t>(number);
+            else
+                valid = false;
+            if (!valid)
+            {
+                error = path + ":" + std::to_string(lineNumber) + ": bad option " + option;
+                return false;
+            }
+        }
+        jobs.push_back(job);
+    }
+    return true;
+}
+
+void BatchRunner::writeReport(std::ostream &out, const std::vector<BatchJob> &jobs, const std::vector<BatchResult> &results,
+                              unsigned threadCount, double wallSeconds)
+{
+    uint64_t totalInstructions = 0;
+    uint64_t counts[statusCount] = {};
+    for (const BatchResult &result : results)
+    {
+        totalInstructions += result.instructions;
+        counts[static_cast<int>(result.status)]++;
+    }
+
+    out << "{\n";
+    out << "  \"jobs\": " << results.size() << ",\n";
+    out << "  \"threads\": " << threadCount << ",\n";
+    out << "  \"wall_seconds\": " << wallSeconds << ",\n";
+    out << "  \"instructions\": " << totalInstructions << ",\n";
+    out << "  \"instructions_per_second\": " << (wallSeconds > 0 ? totalInstructions / wallSeconds : 0) << ",\n";
+    out << "  \"status\": {";
+    for (int status = 0; status < statusCount; status++)
+    {
+        out << (status ? ", " : "") << '"' << statusName(static_cast<BatchStatus>(status)) << "\": " << counts[status];
+    }
+    out << "},\n";
+    out << "  \"results\": [\n";
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        const BatchResult &result = results[i];
+        out << "    {\"name\": ";
+        writeJsonString(out, jobs[i].name);
+        out << ", \"status\": \"" << statusName(result.status) << '"'
+            << ", \"instructions\": " << result.instructions
+            << ", \"precomputed\": " << result.precomputed
+            << ", \"microseconds\": " << result.microseconds
+            << ", \"PC\": " << result.PC
+            << ", \"SP\": " << result.SP
+            << ", \"A\": " << static_cast<int>(result.A)
+            << ", \"memory_hash\": \"" << std::hex << std::setfill('0') << std::setw(16) << result.memoryHash << std::dec << '"'
+            << ", \"errors\": " << result.errorCount
+            << ", \"error\": ";
+        writeJsonString(out, result.error);
+        out << '}' << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    out << "  ]\n";
+    out << "}\n";
+}
+
+const char *BatchRunner::statusName(BatchStatus status)
+{
+    switch (status)
+    {
+    case BatchStatus::Finished:
+        return "finished";
+    case BatchStatus::BudgetExhausted:
+        return "budget";
+    case BatchStatus::Timeout:
+        return "timeout";
+    case BatchStatus::Halted:
+        return "halted";
+    case BatchStatus::Idle:
+        return "idle";
+    default:
+        return "load_error";
+    }
+}
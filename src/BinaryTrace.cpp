@@ -0,0 +1,253 @@
+#include "BinaryTrace.h"
+#include "Counters.h"
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cstdio>
+
+namespace
+{
+    void put(uint8_t *out, uint64_t value, int bytes)
+    {
+        for (int i = 0; i < bytes; i++)
+        {
+            out[i] = static_cast<uint8_t>(value >> (8 * i));
+        }
+    }
+
+    uint64_t get(const uint8_t *in, int bytes)
+    {
+        uint64_t value = 0;
+        for (int i = 0; i < bytes; i++)
+        {
+            value |= static_cast<uint64_t>(in[i]) << (8 * i);
+        }
+        return value;
+    }
+
+    const char *opcodeName(uint8_t opcode)
+    {
+        return CPUCounters::opcodeName(std::min<int>(opcode, CPUCounters::opcodeSlots - 1));
+    }
+
+    const char *accessName(TraceKind kind)
+    {
+        switch (kind)
+        {
+        case TraceKind::Read:
+            return "read";
+        case TraceKind::Write:
+            return "write";
+        case TraceKind::RejectedWrite:
+            return "rejected";
+        default:
+            return "unknown";
+        }
+    }
+
+    // "0x" and four hex digits
+    std::string hex16(uint16_t value)
+    {
+        char text[7];
+        std::snprintf(text, sizeof(text), "0x%04x", value);
+        return text;
+    }
+}
+
+void TraceFormat::encode(const TraceRecord &record, uint8_t *out)
+{
+    put(out, record.sequence, 8);
+    put(out + 8, record.pc, 2);
+    put(out + 10, record.address, 2);
+    out[12] = static_cast<uint8_t>(record.kind);
+    out[13] = record.value;
+    out[14] = record.A;
+    out[15] = record.status;
+}
+
+TraceRecord TraceFormat::decode(const uint8_t *in)
+{
+    return TraceRecord{get(in, 8), static_cast<uint16_t>(get(in + 8, 2)), static_cast<uint16_t>(get(in + 10, 2)),
+                       static_cast<TraceKind>(in[12]), in[13], in[14], in[15]};
+}
+
+TraceRing::TraceRing(size_t capacity)
+    : slots(std::bit_ceil(std::max<size_t>(capacity, 2))), mask(slots.size() - 1), head(0), cachedTail(0), tail(0)
+{
+}
+
+size_t TraceRing::pop(TraceRecord *out, size_t max)
+{
+    uint64_t tail = this->tail.load(std::memory_order_relaxed);
+    uint64_t head = this->head.load(std::memory_order_acquire);
+    size_t count = static_cast<size_t>(std::min<uint64_t>(head - tail, max));
+    for (size_t i = 0; i < count; i++)
+    {
+        out[i] = slots[(tail + i) & mask];
+    }
+    this->tail.store(tail + count, std::memory_order_release);
+    return count;
+}
+
+TraceWriter::TraceWriter() : stopping(false), failed(false), sequence(0), records(0), stalls(0)
+{
+}
+
+TraceWriter::~TraceWriter()
+{
+    close();
+}
+
+bool TraceWriter::open(const std::string &path, std::string &error, size_t capacity)
+{
+    close();
+    file.open(path, std::ios::binary | std::ios::trunc);
+    uint8_t header[TraceFormat::headerSize] = {};
+    put(header, TraceFormat::MAGIC, 4);
+    put(header + 4, TraceFormat::VERSION, 2);
+    put(header + 6, TraceFormat::recordSize, 2);
+    if (!file.is_open() || !file.write(reinterpret_cast<const char *>(header), sizeof(header)))
+    {
+        error = "Error: cannot write trace file " + path;
+        file.close();
+        return false;
+    }
+
+    ring = std::make_unique<TraceRing>(capacity);
+    stopping.store(false);
+    failed.store(false);
+    sequence = 0;
+    records = 0;
+    stalls = 0;
+    worker = std::thread(&TraceWriter::run, this);
+    return true;
+}
+
+bool TraceWriter::close()
+{
+    if (!worker.joinable())
+    {
+        return !failed.load();
+    }
+    stopping.store(true, std::memory_order_release);
+    worker.join();
+    file.flush();
+    bool ok = file.good() && !failed.load();
+    file.close();
+    return ok;
+}
+
+void TraceWriter::run()
+{
+    // Encode on this thread, so the CPU only copies a record into the ring
+    constexpr size_t batchSize = 4096;
+    std::vector<TraceRecord> batch(batchSize);
+    std::vector<uint8_t> bytes(batchSize * TraceFormat::recordSize);
+    while (true)
+    {
+        // Read stopping first: once it is set, every record has been pushed and the ring drains to empty
+        bool stop = stopping.load(std::memory_order_acquire);
+        size_t count = ring->pop(batch.data(), batchSize);
+        if (count > 0)
+        {
+            for (size_t i = 0; i < count; i++)
+            {
+                TraceFormat::encode(batch[i], bytes.data() + i * TraceFormat::recordSize);
+            }
+            if (!file.write(reinterpret_cast<const char *>(bytes.data()), static_cast<std::streamsize>(count * TraceFormat::recordSize)))
+            {
+                failed.store(true);
+            }
+            continue;
+        }
+        if (stop)
+        {
+            return;
+        }
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+}
+
+bool TraceReader::open(const std::string &path, std::string &error)
+{
+    file.open(path, std::ios::binary);
+    uint8_t header[TraceFormat::headerSize];
+    if (!file.is_open() || !file.read(reinterpret_cast<char *>(header), sizeof(header)))
+    {
+        error = "Error: cannot read trace file " + path;
+        return false;
+    }
+    if (get(header, 4) != TraceFormat::MAGIC || get(header + 4, 2) != TraceFormat::VERSION ||
+        get(header + 6, 2) != TraceFormat::recordSize)
+    {
+        error = "Error: " + path + " is not a version " + std::to_string(TraceFormat::VERSION) + " trace file";
+        return false;
+    }
+    partial = false;
+    return true;
+}
+
+bool TraceReader::next(TraceRecord &record)
+{
+    uint8_t bytes[TraceFormat::recordSize];
+    file.read(reinterpret_cast<char *>(bytes), sizeof(bytes));
+    if (file.gcount() != static_cast<std::streamsize>(sizeof(bytes)))
+    {
+        partial = file.gcount() != 0;
+        return false;
+    }
+    record = TraceFormat::decode(bytes);
+    return true;
+}
+
+uint64_t writeTraceText(TraceReader &reader, std::ostream &out, uint64_t limit)
+{
+    uint64_t written = 0;
+    TraceRecord record;
+    for (; written < limit && reader.next(record); written++)
+    {
+        if (record.kind == TraceKind::Instruction)
+        {
+            out << std::dec << record.sequence << ' ' << hex16(record.pc) << ' ' << opcodeName(record.value) << ' ' << hex16(record.address)
+                << " A=" << static_cast<int>(record.A) << " STATUS=" << static_cast<int>(record.status) << '\n';
+        }
+        else
+        {
+            out << "    " << accessName(record.kind) << ' ' << hex16(record.address) << " = " << std::dec << static_cast<int>(record.value)
+                << '\n';
+        }
+    }
+    return written;
+}
+
+uint64_t writeChromeTrace(TraceReader &reader, std::ostream &out, uint64_t limit)
+{
+    // Instructions are complete events on one track, accesses instant events on a second,
+    // and A a counter track
+    out << "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [\n"
+           "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": 1, \"args\": {\"name\": \"SCC\"}},\n"
+           "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": 1, \"args\": {\"name\": \"Instructions\"}},\n"
+           "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": 2, \"args\": {\"name\": \"Memory\"}}";
+    uint64_t written = 0;
+    TraceRecord record;
+    for (; written < limit && reader.next(record); written++)
+    {
+        out << std::dec;
+        if (record.kind == TraceKind::Instruction)
+        {
+            out << ",\n{\"name\": \"" << opcodeName(record.value) << "\", \"ph\": \"X\", \"ts\": " << record.sequence
+                << ", \"dur\": 1, \"pid\": 1, \"tid\": 1, \"args\": {\"pc\": \"" << hex16(record.pc) << "\", \"operand\": \""
+                << hex16(record.address) << "\", \"status\": " << static_cast<int>(record.status) << "}}";
+            out << ",\n{\"name\": \"A\", \"ph\": \"C\", \"ts\": " << record.sequence << ", \"pid\": 1, \"args\": {\"A\": "
+                << static_cast<int>(record.A) << "}}";
+        }
+        else
+        {
+            out << ",\n{\"name\": \"" << accessName(record.kind) << ' ' << hex16(record.address) << "\", \"ph\": \"i\", \"s\": \"t\", \"ts\": "
+                << record.sequence << ", \"pid\": 1, \"tid\": 2, \"args\": {\"pc\": \"" << hex16(record.pc) << "\", \"value\": "
+                << static_cast<int>(record.value) << "}}";
+        }
+    }
+    out << "\n]}\n";
+    return written;
+}
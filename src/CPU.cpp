@@ -1,16 +1,37 @@
 #include "CPU.h"
+#include "Jit.h"
+#include "Trace.h"
+#include "UndoJournal.h"
 #include <iostream>
 
-CacheRegister cache[3];
-uint16_t PC;    // 16-bit Program Counter
-uint16_t SP;    // 8-bit Stack Pointer
-uint8_t A;      // 8-bit Accumulator
+bool parseEngine(const std::string &name, ExecutionEngine &engine)
+{
+    if (name == "reference")
+        engine = ExecutionEngine::Reference;
+    else if (name == "decoded")
+        engine = ExecutionEngine::Decoded;
+    else if (name == "threaded")
+        engine = ExecutionEngine::Threaded;
+    else if (name == "jit")
+        engine = ExecutionEngine::Jit;
+    else
+        return false;
+    return true;
+}
 
 CPU::CPU()
 {
+    engine = ExecutionEngine::Decoded;
+    journal = nullptr;
+    timing = nullptr;
+    fusionProfile = nullptr;
+    tracer = nullptr;
     PC = 0;
     SP = 0x100;
     A = 0;
+    STATUS = 0;
+    flags.clear();
+    counters = CPUCounters{};
     // Constructor implementation
 }
 
@@ -19,88 +40,404 @@ CPU::~CPU()
     // Destructor implementation
 }
 
+void CPU::restore(const CPUSnapshot &snapshot)
+{
+    PC = snapshot.PC;
+    SP = snapshot.SP;
+    A = snapshot.A;
+    setStatus(snapshot.STATUS);
+    cache = snapshot.cache;
+}
+
+void CPU::storeData(RAM &ram, uint16_t address, uint8_t value)
+{
+    // Rejected writes change nothing, but journaling the unchanged byte keeps undo simple
+    if (journal != nullptr && address < ram.size())
+    {
+        journal->recordWrite(address, ram.readByte(address));
+    }
+    bool accepted = ram.writeByte(address, value);
+    countWrite(address, accepted);
+    traceAccess(accepted ? TraceKind::Write : TraceKind::RejectedWrite, address, value);
+}
+
+void CPU::storeStack(RAM &ram, uint16_t address, uint8_t value)
+{
+    if (journal != nullptr && address < ram.size())
+    {
+        journal->recordWrite(address, ram.readByte(address));
+    }
+    bool accepted = ram.writeStackByte(address, value);
+    countWrite(address, accepted);
+    traceAccess(accepted ? TraceKind::Write : TraceKind::RejectedWrite, address, value);
+}
+
 void CPU::updateCache(uint16_t location, uint8_t value)
 {
-    // Check if the location already exists in the cache
-    for (int i = 0; i < 3; i++)
+    // Write-allocate: update the line holding location, or evict one per the replacement policy
+    cache.update(location, value);
+    if constexpr (CPUCounters::enabled)
+        counters.cacheUpdates++;
+}
+
+bool CPU::getCachedValue(uint16_t location, uint8_t &value)
+{
+    // A miss is reported separately, so a cached zero is still a hit
+    bool hit = cache.lookup(location, value);
+    if constexpr (CPUCounters::enabled)
+        (hit ? counters.cacheHits : counters.cacheMisses)++;
+    if constexpr (TimingModel::enabled)
     {
-        if (cache[i].location == location)
-        {
-            // If the location exists, update its value
-            cache[i].value = value;
-            return;
-        }
+        if (timing != nullptr)
+            timing->dataAccess(hit);
     }
+    return hit;
+}
+
+void CPU::process_instructions(RAM &ram, uint16_t start_address, uint16_t end_address)
+{
+    PC = start_address;
+    STATUS &= ~haltFlag;
+    run(ram, end_address, UINT64_MAX);
+}
 
-    // If the location doesn't exist in the cache, find the cache register with the smallest location to replace
-    int mostRecentCacheRegister = 0;
-    for (int i = 0; i < 3; i++)
+uint64_t CPU::run(RAM &ram, uint16_t end_address, uint64_t budget)
+{
+    if (isHalted())
     {
-        if (cache[i].location < cache[mostRecentCacheRegister].location)
+        return 0;
+    }
+
+    // Journaling, timing and profiling need a hook around every instruction, which only the reference loop has
+    bool timed = TimingModel::enabled && timing != nullptr;
+    switch (journal != nullptr || timed || fusionProfile != nullptr ? ExecutionEngine::Reference : engine)
+    {
+    case ExecutionEngine::Decoded:
+        return run_decoded(ram, end_address, budget);
+    case ExecutionEngine::Threaded:
+        return run_threaded(ram, end_address, budget);
+    case ExecutionEngine::Jit:
+        // Compiled blocks cannot print the per-instruction trace or feed the binary one
+        if constexpr (ActiveTrace::enabled || !JitCompiler::supported)
+            return run_threaded(ram, end_address, budget);
+        else
+            return tracer != nullptr ? run_threaded(ram, end_address, budget) : run_jit(ram, end_address, budget);
+    default:
+    {
+        // Fetch-Execute Cycle
+        uint64_t executed = 0;
+        while (PC < end_address && executed < budget && !isHalted())
         {
-            mostRecentCacheRegister = i;
+            step(ram);
+            executed++;
         }
+        return executed;
+    }
+    }
+}
+
+void CPU::step(RAM &ram)
+{
+    if (journal != nullptr)
+    {
+        journal->record(*this, ram);
+    }
+
+    // Fetch 1 byte for opcode from RAM
+    uint8_t opcode = readMemory(ram, PC);
+
+    // Fetch 2 bytes for address from RAM
+    uint16_t address = 0;
+    // address |= static_cast<uint16_t>(ram.readByte(PC + 1)) << 0;
+    // address |= static_cast<uint16_t>(ram.readByte(PC + 2)) << 8;
+    address = static_cast<uint16_t>(readMemory(ram, PC + 1)) | address << 0;
+    address = static_cast<uint16_t>(readMemory(ram, PC + 2)) | address << 8;
+
+    traceFetch(opcode, address);
+    if (fusionProfile != nullptr)
+    {
+        fusionProfile->record(PC, opcode);
     }
 
-    // Update the selected cache register with the new location and value
-    cache[mostRecentCacheRegister].location = location;
-    cache[mostRecentCacheRegister].value = value;
+    // Decode and execute the instruction
+    executeInstruction(ram, opcode, address);
+    if constexpr (TimingModel::enabled)
+    {
+        if (timing != nullptr)
+            timing->retire(opcode, address);
+    }
+
+    // Move to the next instruction
+    PC += 3;
 }
 
-uint8_t CPU::getCachedValue(uint16_t location)
+uint64_t CPU::run_decoded(RAM &ram, uint16_t end_address, uint64_t budget)
 {
-    // Check if the location exists in the cache
-    for (int i = 0; i < 3; i++)
+    // Only RAM::writeInstructionByte changes code, and no instruction calls it, so one sync per run is enough
+    decoded.synchronize(ram);
+
+    uint64_t executed = 0;
+    for (; PC < end_address && executed < budget && !isHalted(); executed++)
     {
-        if (cache[i].location == location)
+        const DecodedInstruction *instruction = decoded.lookup(ram, PC);
+        if (instruction == nullptr)
+        {
+            // Outside the cacheable program region: fetch the slow way
+            step(ram);
+            continue;
+        }
+        traceFetch(instruction->opcode, instruction->operand);
+        traceExecute(instruction->operand);
+        if (instruction->pairHandler != nullptr && budget - executed >= 2 && PC + 3 < end_address)
+        {
+            // A fused pair runs both instructions in this one dispatch
+            instruction->pairHandler(*this, ram, *instruction);
+            executed++;
+        }
+        else
         {
-            // If the location exists, return its cached value
-            return cache[i].value;
+            instruction->handler(*this, ram, *instruction);
         }
+        PC += 3;
     }
+    return executed;
+}
 
-    // If the location doesn't exist in the cache, return 0 (cache miss)
-    return 0;
+uint64_t CPU::run_threaded(RAM &ram, uint16_t end_address, uint64_t budget)
+{
+#if defined(__GNUC__)
+    // Direct-threaded dispatch: every handler ends in its own indirect jump to the next
+    // handler, so the branch predictor sees one jump site per opcode instead of one switch
+    static const void *const targets[DecodeCache::targetCount] = {
+        &&op_ADC, &&op_SBC, &&op_LDA, &&op_AND, &&op_EOR, &&op_JMP, &&op_PSH, &&op_POP, &&op_HLT, &&op_NOP,
+#define SCC_FUSED_TARGET(first, second) &&fused_##first##_##second,
+        SCC_FUSED_PAIRS(SCC_FUSED_TARGET)
+#undef SCC_FUSED_TARGET
+    };
+
+    decoded.synchronize(ram);
+    const DecodedInstruction *instruction;
+    uint64_t executed = 0;
+
+#define SCC_DISPATCH()                                       \
+    do                                                       \
+    {                                                        \
+        if (PC >= end_address || executed == budget)         \
+            return executed;                                 \
+        executed++;                                          \
+        instruction = decoded.lookup(ram, PC, targets);      \
+        if (instruction == nullptr)                          \
+            goto slow_path;                                  \
+        traceFetch(instruction->opcode, instruction->operand); \
+        traceExecute(instruction->operand);                  \
+        goto *instruction->target;                           \
+    } while (0)
+
+    SCC_DISPATCH();
+
+op_ADC:
+    ADC(ram, instruction->operand);
+    PC += 3;
+    SCC_DISPATCH();
+op_SBC:
+    SBC(ram, instruction->operand);
+    PC += 3;
+    SCC_DISPATCH();
+op_LDA:
+    LDA(ram, instruction->operand);
+    PC += 3;
+    SCC_DISPATCH();
+op_AND:
+    AND(ram, instruction->operand);
+    PC += 3;
+    SCC_DISPATCH();
+op_EOR:
+    EOR(ram, instruction->operand);
+    PC += 3;
+    SCC_DISPATCH();
+op_JMP:
+    JMP(ram, instruction->operand);
+    PC += 3;
+    SCC_DISPATCH();
+op_PSH:
+    PSH(ram);
+    PC += 3;
+    SCC_DISPATCH();
+op_POP:
+    POP(ram);
+    PC += 3;
+    SCC_DISPATCH();
+op_HLT:
+    HLT();
+    PC += 3;
+    return executed;
+op_NOP:
+    NOP(instruction->opcode);
+    PC += 3;
+    SCC_DISPATCH();
+slow_path:
+    // Outside the cacheable program region: fetch the slow way
+    step(ram);
+    if (isHalted())
+        return executed;
+    SCC_DISPATCH();
+
+    // Fused pairs: one dispatch runs both instructions, and the two bodies are compiled
+    // as one block. Just the first runs when the second would pass end_address or the budget
+#define SCC_RUN_ADC(operand) ADC(ram, operand)
+#define SCC_RUN_SBC(operand) SBC(ram, operand)
+#define SCC_RUN_LDA(operand) LDA(ram, operand)
+#define SCC_RUN_AND(operand) AND(ram, operand)
+#define SCC_RUN_EOR(operand) EOR(ram, operand)
+#define SCC_RUN_JMP(operand) JMP(ram, operand)
+#define SCC_RUN_PSH(operand) PSH(ram)
+#define SCC_RUN_POP(operand) POP(ram)
+#define SCC_FUSED_HANDLER(first, second)                               \
+    fused_##first##_##second:                                          \
+    if (executed == budget || PC + 3 >= end_address)                   \
+        goto op_##first;                                               \
+    SCC_RUN_##first(instruction->operand);                             \
+    PC += 3;                                                           \
+    executed++;                                                        \
+    traceFetch(instruction->nextOpcode, instruction->nextOperand);     \
+    traceExecute(instruction->nextOperand);                            \
+    SCC_RUN_##second(instruction->nextOperand);                        \
+    PC += 3;                                                           \
+    SCC_DISPATCH();
+
+    SCC_FUSED_PAIRS(SCC_FUSED_HANDLER)
+
+#undef SCC_FUSED_HANDLER
+#undef SCC_RUN_ADC
+#undef SCC_RUN_SBC
+#undef SCC_RUN_LDA
+#undef SCC_RUN_AND
+#undef SCC_RUN_EOR
+#undef SCC_RUN_JMP
+#undef SCC_RUN_PSH
+#undef SCC_RUN_POP
+#undef SCC_DISPATCH
+#else
+    // Portable fallback: call through the decoded handler table
+    return run_decoded(ram, end_address, budget);
+#endif
 }
 
-void CPU::process_instructions(RAM &ram, uint16_t start_address, uint16_t end_address)
+bool CPU::cacheMatchesRAM(const RAM &ram) const
 {
-    PC = start_address;
+    bool matches = true;
+    cache.forEachValid([&](uint32_t address, uint8_t value)
+    {
+        matches = matches && address >= 0x200 && address < ram.size() && ram.getPageKind(static_cast<uint16_t>(address)) == PageKind::RAM &&
+                  ram.readByte(static_cast<uint16_t>(address)) == value;
+    });
+    return matches;
+}
 
-    // Fetch-Execute Cycle
-    while (PC < end_address)
+uint64_t CPU::run_jit(RAM &ram, uint16_t end_address, uint64_t budget)
+{
+    if (!jit)
+    {
+        jit = std::make_unique<JitCompiler>();
+    }
+    jit->synchronize(ram);
+
+    // Compiled code reads RAM where the interpreter would hit the cache, which is only
+    // equivalent while the cache holds nothing but current copies of data bytes. Blocks
+    // keep that true (their stores invalidate the lines), interpreted steps may not.
+    bool coherent = cacheMatchesRAM(ram);
+    JitRegisters registers;
+    uint64_t executed = 0;
+    while (PC < end_address && executed < budget && !isHalted())
     {
-        // Fetch 1 byte for opcode from RAM
-        uint8_t opcode = ram.readByte(PC);
+        const JitBlock *block = coherent ? jit->lookup(ram, PC) : nullptr;
+        size_t length = block != nullptr ? block->opcodes.size() : 0;
+        if (block == nullptr || block->highestPC >= end_address || budget - executed < length)
+        {
+            step(ram);
+            executed++;
+            coherent = cacheMatchesRAM(ram);
+            continue;
+        }
+
+        registers = JitRegisters{PC, SP, A, flags};
+        uint64_t count = block->code(ram.pageData(0x100), &registers, (budget - executed) / length);
+        PC = registers.PC;
+        SP = registers.SP;
+        A = registers.A;
+        flags = registers.flags;
+        executed += count;
 
-        // Fetch 2 bytes for address from RAM
-        uint16_t address = 0;
-        // address |= static_cast<uint16_t>(ram.readByte(PC + 1)) << 0;
-        // address |= static_cast<uint16_t>(ram.readByte(PC + 2)) << 8;
-        address = static_cast<uint16_t>(ram.readByte(PC + 1)) | address << 0;
-        address = static_cast<uint16_t>(ram.readByte(PC + 2)) | address << 8;
+        for (uint16_t address : block->dataWrites)
+        {
+            cache.invalidate(address);
+            ram.markStored(address, 1);
+        }
+        if (block->writesStack)
+        {
+            ram.markStored(0x100, 0x100);
+        }
+        if constexpr (CPUCounters::enabled)
+        {
+            // Every completed pass ran the whole block; a side exit stops partway through
+            for (size_t index = 0; index < length; index++)
+            {
+                uint64_t times = count / length + (index < count % length ? 1 : 0);
+                uint8_t opcode = block->opcodes[index];
+                counters.executed[DecodeCache::opcodeIndex(opcode)] += times;
+                if (opcode <= 0b0100)
+                    counters.reads[static_cast<int>(MemoryRegion::Data)] += times;
+                if (opcode <= 0b0001)
+                    counters.writes[static_cast<int>(MemoryRegion::Data)] += times;
+                else if (opcode == 0b0110)
+                    counters.writes[static_cast<int>(MemoryRegion::Stack)] += times;
+                else if (opcode == 0b0111)
+                    counters.reads[static_cast<int>(MemoryRegion::Stack)] += times;
+            }
+        }
+        if (count == 0)
+        {
+            // Side exit before the first instruction: let the interpreter report it
+            step(ram);
+            executed++;
+            coherent = cacheMatchesRAM(ram);
+        }
+    }
+    return executed;
+}
 
+void CPU::traceFetch(uint8_t opcode, uint16_t address)
+{
+    if constexpr (TraceWriter::enabled)
+    {
+        if (tracer != nullptr)
+            tracer->instruction(PC, opcode, address, A, getStatus());
+    }
+    if constexpr (ActiveTrace::enabled)
+    {
         std::cout << "Opcode: 0x" << std::hex << static_cast<int>(opcode) << ", Address: 0x" << address << std::endl;
+    }
+}
 
-        // Decode and execute the instruction
-        executeInstruction(ram, opcode, address);
+void CPU::traceExecute(uint16_t address)
+{
+    if constexpr (ActiveTrace::enabled)
+    {
+        std::cout << "Executing CPU instruction: < ";
 
-        // Move to the next instruction
-        PC += 3;
+        // Print the instruction in binary
+        for (int i = 15; i >= 0; --i)
+        {
+            std::cout << ((address >> i) & 1);
+        }
+        std::cout << " >";
+        std::cout << std::endl;
     }
 }
 
 void CPU::executeInstruction(RAM &ram, uint8_t opcode, uint16_t address)
 {
-    std::cout << "Executing CPU instruction: < ";
-
-    // Print the instruction in binary
-    for (int i = 15; i >= 0; --i)
-    {
-        std::cout << ((address >> i) & 1);
-    }
-     std::cout << " >";
-    std::cout << std::endl;
+    traceExecute(address);
 
     // Execute instructions based on the opcode
     switch (opcode)
@@ -129,131 +466,190 @@ void CPU::executeInstruction(RAM &ram, uint8_t opcode, uint16_t address)
     case 0b0111: // Handle instructions with opcode starting with '0111'
         POP(ram);
         break;
+    case 0b1000:
+        HLT();
+        break;
     default:
-        std::cerr << "NOP Unsupported opcode: " << std::bitset<3>(opcode) << std::endl;
-        // Handle unsupported opcode
+        NOP(opcode);
         break;
     }
-
-   
 }
 
 void CPU::ADC(RAM &ram, uint16_t address)
 {
-    uint8_t value = getCachedValue(address);
-    if (value == 0)
+    countOpcode(0b0000);
+    uint8_t value;
+    if (!getCachedValue(address, value))
     {
-        value = ram.readByte(address); // Reading the value from memory at the specified address
+        value = readMemory(ram, address); // Cache miss: read the value from memory at the specified address
     }
+    traceAccess(TraceKind::Read, address, value);
 
     // Adding the value to the accumulator
-    // Note: This addition might cause overflow, and the carry flag should be considered.
-    uint8_t result = A + value; 
+    uint8_t result = A + value;
+    flags.arithmetic(LazyFlags::Add, A, value, result);
 
     // Writing the result back to memory at the same address
-    ram.writeByte(address, result & 0xFF);
+    storeData(ram, address, result & 0xFF);
     updateCache(address, result & 0xFF);
     // Displaying the operation
-    std::cout << "ADC instruction executed. Result stored at memory address: " << std::hex << static_cast<int>(address) << std::endl;
+    if constexpr (ActiveTrace::enabled)
+    {
+        std::cout << "ADC instruction executed. Result stored at memory address: " << std::hex << static_cast<int>(address) << std::endl;
+    }
 }
 
 void CPU::SBC(RAM &ram, uint16_t address)
 {
-    uint8_t value = getCachedValue(address);
-    if (value == 0)
+    countOpcode(0b0001);
+    uint8_t value;
+    if (!getCachedValue(address, value))
     {
-        value = ram.readByte(address); // Reading the value from memory at the specified address
+        value = readMemory(ram, address); // Cache miss: read the value from memory at the specified address
     }
+    traceAccess(TraceKind::Read, address, value);
 
-    // Subtracting the value from the accumulator, considering the carry flag
-    uint8_t result = value - A ; 
+    // Subtracting the accumulator from the value
+    uint8_t result = value - A;
+    flags.arithmetic(LazyFlags::Subtract, value, A, result);
 
     // Writing the result back to memory at the same address
-    ram.writeByte(address, result & 0xFF);
+    storeData(ram, address, result & 0xFF);
     updateCache(address, result & 0xFF);
 
     // Displaying the operation
-    std::cout << "SBC instruction executed. Result stored at memory address: " << std::hex << static_cast<int>(address) << std::endl;
+    if constexpr (ActiveTrace::enabled)
+    {
+        std::cout << "SBC instruction executed. Result stored at memory address: " << std::hex << static_cast<int>(address) << std::endl;
+    }
 }
 
 void CPU::LDA(RAM &ram, uint16_t address)
 {
-    uint8_t value = getCachedValue(address);
-    if (value == 0)
+    countOpcode(0b0010);
+    uint8_t value;
+    if (!getCachedValue(address, value))
     {
-        value = ram.readByte(address); // Reading the value from memory at the specified address
+        value = readMemory(ram, address); // Cache miss: read the value from memory at the specified address
     }
+    traceAccess(TraceKind::Read, address, value);
 
     // Loading the value into the accumulator (A register)
     A = value;
+    flags.logic(A);
 
     updateCache(address, value);
 
     // Displaying the operation
-    std::cout << "LDA instruction executed. Value loaded into accumulator (A): " << std::hex << static_cast<int>(A) << std::endl;
+    if constexpr (ActiveTrace::enabled)
+    {
+        std::cout << "LDA instruction executed. Value loaded into accumulator (A): " << std::hex << static_cast<int>(A) << std::endl;
+    }
 }
 
 void CPU::AND(RAM &ram, uint16_t address)
 {
-    uint8_t value = getCachedValue(address);
-    if (value == 0)
+    countOpcode(0b0011);
+    uint8_t value;
+    if (!getCachedValue(address, value))
     {
-        value = ram.readByte(address); // Reading the value from memory at the specified address
+        value = readMemory(ram, address); // Cache miss: read the value from memory at the specified address
     }
+    traceAccess(TraceKind::Read, address, value);
     updateCache(address, value);
 
     // Performing bitwise AND operation between the accumulator (A) and the value
     A &= value;
+    flags.logic(A);
 
     // Displaying the operation
-    std::cout << "AND instruction executed. Result stored in accumulator (A): " << std::hex << static_cast<int>(A) << std::endl;
+    if constexpr (ActiveTrace::enabled)
+    {
+        std::cout << "AND instruction executed. Result stored in accumulator (A): " << std::hex << static_cast<int>(A) << std::endl;
+    }
 }
 
 void CPU::EOR(RAM &ram, uint16_t address)
 {
-    uint8_t value = getCachedValue(address);
-    if (value == 0)
+    countOpcode(0b0100);
+    uint8_t value;
+    if (!getCachedValue(address, value))
     {
-        value = ram.readByte(address); // Reading the value from memory at the specified address
+        value = readMemory(ram, address); // Cache miss: read the value from memory at the specified address
     }
+    traceAccess(TraceKind::Read, address, value);
 
     // Performing bitwise XOR (Exclusive OR) operation between the accumulator (A) and the value
     A ^= value;
+    flags.logic(A);
 
         // Displaying the operation
-    std::cout << "EOR instruction executed. Result stored in accumulator (A): " << std::hex << static_cast<int>(A) << std::endl;
+    if constexpr (ActiveTrace::enabled)
+    {
+        std::cout << "EOR instruction executed. Result stored in accumulator (A): " << std::hex << static_cast<int>(A) << std::endl;
+    }
 }
 
 void CPU::JMP(RAM &ram, uint16_t address)
 {
+    countOpcode(0b0101);
     // Set the program counter (PC) to the extracted address
     PC = address;
 
     // Displaying the operation
-    std::cout << "JMP instruction executed. Jumping to address: " << std::hex << static_cast<int>(address) << std::endl;
+    if constexpr (ActiveTrace::enabled)
+    {
+        std::cout << "JMP instruction executed. Jumping to address: " << std::hex << static_cast<int>(address) << std::endl;
+    }
 }
 
 void CPU::PSH(RAM &ram)
 {
+    countOpcode(0b0110);
     // Write the accumulator (A) value to the stack at memory location SP
-    ram.writeStackByte(SP, A);
+    storeStack(ram, SP, A);
 
     // Increment the stack pointer (SP)
     SP++;
 
     // Displaying the operation
-    std::cout << "PSH instruction executed. Accumulator value pushed onto stack." << std::endl;
+    if constexpr (ActiveTrace::enabled)
+    {
+        std::cout << "PSH instruction executed. Accumulator value pushed onto stack." << std::endl;
+    }
 }
 
 void CPU::POP(RAM &ram)
 {
+    countOpcode(0b0111);
     // Decrement the stack pointer (SP)
     SP--;
 
     // Read the value from the stack at memory location SP into the accumulator (A)
-    A = ram.readByte(SP);
+    A = readMemory(ram, SP);
+    flags.logic(A);
+    traceAccess(TraceKind::Read, SP, A);
 
     // Displaying the operation
-    std::cout << "POP instruction executed. Accumulator value popped from stack." << std::endl;
+    if constexpr (ActiveTrace::enabled)
+    {
+        std::cout << "POP instruction executed. Accumulator value popped from stack." << std::endl;
+    }
 }
 
+void CPU::HLT()
+{
+    countOpcode(0b1000);
+    STATUS |= haltFlag;
+    if constexpr (ActiveTrace::enabled)
+    {
+        std::cout << "HLT instruction executed. CPU halted." << std::endl;
+    }
+}
+
+void CPU::NOP(uint8_t opcode)
+{
+    countOpcode(opcode);
+    // Handle unsupported opcode
+    errorLog() << "NOP Unsupported opcode: " << std::bitset<3>(opcode) << std::endl;
+}
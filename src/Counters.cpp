@@ -0,0 +1,52 @@
+#include "Counters.h"
+
+uint64_t CPUCounters::instructions() const
+{
+    uint64_t total = 0;
+    for (uint64_t count : executed)
+    {
+        total += count;
+    }
+    return total;
+}
+
+void CPUCounters::writeJson(std::ostream &out) const
+{
+    out << "{\"instructions\": " << std::dec << instructions() << ", \"opcodes\": {";
+    for (int slot = 0; slot < opcodeSlots; slot++)
+    {
+        out << (slot ? ", " : "") << '"' << opcodeName(slot) << "\": " << executed[slot];
+    }
+    out << "}, \"cache\": {\"hits\": " << cacheHits << ", \"misses\": " << cacheMisses << ", \"updates\": " << cacheUpdates << "}";
+    const char *directions[] = {"reads", "writes"};
+    for (int direction = 0; direction < 2; direction++)
+    {
+        const uint64_t *counts = direction == 0 ? reads : writes;
+        out << ", \"" << directions[direction] << "\": {";
+        for (int region = 0; region < regionCount; region++)
+        {
+            out << (region ? ", " : "") << '"' << regionName(static_cast<MemoryRegion>(region)) << "\": " << counts[region];
+        }
+        out << "}";
+    }
+    out << ", \"rejected_writes\": " << rejectedWrites << "}";
+}
+
+const char *CPUCounters::opcodeName(int slot)
+{
+    static const char *const names[opcodeSlots] = {"ADC", "SBC", "LDA", "AND", "EOR", "JMP", "PSH", "POP", "HLT", "unsupported"};
+    return slot >= 0 && slot < opcodeSlots ? names[slot] : "unsupported";
+}
+
+const char *CPUCounters::regionName(MemoryRegion region)
+{
+    switch (region)
+    {
+    case MemoryRegion::Instruction:
+        return "instruction";
+    case MemoryRegion::Stack:
+        return "stack";
+    default:
+        return "data";
+    }
+}
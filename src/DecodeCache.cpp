@@ -0,0 +1,171 @@
+#include "DecodeCache.h"
+#include "CPU.h"
+
+namespace
+{
+    void executeADC(CPU &cpu, RAM &ram, const DecodedInstruction &instruction) { cpu.ADC(ram, instruction.operand); }
+    void executeSBC(CPU &cpu, RAM &ram, const DecodedInstruction &instruction) { cpu.SBC(ram, instruction.operand); }
+    void executeLDA(CPU &cpu, RAM &ram, const DecodedInstruction &instruction) { cpu.LDA(ram, instruction.operand); }
+    void executeAND(CPU &cpu, RAM &ram, const DecodedInstruction &instruction) { cpu.AND(ram, instruction.operand); }
+    void executeEOR(CPU &cpu, RAM &ram, const DecodedInstruction &instruction) { cpu.EOR(ram, instruction.operand); }
+    void executeJMP(CPU &cpu, RAM &ram, const DecodedInstruction &instruction) { cpu.JMP(ram, instruction.operand); }
+    void executePSH(CPU &cpu, RAM &ram, const DecodedInstruction &) { cpu.PSH(ram); }
+    void executePOP(CPU &cpu, RAM &ram, const DecodedInstruction &) { cpu.POP(ram); }
+    void executeHLT(CPU &cpu, RAM &, const DecodedInstruction &) { cpu.HLT(); }
+    void executeNOP(CPU &cpu, RAM &, const DecodedInstruction &instruction) { cpu.NOP(instruction.opcode); }
+
+    template <uint8_t Opcode>
+    void executeOne(CPU &cpu, RAM &ram, uint16_t operand)
+    {
+        if constexpr (Opcode == opcodes::ADC)
+            cpu.ADC(ram, operand);
+        else if constexpr (Opcode == opcodes::SBC)
+            cpu.SBC(ram, operand);
+        else if constexpr (Opcode == opcodes::LDA)
+            cpu.LDA(ram, operand);
+        else if constexpr (Opcode == opcodes::AND)
+            cpu.AND(ram, operand);
+        else if constexpr (Opcode == opcodes::EOR)
+            cpu.EOR(ram, operand);
+        else if constexpr (Opcode == opcodes::JMP)
+            cpu.JMP(ram, operand);
+        else if constexpr (Opcode == opcodes::PSH)
+            cpu.PSH(ram);
+        else
+            cpu.POP(ram);
+    }
+
+    // Both instructions inline into one handler. PC is left on the second, as if it had been dispatched
+    template <uint8_t First, uint8_t Second>
+    void executePair(CPU &cpu, RAM &ram, const DecodedInstruction &instruction)
+    {
+        executeOne<First>(cpu, ram, instruction.operand);
+        cpu.PC += 3;
+        cpu.traceFetch(instruction.nextOpcode, instruction.nextOperand);
+        cpu.traceExecute(instruction.nextOperand);
+        executeOne<Second>(cpu, ram, instruction.nextOperand);
+    }
+
+    const DecodedInstruction::Handler pairHandlers[fusedPairCount] = {
+#define SCC_PAIR_HANDLER(first, second) executePair<opcodes::first, opcodes::second>,
+        SCC_FUSED_PAIRS(SCC_PAIR_HANDLER)
+#undef SCC_PAIR_HANDLER
+    };
+}
+
+DecodeCache::DecodeCache() : fusion(FusionTable::all()), ramId(0), seenCodeWrites(0)
+{
+    invalidateAll();
+}
+
+DecodedInstruction::Handler DecodeCache::handlerFor(uint8_t opcode)
+{
+    switch (opcode)
+    {
+    case 0b0000:
+        return executeADC;
+    case 0b0001:
+        return executeSBC;
+    case 0b0010:
+        return executeLDA;
+    case 0b0011:
+        return executeAND;
+    case 0b0100:
+        return executeEOR;
+    case 0b0101:
+        return executeJMP;
+    case 0b0110:
+        return executePSH;
+    case 0b0111:
+        return executePOP;
+    case 0b1000:
+        return executeHLT;
+    default:
+        return executeNOP;
+    }
+}
+
+DecodedInstruction::Handler DecodeCache::pairHandlerFor(int pair)
+{
+    return pair >= 0 && pair < fusedPairCount ? pairHandlers[pair] : nullptr;
+}
+
+void DecodeCache::setFusion(const FusionTable &table)
+{
+    fusion = table;
+    invalidateAll();
+}
+
+void DecodeCache::synchronize(const RAM &ram)
+{
+    uint64_t codeWrites = ram.getCodeWriteCount();
+    if (ram.getId() != ramId || codeWrites - seenCodeWrites > RAM::codeWriteLogSize)
+    {
+        // Different RAM, or more writes than the log remembers
+        invalidateAll();
+    }
+    else
+    {
+        for (uint64_t i = seenCodeWrites; i < codeWrites; i++)
+        {
+            invalidate(ram.getCodeWrite(i));
+        }
+    }
+    ramId = ram.getId();
+    seenCodeWrites = codeWrites;
+}
+
+void DecodeCache::decode(const RAM &ram, uint16_t pc, const void *const *targets)
+{
+    DecodedInstruction &entry = entries[pc];
+    if (entry.handler == nullptr)
+    {
+        entry.opcode = ram.readByte(pc);
+        entry.operand = static_cast<uint16_t>(ram.readByte(pc + 1) << 8 | ram.readByte(pc + 2));
+        entry.handler = handlerFor(entry.opcode);
+        entry.target = nullptr;
+
+        // Fuse with the next instruction when it is in the cacheable region too
+        entry.fused = -1;
+        if (pc + 3 <= programSize - 3)
+        {
+            entry.nextOpcode = ram.readByte(pc + 3);
+            entry.nextOperand = static_cast<uint16_t>(ram.readByte(pc + 4) << 8 | ram.readByte(pc + 5));
+            int pair = fusedPairIndex(entry.opcode, entry.nextOpcode);
+            entry.fused = static_cast<int8_t>(fusion.allows(pair) ? pair : -1);
+        }
+        entry.pairHandler = pairHandlerFor(entry.fused);
+    }
+    if (targets != nullptr && entry.target == nullptr)
+    {
+        entry.target = targets[entry.fused >= 0 ? opcodeCount + entry.fused : opcodeIndex(entry.opcode)];
+    }
+}
+
+void DecodeCache::invalidate(uint16_t address)
+{
+    // Every instruction whose three bytes cover the written address, or whose fused successor's do
+    for (int pc = static_cast<int>(address) - 5; pc <= address; pc++)
+    {
+        if (pc >= 0 && pc < programSize)
+        {
+            entries[pc].handler = nullptr;
+            entries[pc].target = nullptr;
+        }
+    }
+}
+
+void DecodeCache::invalidateAll()
+{
+    for (DecodedInstruction &entry : entries)
+    {
+        entry.handler = nullptr;
+        entry.pairHandler = nullptr;
+        entry.target = nullptr;
+        entry.operand = 0;
+        entry.nextOperand = 0;
+        entry.opcode = 0;
+        entry.nextOpcode = 0;
+        entry.fused = -1;
+    }
+}
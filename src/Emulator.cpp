@@ -1,10 +1,171 @@
 #include "Emulator.h"
 
-int main()
+int main(int argc, char *argv[])
 {
-    // Instantiate the classes
+    // Optional command line:
+    //   --shm <name>       publish RAM to /dev/shm/<name> for scc_view
+    //   --engine <name>    reference, decoded or threaded interpreter core, or jit
+    //   --cache-policy <p> lru, fifo, random or plru data cache replacement
+    //   --image <file>     load a binary program image instead of instructions.txt and data.txt
+    //   --counters <file>  write the CPU's execution counters to file as JSON on exit
+    //   --native <file>    run a program translated and compiled by scc_translate
+    //   --memory <bytes>   size of the address space, up to 65536 (default 2048)
+    //   --timing <file>    write cycles, CPI and stalls from the timing model as JSON (EMULATOR_TIMING builds)
+    //   --timing-config <latencies>  e.g. fetch=1,decode=1,execute=1,hit=1,miss=10,hazard=2
+    //   --cores <n>        run n cores on their own threads against one RAM (see MultiCore.h)
+    //   --entries <list>   comma-separated start address per core (default: every core at the entry)
+    //   --budget <n>       instructions per core in multi-core runs (default: unlimited)
+    //   --coherence <file> write per-core coherence traffic as JSON after a multi-core run
+    //   --fusion <table>   all (default), none, or a profile file: fuse the pairs it shows at least 1% of the time
+    //   --fusion-profile <file>  count fall-through instruction pairs (runs the reference engine) and write them to file
+    //   --trace <file>     record every instruction and data access to a binary trace (decode with scc_trace)
+    //   --dump <mode>      RAM.txt: interval (default), immediate (every store), manual (on exit) or off
+    std::string sharedName;
+    std::string nativePath;
+    std::string imagePath;
+    std::string countersPath;
+    std::string timingPath;
+    std::string tracePath;
+    TimingConfig timingConfig;
+    size_t coreCount = 0;
+    std::string entryList;
+    uint64_t coreBudget = UINT64_MAX;
+    std::string coherencePath;
+    std::string fusionName = "all";
+    std::string fusionProfilePath;
+    DumpMode dumpMode = DumpMode::Interval;
+    ExecutionEngine engine = ExecutionEngine::Threaded;
+    ReplacementPolicy cachePolicy = ReplacementPolicy::LRU;
+    size_t memorySize = RAM::defaultSize;
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "--shm" && i + 1 < argc)
+        {
+            sharedName = argv[++i];
+        }
+        else if (arg == "--image" && i + 1 < argc)
+        {
+            imagePath = argv[++i];
+        }
+        else if (arg == "--counters" && i + 1 < argc)
+        {
+            countersPath = argv[++i];
+        }
+        else if (arg == "--timing" && i + 1 < argc)
+        {
+            timingPath = argv[++i];
+        }
+        else if (arg == "--timing-config" && i + 1 < argc && parseTimingConfig(argv[i + 1], timingConfig))
+        {
+            i++;
+        }
+        else if (arg == "--cores" && i + 1 < argc)
+        {
+            coreCount = static_cast<size_t>(std::strtoull(argv[++i], nullptr, 0));
+        }
+        else if (arg == "--entries" && i + 1 < argc)
+        {
+            entryList = argv[++i];
+        }
+        else if (arg == "--budget" && i + 1 < argc)
+        {
+            coreBudget = std::strtoull(argv[++i], nullptr, 0);
+        }
+        else if (arg == "--coherence" && i + 1 < argc)
+        {
+            coherencePath = argv[++i];
+        }
+        else if (arg == "--fusion" && i + 1 < argc)
+        {
+            fusionName = argv[++i];
+        }
+        else if (arg == "--fusion-profile" && i + 1 < argc)
+        {
+            fusionProfilePath = argv[++i];
+        }
+        else if (arg == "--native" && i + 1 < argc)
+        {
+            nativePath = argv[++i];
+        }
+        else if (arg == "--memory" && i + 1 < argc)
+        {
+            // RAM caps it at the 16-bit address space
+            memorySize = static_cast<size_t>(std::strtoull(argv[++i], nullptr, 0));
+        }
+        else if (arg == "--engine" && i + 1 < argc && parseEngine(argv[i + 1], engine))
+        {
+            i++;
+        }
+        else if (arg == "--cache-policy" && i + 1 < argc && parseReplacementPolicy(argv[i + 1], cachePolicy))
+        {
+            i++;
+        }
+        else if (arg == "--trace" && i + 1 < argc)
+        {
+            tracePath = argv[++i];
+        }
+        else if (arg == "--dump" && i + 1 < argc && parseDumpMode(argv[i + 1], dumpMode))
+        {
+            i++;
+        }
+        else
+        {
+            std::cerr << "Usage: SCC [--shm name] [--engine reference|decoded|threaded|jit] [--cache-policy lru|fifo|random|plru]"
+                         " [--image file] [--counters file] [--native file] [--memory bytes] [--timing file] [--timing-config latencies]"
+                         " [--cores n] [--entries list] [--budget n] [--coherence file] [--fusion all|none|profile] [--fusion-profile file]"
+                         " [--trace file] [--dump interval|immediate|manual|off]"
+                      << std::endl;
+            return 1;
+        }
+    }
+    if (!timingPath.empty() && (!TimingModel::enabled || !nativePath.empty() || coreCount > 0))
+    {
+        std::cerr << (TimingModel::enabled ? "Translated and multi-core programs cannot be timed." : "SCC was built without EMULATOR_TIMING.") << std::endl;
+        return 1;
+    }
+    if (!tracePath.empty() && (!TraceWriter::enabled || !nativePath.empty() || coreCount > 0))
+    {
+        std::cerr << (TraceWriter::enabled ? "Translated and multi-core programs cannot be traced." : "SCC was built without EMULATOR_BINARY_TRACE.")
+                  << std::endl;
+        return 1;
+    }
+
+    // Instantiate the classes. The live viewer replaces RAM.txt, so shared runs skip the text dump
     CPU cpu;
-    RAM ram;
+    cpu.engine = engine;
+    cpu.cache.setPolicy(cachePolicy);
+    TimingModel timing(timingConfig);
+    if (!timingPath.empty())
+    {
+        cpu.timing = &timing;
+    }
+    if (fusionName == "none")
+    {
+        cpu.decoded.setFusion(FusionTable::none());
+    }
+    else if (fusionName != "all")
+    {
+        std::ifstream profileFile(fusionName);
+        FusionProfile profile{};
+        std::string profileError = "Cannot open fusion profile " + fusionName;
+        if (!profileFile.is_open() || !profile.read(profileFile, profileError))
+        {
+            std::cerr << profileError << std::endl;
+            return 1;
+        }
+        cpu.decoded.setFusion(FusionTable::fromProfile(profile));
+    }
+    FusionProfile fusionProfile{};
+    if (!fusionProfilePath.empty())
+    {
+        cpu.fusionProfile = &fusionProfile;
+    }
+    RAM ram(memorySize, sharedName.empty() ? dumpMode : DumpMode::Disabled);
+    if (!sharedName.empty() && !ram.mapShared(sharedName))
+    {
+        return 1;
+    }
 
     // 0. Redirect errors to log
     std::ofstream errorFile("error.log", std::ofstream::out | std::ofstream::trunc);
@@ -17,87 +178,110 @@ int main()
     }
 
     // Redirect cerr to error file
-    std::cerr.rdbuf(errorFile.rdbuf());
+    std::streambuf *cerrBuffer = std::cerr.rdbuf(errorFile.rdbuf());
 
     // 1. Load program into memory
-    std::ifstream inputFile("instructions.txt");
-    // Check if the file is open
-    if (!inputFile.is_open())
+    uint16_t entry = 0x0000;
+    uint16_t end_address = 0;
+    std::string loadError;
+    bool loaded = imagePath.empty()
+                      ? ProgramLoader::loadTextProgram(ram, "instructions.txt", end_address, loadError) &&
+                            ProgramLoader::loadTextData(ram, "data.txt", loadError)
+                      : ProgramLoader::loadImage(ram, imagePath, entry, end_address, loadError);
+    TranslatedProgram native;
+    if (loaded && !nativePath.empty())
     {
-        std::cerr << "Error opening the file." << std::endl;
-        return 1;
+        loaded = native.load(nativePath, loadError);
     }
-    // Read the file line by line
-    std::string line;
-    uint16_t address = 0x0000;
-    while (std::getline(inputFile, line))
+    if (!loaded)
     {
-        std::istringstream iss(line);
-        // Keep reading 5 characters (bits) until the end of the line
-        for (int j = 0; j < 3; ++j)
-        {
-            uint8_t byteValue = 0;
+        std::cerr << loadError << std::endl;
+        return 1;
+    }
 
-            for (int i = 0; i < 8; ++i)
-            {
-                char bitChar;
-                if (!(iss >> bitChar))
-                {
-                    std::cerr << "Error: Insufficient bits in the line." << std::endl;
-                    return 1;
-                }
-                // Check if the character is a binary value (0 or 1)
-                if (bitChar != '0' && bitChar != '1')
-                {
-                    std::cerr << "Error: Non-binary character found in the line." << std::endl;
-                    return 1;
-                }
-                // Set the corresponding bit in the byteValue
-                byteValue |= (bitChar == '1') << (7 - i);
-            }
+    // ram.dump_memory_at_address(0x0000, std::cout);
+    // ram.dump_memory_at_address(0x0200, std::cout);
 
-            // Write the byte to RAM
-            ram.writeInstructionByte(address, byteValue);
-            // Increment the address for the next byte
-            ++address;
+    // 2. CPU starts reading/executing instructions from program space. It runs until a HLT,
+    // the end of the program or a loop that can never reach a new state
+    cpu.PC = entry;
+    if (coreCount > 0)
+    {
+        MultiCore machine(ram, coreCount);
+        std::istringstream entries(entryList);
+        std::string field;
+        for (size_t index = 0; index < coreCount; index++)
+        {
+            bool listed = static_cast<bool>(std::getline(entries, field, ','));
+            machine.core(index).PC = listed ? static_cast<uint16_t>(std::strtoul(field.c_str(), nullptr, 0)) : entry;
+        }
+        MultiCoreReport report;
+        std::string runError;
+        if (!machine.run(end_address, coreBudget, report, runError))
+        {
+            std::cerr << runError << std::endl;
+        }
+        else if (!coherencePath.empty())
+        {
+            std::ofstream coherenceFile(coherencePath, std::ofstream::out | std::ofstream::trunc);
+            report.writeJson(coherenceFile);
+            coherenceFile << std::endl;
         }
     }
-
-    // Read Data
-    std::ifstream inputDataFile("data.txt");
-    // Check if the file is open
-    if (!inputDataFile.is_open())
+    else if (native.isLoaded())
     {
-        std::cerr << "Error opening the file." << std::endl;
-        return 1;
+        native.run(cpu, ram, end_address, UINT64_MAX);
     }
-    // Read the file line by line
-    line;
-    address = 0x0200;
-
-    while (std::getline(inputDataFile, line))
+    else
     {
-        std::istringstream iss(line);
-        uint8_t byteValue;
-
-        // Keep reading bytes until the end of the line
-        while (iss >> std::hex >> byteValue)
+        TraceWriter tracer;
+        if (!tracePath.empty())
         {
-            // Write the byte to RAM
-            ram.writeByte(address, byteValue);
-
-            // Increment the address for the next byte
-            ++address;
+            std::string traceError;
+            if (!tracer.open(tracePath, traceError))
+            {
+                std::cerr << traceError << std::endl;
+                return 1;
+            }
+            cpu.tracer = &tracer;
+        }
+        IdleDetector detector;
+        RunResult result = runUntilHalt(cpu, ram, end_address, UINT64_MAX, detector);
+        cpu.tracer = nullptr;
+        if (!tracePath.empty() && !tracer.close())
+        {
+            std::cerr << "Error writing trace file " << tracePath << std::endl;
+        }
+        if (result.outcome == RunOutcome::Idle)
+        {
+            std::cout << "Idle loop at PC 0x" << std::hex << cpu.PC << std::dec << " after " << result.executed
+                      << " instructions; stopping." << std::endl;
         }
     }
 
-    // ram.dump_memory_at_address(0x0000, std::cout);
-    // ram.dump_memory_at_address(0x0200, std::cout);
-
-    // 2. CPU starts reading/executing instructions from program space
-    cpu.process_instructions(ram, 0x0000, 0x001C);
-
-    // 3. Program Terminates when instructions run out
+    // 3. Program Terminates when instructions run out, it halts or it idles
+    if (!countersPath.empty())
+    {
+        std::ofstream countersFile(countersPath, std::ofstream::out | std::ofstream::trunc);
+        cpu.writeCountersJson(countersFile);
+        countersFile << std::endl;
+    }
+    if (!fusionProfilePath.empty())
+    {
+        std::ofstream profileFile(fusionProfilePath, std::ofstream::out | std::ofstream::trunc);
+        fusionProfile.write(profileFile);
+    }
+    if (!timingPath.empty())
+    {
+        std::ofstream timingFile(timingPath, std::ofstream::out | std::ofstream::trunc);
+        timing.getReport().writeJson(timingFile);
+        timingFile << std::endl;
+    }
+    if (sharedName.empty() && dumpMode != DumpMode::Disabled)
+    {
+        ram.dump_memory();
+    }
+    std::cerr.rdbuf(cerrBuffer);
     errorFile.close();
     return 0;
 }
@@ -0,0 +1,103 @@
+#include "Fusion.h"
+#include "Counters.h"
+#include <algorithm>
+#include <sstream>
+#include <vector>
+
+int fusedPairIndex(uint8_t first, uint8_t second)
+{
+    int index = 0;
+#define SCC_FUSED_MATCH(a, b)                             \
+    if (first == opcodes::a && second == opcodes::b)      \
+        return index;                                     \
+    index++;
+    SCC_FUSED_PAIRS(SCC_FUSED_MATCH)
+#undef SCC_FUSED_MATCH
+    return -1;
+}
+
+uint64_t FusionProfile::total() const
+{
+    uint64_t sum = 0;
+    for (const auto &row : pairs)
+    {
+        for (uint64_t count : row)
+        {
+            sum += count;
+        }
+    }
+    return sum;
+}
+
+void FusionProfile::write(std::ostream &out) const
+{
+    std::vector<std::pair<int, int>> seen;
+    for (int first = 0; first < slots; first++)
+    {
+        for (int second = 0; second < slots; second++)
+        {
+            if (pairs[first][second] != 0)
+                seen.push_back({first, second});
+        }
+    }
+    std::stable_sort(seen.begin(), seen.end(), [&](const auto &a, const auto &b)
+    {
+        return pairs[a.first][a.second] > pairs[b.first][b.second];
+    });
+    for (const auto &[first, second] : seen)
+    {
+        out << CPUCounters::opcodeName(first) << ' ' << CPUCounters::opcodeName(second) << ' ' << std::dec << pairs[first][second]
+            << '\n';
+    }
+}
+
+bool FusionProfile::read(std::istream &in, std::string &error)
+{
+    auto slotOf = [](const std::string &name)
+    {
+        for (int slot = 0; slot < slots; slot++)
+        {
+            if (name == CPUCounters::opcodeName(slot))
+                return slot;
+        }
+        return -1;
+    };
+
+    std::string line;
+    for (int number = 1; std::getline(in, line); number++)
+    {
+        std::istringstream fields(line);
+        std::string first;
+        std::string second;
+        uint64_t count;
+        if (!(fields >> first))
+        {
+            continue; // Blank line
+        }
+        std::string rest;
+        if (!(fields >> second >> count) || fields >> rest || slotOf(first) < 0 || slotOf(second) < 0)
+        {
+            error = "Malformed fusion profile line " + std::to_string(number) + ": " + line;
+            return false;
+        }
+        pairs[slotOf(first)][slotOf(second)] += count;
+    }
+    return true;
+}
+
+FusionTable FusionTable::fromProfile(const FusionProfile &profile, double minShare)
+{
+    uint64_t total = profile.total();
+    uint32_t mask = 0;
+    for (int first = 0; first < FusionProfile::slots; first++)
+    {
+        for (int second = 0; second < FusionProfile::slots; second++)
+        {
+            int pair = fusedPairIndex(static_cast<uint8_t>(first), static_cast<uint8_t>(second));
+            uint64_t count = profile.pairs[first][second];
+            if (pair >= 0 && count != 0 && static_cast<double>(count) >= minShare * static_cast<double>(total))
+                mask |= 1u << pair;
+        }
+    }
+    return FusionTable(mask);
+}
@@ -0,0 +1,144 @@
+#include "HexDump.h"
+#include <array>
+#include <cstring>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#define SCC_HEXDUMP_SSSE3 1
+#else
+#define SCC_HEXDUMP_SSSE3 0
+#endif
+
+namespace
+{
+    alignas(16) const char digits[17] = "0123456789abcdef";
+
+    constexpr size_t hexStart = 16; // After "Address 0x0000: "
+    constexpr size_t asciiStart = hexStart + HexDump::bytesPerLine * 3 + 2;
+
+    void formatScalar(const uint8_t *bytes, size_t count, char *out)
+    {
+        for (size_t i = 0; i < HexDump::bytesPerLine; i++)
+        {
+            char *hex = out + hexStart + i * 3;
+            if (i < count)
+            {
+                uint8_t byte = bytes[i];
+                hex[0] = digits[byte >> 4];
+                hex[1] = digits[byte & 0x0F];
+                hex[2] = ' ';
+                out[asciiStart + i] = byte >= 32 && byte <= 126 ? static_cast<char>(byte) : '.';
+            }
+            else
+            {
+                std::memset(hex, ' ', 3);
+                out[asciiStart + i] = ' ';
+            }
+        }
+    }
+
+#if SCC_HEXDUMP_SSSE3
+    using Lanes = std::array<uint8_t, 16>;
+
+    // Sixteen bytes become 48 chars ("hh " each). spread(chunk, half) is the pshufb control
+    // that fills chars chunk*16 .. chunk*16+15 from the interleaved digit pairs of bytes 0-7
+    // (half 0) or 8-15 (half 1); separators and the other half's digits select zero
+    constexpr Lanes spread(size_t chunk, size_t half)
+    {
+        Lanes control{};
+        for (size_t j = 0; j < 16; j++)
+        {
+            size_t position = chunk * 16 + j;
+            size_t byte = position / 3;
+            size_t digit = position % 3;
+            control[j] = digit == 2 || byte / 8 != half ? 0x80 : static_cast<uint8_t>(byte % 8 * 2 + digit);
+        }
+        return control;
+    }
+
+    constexpr Lanes separators(size_t chunk)
+    {
+        Lanes spaces{};
+        for (size_t j = 0; j < 16; j++)
+        {
+            spaces[j] = (chunk * 16 + j) % 3 == 2 ? ' ' : 0;
+        }
+        return spaces;
+    }
+
+    alignas(16) constexpr Lanes spreadControls[3][2] = {{spread(0, 0), spread(0, 1)}, {spread(1, 0), spread(1, 1)}, {spread(2, 0), spread(2, 1)}};
+    alignas(16) constexpr Lanes separatorLanes[3] = {separators(0), separators(1), separators(2)};
+
+    __attribute__((target("ssse3"))) __m128i load(const Lanes &lanes)
+    {
+        return _mm_load_si128(reinterpret_cast<const __m128i *>(lanes.data()));
+    }
+
+    __attribute__((target("ssse3"))) void formatSSSE3(const uint8_t *bytes, char *out)
+    {
+        const __m128i table = _mm_load_si128(reinterpret_cast<const __m128i *>(digits));
+        const __m128i nibble = _mm_set1_epi8(0x0F);
+        for (size_t i = 0; i < HexDump::bytesPerLine; i += 16)
+        {
+            __m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i *>(bytes + i));
+            __m128i high = _mm_shuffle_epi8(table, _mm_and_si128(_mm_srli_epi16(value, 4), nibble));
+            __m128i low = _mm_shuffle_epi8(table, _mm_and_si128(value, nibble));
+            const __m128i pairs[2] = {_mm_unpacklo_epi8(high, low), _mm_unpackhi_epi8(high, low)};
+
+            char *hex = out + hexStart + i * 3;
+            for (size_t chunk = 0; chunk < 3; chunk++)
+            {
+                __m128i text = _mm_or_si128(_mm_shuffle_epi8(pairs[0], load(spreadControls[chunk][0])),
+                                            _mm_shuffle_epi8(pairs[1], load(spreadControls[chunk][1])));
+                text = _mm_or_si128(text, load(separatorLanes[chunk]));
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(hex + chunk * 16), text);
+            }
+
+            // Printable is 0x20-0x7E; bytes from 0x80 up compare as negative
+            __m128i printable = _mm_and_si128(_mm_cmpgt_epi8(value, _mm_set1_epi8(0x1F)), _mm_cmplt_epi8(value, _mm_set1_epi8(0x7F)));
+            __m128i ascii = _mm_or_si128(_mm_and_si128(printable, value), _mm_andnot_si128(printable, _mm_set1_epi8('.')));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(out + asciiStart + i), ascii);
+        }
+    }
+
+    bool hostHasSSSE3()
+    {
+        static const bool supported = (__builtin_cpu_init(), __builtin_cpu_supports("ssse3"));
+        return supported;
+    }
+#endif
+}
+
+void HexDump::formatLine(uint16_t address, const uint8_t *bytes, size_t count, char *out)
+{
+    std::memcpy(out, "Address 0x", 10);
+    for (size_t i = 0; i < 4; i++)
+    {
+        out[10 + i] = digits[address >> (12 - i * 4) & 0x0F];
+    }
+    out[14] = ':';
+    out[15] = ' ';
+    out[asciiStart - 2] = '|';
+    out[asciiStart - 1] = ' ';
+    out[lineLength - 1] = '\n';
+
+#if SCC_HEXDUMP_SSSE3
+    if (count >= bytesPerLine && hostHasSSSE3())
+    {
+        formatSSSE3(bytes, out);
+        return;
+    }
+#endif
+    formatScalar(bytes, count, out);
+}
+
+const char *HexDump::implementation()
+{
+#if SCC_HEXDUMP_SSSE3
+    if (hostHasSSSE3())
+    {
+        return "ssse3";
+    }
+#endif
+    return "scalar";
+}
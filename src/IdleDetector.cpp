@@ -0,0 +1,123 @@
+#include "IdleDetector.h"
+#include "CPU.h"
+#include <algorithm>
+
+namespace
+{
+    // True when the instruction at PC is a JMP that resumes at itself: it changes nothing, forever
+    bool jumpsToItself(const CPU &cpu, const RAM &ram)
+    {
+        if (cpu.PC + 2u >= ram.size() || ram.getPageKind(cpu.PC) == PageKind::Device)
+        {
+            return false;
+        }
+        uint16_t operand = static_cast<uint16_t>(ram.readByte(cpu.PC + 1) << 8 | ram.readByte(cpu.PC + 2));
+        return ram.readByte(cpu.PC) == 0b0101 && static_cast<uint16_t>(operand + 3) == cpu.PC;
+    }
+
+    bool hasDevices(const RAM &ram)
+    {
+        for (size_t address = 0; address < ram.size(); address += RAM::pageSize)
+        {
+            if (ram.getPageKind(static_cast<uint16_t>(address)) == PageKind::Device)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+}
+
+IdleDetector::IdleDetector(uint64_t interval) : interval(std::max<uint64_t>(interval, 1))
+{
+    reset();
+}
+
+void IdleDetector::reset()
+{
+    sinceSample = 0;
+    tortoise = State{};
+    haveTortoise = false;
+    power = 1;
+    lambda = 1;
+    cycleSamples = 0;
+}
+
+IdleDetector::State IdleDetector::capture(const CPU &cpu, const RAM &ram)
+{
+    // Architectural state only: the data cache is an engine detail (the JIT bypasses it), and
+    // hashing it would make the idle stop point depend on the engine
+    return State{cpu.PC, cpu.SP, cpu.A, cpu.getStatus(), ram.contentHash()};
+}
+
+bool IdleDetector::advance(uint64_t executed, const CPU &cpu, const RAM &ram)
+{
+    sinceSample += executed;
+    if (sinceSample < interval)
+    {
+        return false;
+    }
+    sinceSample = 0;
+    if (hasDevices(ram))
+    {
+        return false;
+    }
+
+    // Samples need not be evenly spaced: any repeated state proves the run is a cycle
+    State hare = capture(cpu, ram);
+    if (!haveTortoise)
+    {
+        tortoise = hare;
+        haveTortoise = true;
+        return false;
+    }
+    if (hare == tortoise)
+    {
+        cycleSamples = lambda;
+        return true;
+    }
+    if (lambda == power)
+    {
+        tortoise = hare;
+        power *= 2;
+        lambda = 0;
+    }
+    lambda++;
+    return false;
+}
+
+RunResult runUntilHalt(CPU &cpu, RAM &ram, uint16_t end_address, uint64_t budget, IdleDetector &detector)
+{
+    RunResult result{RunOutcome::BudgetExhausted, 0};
+    while (true)
+    {
+        if (cpu.isHalted())
+        {
+            result.outcome = RunOutcome::Halted;
+            break;
+        }
+        if (cpu.PC >= end_address)
+        {
+            result.outcome = RunOutcome::EndReached;
+            break;
+        }
+        if (result.executed == budget)
+        {
+            break;
+        }
+        if (jumpsToItself(cpu, ram))
+        {
+            result.outcome = RunOutcome::Idle;
+            break;
+        }
+
+        uint64_t ran = cpu.run(ram, end_address, std::min(detector.untilSample(), budget - result.executed));
+        result.executed += ran;
+        if (detector.advance(ran, cpu, ram))
+        {
+            result.outcome = RunOutcome::Idle;
+            break;
+        }
+    }
+    return result;
+}
@@ -0,0 +1,371 @@
+#include "Jit.h"
+#include "DecodeCache.h"
+#include "RAM.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <utility>
+
+#if SCC_JIT_X64
+#include <sys/mman.h>
+#endif
+
+namespace
+{
+    static_assert(offsetof(JitRegisters, PC) == 0 && offsetof(JitRegisters, SP) == 2 && offsetof(JitRegisters, A) == 4,
+                  "Compiled code addresses JitRegisters fields by fixed offsets");
+
+    constexpr uint8_t flagKind = offsetof(JitRegisters, flags) + offsetof(LazyFlags, kind);
+    constexpr uint8_t flagLhs = offsetof(JitRegisters, flags) + offsetof(LazyFlags, lhs);
+    constexpr uint8_t flagRhs = offsetof(JitRegisters, flags) + offsetof(LazyFlags, rhs);
+    constexpr uint8_t flagResult = offsetof(JitRegisters, flags) + offsetof(LazyFlags, result);
+    constexpr uint8_t flagHasResult = offsetof(JitRegisters, flags) + offsetof(LazyFlags, hasResult);
+
+    // Register use: rdi = host stack page, rsi = JitRegisters, rdx = max iterations,
+    // r8 = completed iterations, eax = A, ecx = SP, r9 and r10 = scratch. All caller-saved.
+    class Emitter
+    {
+    public:
+        std::vector<uint8_t> code;
+
+        void bytes(std::initializer_list<uint8_t> values) { code.insert(code.end(), values); }
+        void imm16(uint32_t value) { bytes({static_cast<uint8_t>(value), static_cast<uint8_t>(value >> 8)}); }
+        void imm32(uint32_t value)
+        {
+            bytes({static_cast<uint8_t>(value), static_cast<uint8_t>(value >> 8), static_cast<uint8_t>(value >> 16),
+                   static_cast<uint8_t>(value >> 24)});
+        }
+        size_t here() const { return code.size(); }
+        // rel32 placeholder, patched once the target is known
+        size_t jump(std::initializer_list<uint8_t> opcode)
+        {
+            bytes(opcode);
+            imm32(0);
+            return here() - 4;
+        }
+        void patch(size_t at, size_t target)
+        {
+            uint32_t rel = static_cast<uint32_t>(static_cast<int64_t>(target) - static_cast<int64_t>(at + 4));
+            std::memcpy(code.data() + at, &rel, 4);
+        }
+
+        // mov r10, host
+        void address(const uint8_t *host)
+        {
+            uint64_t value = reinterpret_cast<uint64_t>(host);
+            bytes({0x49, 0xBA});
+            imm32(static_cast<uint32_t>(value));
+            imm32(static_cast<uint32_t>(value >> 32));
+        }
+        // mov r10, host; op al/[r10]: the one ModRM form every data operand uses
+        void memoryOperand(std::initializer_list<uint8_t> opcode, const uint8_t *host)
+        {
+            address(host);
+            bytes({0x41}); // REX.B selects r10
+            bytes(opcode);
+            bytes({0x02});
+        }
+
+        // ADC (add) or SBC (sub) through r9 so the operands and result can be recorded:
+        // r9 = [r10]; record; r9 = r9 op al; [r10] = r9; record
+        void arithmetic(bool subtract, const uint8_t *host, bool recordOperands, bool recordResult)
+        {
+            address(host);
+            bytes({0x45, 0x0F, 0xB6, 0x0A}); // movzx r9d, byte [r10]
+            if (recordOperands)
+            {
+                // ADC records lhs = A, rhs = M; SBC lhs = M, rhs = A
+                bytes({0x88, 0x46, subtract ? flagRhs : flagLhs});       // mov [rsi+A side], al
+                bytes({0x44, 0x88, 0x4E, subtract ? flagLhs : flagRhs}); // mov [rsi+M side], r9b
+                bytes({0xC6, 0x46, flagKind, subtract ? LazyFlags::Subtract : LazyFlags::Add});
+            }
+            bytes({0x41, static_cast<uint8_t>(subtract ? 0x28 : 0x00), 0xC1}); // add/sub r9b, al
+            bytes({0x45, 0x88, 0x0A});                                         // mov [r10], r9b
+            if (recordResult)
+            {
+                bytes({0x44, 0x88, 0x4E, flagResult}); // mov [rsi+result], r9b
+                bytes({0xC6, 0x46, flagHasResult, 1});
+            }
+        }
+        // Z and N from A
+        void recordAccumulator()
+        {
+            bytes({0x88, 0x46, flagResult}); // mov [rsi+result], al
+            bytes({0xC6, 0x46, flagHasResult, 1});
+        }
+
+        // Store A, SP and PC, then return completed * length + index instructions
+        void exit(uint16_t pc, size_t length, size_t index)
+        {
+            bytes({0x88, 0x46, offsetof(JitRegisters, A)});        // mov [rsi+A], al
+            bytes({0x66, 0x89, 0x4E, offsetof(JitRegisters, SP)}); // mov [rsi+SP], cx
+            bytes({0x66, 0xC7, 0x46, offsetof(JitRegisters, PC)}); // mov word [rsi+PC], pc
+            imm16(pc);
+            bytes({0x49, 0x69, 0xC0}); // imul rax, r8, length
+            imm32(static_cast<uint32_t>(length));
+            if (index > 0)
+            {
+                bytes({0x48, 0x05}); // add rax, index
+                imm32(static_cast<uint32_t>(index));
+            }
+            bytes({0xC3}); // ret
+        }
+    };
+
+    // One instruction of a trace; host is the data operand's byte in its RAM page
+    struct Traced
+    {
+        uint16_t pc;
+        uint16_t operand;
+        uint8_t opcode;
+        uint8_t *host;
+    };
+
+    struct SideExit
+    {
+        size_t jumpAt;
+        size_t index;
+        uint16_t pc;
+    };
+}
+
+JitCompiler::JitCompiler() : arena(nullptr), arenaUsed(0), ramId(0), seenCodeWrites(0), seenLayout(0), compiledBlocks(0)
+{
+#if SCC_JIT_X64
+    void *mapping = mmap(nullptr, arenaSize, PROT_READ | PROT_EXEC, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    arena = mapping == MAP_FAILED ? nullptr : static_cast<uint8_t *>(mapping);
+#endif
+    flush();
+}
+
+JitCompiler::~JitCompiler()
+{
+#if SCC_JIT_X64
+    if (arena != nullptr)
+    {
+        munmap(arena, arenaSize);
+    }
+#endif
+}
+
+void JitCompiler::flush()
+{
+    for (size_t pc = 0; pc < 0x100; pc++)
+    {
+        state[pc] = SlotState::Unknown;
+        blocks[pc] = JitBlock{};
+    }
+    arenaUsed = 0;
+}
+
+void JitCompiler::synchronize(const RAM &ram)
+{
+    // Blocks hold host addresses of RAM pages, which a layout change can move
+    if (ram.getId() != ramId || ram.getCodeWriteCount() != seenCodeWrites || ram.getLayoutVersion() != seenLayout)
+    {
+        flush();
+        ramId = ram.getId();
+        seenCodeWrites = ram.getCodeWriteCount();
+        seenLayout = ram.getLayoutVersion();
+    }
+}
+
+const JitBlock *JitCompiler::lookup(RAM &ram, uint16_t pc)
+{
+    if (pc > DecodeCache::programSize - 3)
+    {
+        return nullptr;
+    }
+    if (state[pc] == SlotState::Unknown)
+    {
+        state[pc] = compile(ram, pc, blocks[pc]) ? SlotState::Compiled : SlotState::Uncompilable;
+    }
+    return state[pc] == SlotState::Compiled ? &blocks[pc] : nullptr;
+}
+
+uint8_t *JitCompiler::reserve(size_t length)
+{
+    if (arena == nullptr || length > arenaSize)
+    {
+        return nullptr;
+    }
+    if (arenaUsed + length > arenaSize)
+    {
+        // Full: start over, recompiling blocks as they are reached again
+        flush();
+    }
+    uint8_t *at = arena + arenaUsed;
+    arenaUsed += (length + 15) & ~size_t(15);
+    return at;
+}
+
+bool JitCompiler::compile(RAM &ram, uint16_t pc, JitBlock &compiled)
+{
+#if SCC_JIT_X64
+    const uint32_t dataEnd = static_cast<uint32_t>(ram.size());
+    const uint32_t stackEnd = std::min<uint32_t>(0x200, dataEnd);
+    if (stackEnd <= 0x100)
+    {
+        return false;
+    }
+
+    // Built locally: reserve() may flush every slot, including the one being compiled
+    JitBlock block{};
+    block.start = pc;
+    Emitter out;
+    std::vector<SideExit> sideExits;
+
+    out.bytes({0x0F, 0xB6, 0x46, offsetof(JitRegisters, A)});  // movzx eax, byte [rsi+A]
+    out.bytes({0x0F, 0xB7, 0x4E, offsetof(JitRegisters, SP)}); // movzx ecx, word [rsi+SP]
+    out.bytes({0x45, 0x31, 0xC0});                             // xor r8d, r8d
+    const size_t loopStart = out.here();
+
+    // Follow jumps, so a chain of them compiles into one block, until the trace
+    // revisits an instruction or leaves the program region
+    std::vector<Traced> trace;
+    bool visited[DecodeCache::programSize] = {};
+    uint16_t at = pc;
+    while (at <= DecodeCache::programSize - 3 && !visited[at] && trace.size() < maxBlockLength)
+    {
+        visited[at] = true;
+        uint8_t opcode = ram.readByte(at);
+        uint16_t operand = static_cast<uint16_t>(ram.readByte(at + 1) << 8 | ram.readByte(at + 2));
+        // Only plain RAM pages: ROM and devices go through RAM::writeByte and readByte
+        uint8_t *page = operand >= 0x200 && operand < dataEnd ? ram.pageData(operand) : nullptr;
+        uint8_t *host = page != nullptr ? page + operand % RAM::pageSize : nullptr;
+
+        // HLT stops the run and unsupported opcodes report through errorLog, so the interpreter runs both
+        bool handled = opcode == 0b0101 || opcode == 0b0110 || opcode == 0b0111 || (opcode <= 0b0100 && host != nullptr);
+        if (!handled)
+        {
+            break;
+        }
+        trace.push_back({at, operand, opcode, host});
+        at = static_cast<uint16_t>((opcode == 0b0101 ? operand : at) + 3);
+    }
+    if (trace.empty())
+    {
+        return false;
+    }
+
+    // A flag record is needed only if an exit can observe it: PSH and POP exit before
+    // themselves, and the end of the block exits after everything
+    std::vector<bool> recordOperands(trace.size()), recordResult(trace.size());
+    bool exitSinceOperands = true;
+    bool exitSinceResult = true;
+    for (size_t index = trace.size(); index-- > 0;)
+    {
+        uint8_t opcode = trace[index].opcode;
+        if (opcode <= 0b0001)
+        {
+            recordOperands[index] = exitSinceOperands;
+            exitSinceOperands = false;
+        }
+        if (opcode <= 0b0100 || opcode == 0b0111)
+        {
+            recordResult[index] = exitSinceResult;
+            exitSinceResult = false;
+        }
+        if (opcode == 0b0110 || opcode == 0b0111)
+        {
+            exitSinceOperands = true;
+            exitSinceResult = true;
+        }
+    }
+
+    for (size_t index = 0; index < trace.size(); index++)
+    {
+        const Traced &instruction = trace[index];
+        switch (instruction.opcode)
+        {
+        case 0b0000: // ADC: M = A + M
+        case 0b0001: // SBC: M = M - A
+        {
+            bool subtract = instruction.opcode == 0b0001;
+            if (recordOperands[index] || recordResult[index])
+                out.arithmetic(subtract, instruction.host, recordOperands[index], recordResult[index]);
+            else
+                out.memoryOperand({static_cast<uint8_t>(subtract ? 0x28 : 0x00)}, instruction.host); // add/sub [r10], al
+            block.dataWrites.push_back(instruction.operand);
+            break;
+        }
+        case 0b0010: // LDA
+            out.memoryOperand({0x0F, 0xB6}, instruction.host); // movzx eax, byte [r10]
+            break;
+        case 0b0011: // AND
+            out.memoryOperand({0x22}, instruction.host); // and al, [r10]
+            break;
+        case 0b0100: // EOR
+            out.memoryOperand({0x32}, instruction.host); // xor al, [r10]
+            break;
+        case 0b0101: // JMP: execution resumes at operand + 3
+            break;
+        case 0b0110: // PSH: writeStackByte accepts 0x100..0x1FF
+            out.bytes({0x44, 0x8D, 0x91}); // lea r10d, [rcx-0x100]
+            out.imm32(static_cast<uint32_t>(-0x100));
+            out.bytes({0x41, 0x81, 0xFA}); // cmp r10d, stackEnd-0x100
+            out.imm32(stackEnd - 0x100);
+            sideExits.push_back({out.jump({0x0F, 0x83}), index, instruction.pc}); // jae exit
+            out.bytes({0x88, 0x84, 0x0F}); // mov [rdi+rcx-0x100], al
+            out.imm32(static_cast<uint32_t>(-0x100));
+            out.bytes({0xFF, 0xC1});       // inc ecx
+            block.writesStack = true;
+            break;
+        case 0b0111: // POP: SP - 1 must stay inside the stack region (SP == 0 wraps far above it)
+            out.bytes({0x44, 0x8D, 0x91}); // lea r10d, [rcx-0x101]
+            out.imm32(static_cast<uint32_t>(-0x101));
+            out.bytes({0x41, 0x81, 0xFA}); // cmp r10d, stackEnd-0x100
+            out.imm32(stackEnd - 0x100);
+            sideExits.push_back({out.jump({0x0F, 0x83}), index, instruction.pc}); // jae exit
+            out.bytes({0xFF, 0xC9});             // dec ecx
+            out.bytes({0x0F, 0xB6, 0x84, 0x0F}); // movzx eax, byte [rdi+rcx-0x100]
+            out.imm32(static_cast<uint32_t>(-0x100));
+            break;
+        }
+        if (instruction.opcode >= 0b0010 && instruction.opcode != 0b0101 && instruction.opcode != 0b0110 && recordResult[index])
+        {
+            out.recordAccumulator();
+        }
+        block.opcodes.push_back(instruction.opcode);
+        block.highestPC = std::max(block.highestPC, instruction.pc);
+    }
+
+    const size_t length = block.opcodes.size();
+    out.bytes({0x49, 0xFF, 0xC0}); // inc r8
+    if (at == pc)
+    {
+        // Tight loop: repeat in compiled code while the caller's budget allows
+        out.bytes({0x49, 0x39, 0xD0}); // cmp r8, rdx
+        size_t back = out.jump({0x0F, 0x82});
+        out.patch(back, loopStart);
+    }
+    out.exit(at, length, 0);
+    for (const SideExit &sideExit : sideExits)
+    {
+        out.patch(sideExit.jumpAt, out.here());
+        out.exit(sideExit.pc, length, sideExit.index);
+    }
+
+    uint8_t *target = reserve(out.code.size());
+    if (target == nullptr || mprotect(arena, arenaSize, PROT_READ | PROT_WRITE) != 0)
+    {
+        return false;
+    }
+    std::memcpy(target, out.code.data(), out.code.size());
+    if (mprotect(arena, arenaSize, PROT_READ | PROT_EXEC) != 0)
+    {
+        // The whole arena is left non-executable, so no block in it may run
+        flush();
+        return false;
+    }
+    block.code = reinterpret_cast<JitBlock::Code>(target);
+    compiled = std::move(block);
+    compiledBlocks++;
+    return true;
+#else
+    (void)ram;
+    (void)pc;
+    (void)compiled;
+    return false;
+#endif
+}
@@ -0,0 +1,230 @@
+#include "Loader.h"
+#include "ProgramImage.h"
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+namespace
+{
+    // The characters operator>> skips
+    bool isSpace(char c)
+    {
+        return c == ' ' || c == '\t' || c == '\n' || c == '\v' || c == '\f' || c == '\r';
+    }
+
+    uint64_t fnv1a(uint64_t hash, const void *data, size_t length)
+    {
+        const uint8_t *bytes = static_cast<const uint8_t *>(data);
+        for (size_t i = 0; i < length; i++)
+        {
+            hash ^= bytes[i];
+            hash *= 0x100000001b3ULL;
+        }
+        return hash;
+    }
+}
+
+bool ProgramLoader::readFile(const std::string &path, std::string &contents)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open())
+    {
+        return false;
+    }
+    std::ostringstream buffer;
+    buffer << file.rdbuf();
+    contents = buffer.str();
+    return true;
+}
+
+bool ProgramLoader::parseTextProgram(const std::string &path, std::vector<uint8_t> &bytes, std::string &error)
+{
+    std::string text;
+    if (!readFile(path, text))
+    {
+        error = "Error opening the file.";
+        return false;
+    }
+
+    // Scan the buffer directly: every line needs 24 bits, anything after them is ignored
+    bytes.clear();
+    size_t position = 0;
+    while (position < text.size())
+    {
+        size_t lineEnd = text.find('\n', position);
+        if (lineEnd == std::string::npos)
+        {
+            lineEnd = text.size();
+        }
+        uint32_t word = 0;
+        int bits = 0;
+        for (size_t i = position; i < lineEnd && bits < 24; i++)
+        {
+            char bitChar = text[i];
+            if (isSpace(bitChar))
+            {
+                continue;
+            }
+            // Check if the character is a binary value (0 or 1)
+            if (bitChar != '0' && bitChar != '1')
+            {
+                error = "Error: Non-binary character found in the line.";
+                return false;
+            }
+            word = word << 1 | static_cast<uint32_t>(bitChar - '0');
+            bits++;
+        }
+        if (bits < 24)
+        {
+            error = "Error: Insufficient bits in the line.";
+            return false;
+        }
+        bytes.push_back(static_cast<uint8_t>(word >> 16));
+        bytes.push_back(static_cast<uint8_t>(word >> 8));
+        bytes.push_back(static_cast<uint8_t>(word));
+        position = lineEnd + 1;
+    }
+    return true;
+}
+
+bool ProgramLoader::parseTextData(const std::string &path, std::vector<uint8_t> &bytes, std::string &error)
+{
+    std::string text;
+    if (!readFile(path, text))
+    {
+        error = "Error opening the file.";
+        return false;
+    }
+    // Extraction into a uint8_t reads one character, so every non-space character is a byte
+    bytes.clear();
+    for (char c : text)
+    {
+        if (!isSpace(c))
+        {
+            bytes.push_back(static_cast<uint8_t>(c));
+        }
+    }
+    return true;
+}
+
+bool ProgramLoader::loadTextProgram(RAM &ram, const std::string &path, uint16_t &end_address, std::string &error)
+{
+    std::vector<uint8_t> bytes;
+    if (!parseTextProgram(path, bytes, error))
+    {
+        return false;
+    }
+    // Byte by byte through the checked write path, so the write log matches a hand-loaded program
+    uint16_t address = 0x0000;
+    for (uint8_t byteValue : bytes)
+    {
+        ram.writeInstructionByte(address, byteValue);
+        ++address;
+    }
+    end_address = address;
+    return true;
+}
+
+bool ProgramLoader::loadTextData(RAM &ram, const std::string &path, std::string &error)
+{
+    std::vector<uint8_t> bytes;
+    if (!parseTextData(path, bytes, error))
+    {
+        return false;
+    }
+    uint16_t address = dataStart;
+    for (uint8_t byteValue : bytes)
+    {
+        ram.writeByte(address, byteValue);
+        ++address;
+    }
+    return true;
+}
+
+bool ProgramLoader::loadImage(RAM &ram, const std::string &path, uint16_t &entry, uint16_t &end_address, std::string &error)
+{
+    ProgramImage image;
+    if (!image.open(path, error))
+    {
+        return false;
+    }
+    if (!image.loadInto(ram))
+    {
+        error = "Error: " + path + " does not fit in memory";
+        return false;
+    }
+    entry = image.getEntry();
+    end_address = image.getEnd();
+    return true;
+}
+
+bool ProgramLoader::convertText(const std::string &programPath, const std::string &dataPath, const std::string &imagePath, std::string &error)
+{
+    std::vector<uint8_t> program, data;
+    if (!parseTextProgram(programPath, program, error) || !parseTextData(dataPath, data, error))
+    {
+        return false;
+    }
+    if (program.size() > 0x100)
+    {
+        error = "Error: " + programPath + " does not fit in the instruction space";
+        return false;
+    }
+
+    std::vector<ImageSegment> segments;
+    segments.push_back({0x0000, SegmentKind::Code, program.data(), static_cast<uint32_t>(program.size())});
+    if (!data.empty())
+    {
+        segments.push_back({dataStart, SegmentKind::Data, data.data(), static_cast<uint32_t>(data.size())});
+    }
+    return ProgramImage::write(imagePath, 0x0000, static_cast<uint16_t>(program.size()),
+                               sourceStamp(programPath, dataPath), segments, error);
+}
+
+bool ProgramLoader::loadCached(RAM &ram, const std::string &programPath, const std::string &dataPath, const std::string &cacheDir,
+                               uint16_t &entry, uint16_t &end_address, std::string &error)
+{
+    // One cache entry per program/data pair
+    std::error_code ignored;
+    std::string key = std::filesystem::absolute(programPath, ignored).string() + '\n' +
+                      std::filesystem::absolute(dataPath, ignored).string();
+    std::ostringstream name;
+    name << std::hex << std::setw(16) << std::setfill('0') << fnv1a(0xcbf29ce484222325ULL, key.data(), key.size()) << ".sccimg";
+    std::string imagePath = (std::filesystem::path(cacheDir) / name.str()).string();
+
+    uint64_t stamp = sourceStamp(programPath, dataPath);
+    ProgramImage image;
+    std::string cacheError;
+    if (!image.open(imagePath, cacheError) || image.getSourceStamp() != stamp)
+    {
+        image.close();
+        std::filesystem::create_directories(cacheDir, ignored);
+        if (!convertText(programPath, dataPath, imagePath, error) || !image.open(imagePath, error))
+        {
+            return false;
+        }
+    }
+    if (!image.loadInto(ram))
+    {
+        error = "Error: " + programPath + " does not fit in memory";
+        return false;
+    }
+    entry = image.getEntry();
+    end_address = image.getEnd();
+    return true;
+}
+
+uint64_t ProgramLoader::sourceStamp(const std::string &programPath, const std::string &dataPath)
+{
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (const std::string &path : {programPath, dataPath})
+    {
+        std::error_code ignored;
+        uintmax_t size = std::filesystem::file_size(path, ignored);
+        auto modified = std::filesystem::last_write_time(path, ignored).time_since_epoch().count();
+        hash = fnv1a(hash, &size, sizeof(size));
+        hash = fnv1a(hash, &modified, sizeof(modified));
+    }
+    return hash;
+}
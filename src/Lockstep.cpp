@@ -0,0 +1,356 @@
+#include "Lockstep.h"
+#include "ProgramImage.h"
+#include "ThreadPool.h"
+#include "Trace.h"
+#include <algorithm>
+#include <atomic>
+#include <bitset>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+namespace
+{
+    constexpr uint16_t dataStart = 0x0200;
+
+    // SplitMix64: cheap to seed per case, so case i never depends on the cases before it
+    struct CaseRandom
+    {
+        uint64_t state;
+
+        uint64_t next()
+        {
+            uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+            return z ^ (z >> 31);
+        }
+        uint64_t below(uint64_t bound) { return next() % bound; }
+    };
+
+    // Addresses on both sides of every region boundary of a default-sized RAM
+    const uint16_t edgeAddresses[] = {0x0000, 0x00FF, 0x0100, 0x01FF, 0x0200, 0x07FF, 0x0800, 0xFFFF};
+
+    std::string hex(uint64_t value)
+    {
+        std::ostringstream text;
+        text << "0x" << std::hex << value;
+        return text.str();
+    }
+
+    // After the instruction at removed is deleted, keep every JMP that resumed past it pointing
+    // at the same instruction
+    void relocateJumps(std::vector<uint8_t> &program, size_t removed)
+    {
+        for (size_t i = 0; i + 2 < program.size(); i += 3)
+        {
+            uint16_t operand = static_cast<uint16_t>(program[i + 1] << 8 | program[i + 2]);
+            uint16_t resume = static_cast<uint16_t>(operand + 3);
+            if (program[i] == 0b0101 && resume > removed && resume <= program.size() + 3)
+            {
+                operand = static_cast<uint16_t>(operand - 3);
+                program[i + 1] = static_cast<uint8_t>(operand >> 8);
+                program[i + 2] = static_cast<uint8_t>(operand);
+            }
+        }
+    }
+
+    void load(RAM &ram, const LockstepCase &testCase)
+    {
+        ram.loadBytes(0x0000, testCase.program.data(), testCase.program.size());
+        if (!testCase.data.empty())
+        {
+            ram.loadBytes(dataStart, testCase.data.data(), testCase.data.size());
+        }
+    }
+}
+
+// Per-thread CPUs, reused between cases so the JIT arena is mapped once
+struct LockstepHarness::Workspace
+{
+    CPU reference;
+    CPU candidate;
+    CPUSnapshot initial = CPU().snapshot();
+};
+
+LockstepHarness::LockstepHarness(const LockstepOptions &options) : options(options)
+{
+    this->options.maxLength = std::clamp<size_t>(options.maxLength, 1, DecodeCache::programSize / 3 - 1);
+    this->options.blockSize = std::max<uint64_t>(options.blockSize, 1);
+    this->options.threadCount = std::max(options.threadCount, 1u);
+}
+
+LockstepCase LockstepHarness::generate(uint64_t index) const
+{
+    CaseRandom random{options.seed * 0xD1B54A32D192ED03ULL + index};
+    LockstepCase testCase;
+    testCase.budget = options.budget;
+
+    const size_t length = 1 + random.below(options.maxLength);
+    for (size_t i = 0; i < length; i++)
+    {
+        uint8_t opcode = static_cast<uint8_t>(random.below(10)); // 8 is HLT, 9 is unsupported
+        uint16_t operand;
+        uint64_t kind = random.below(16);
+        if (opcode == 0b0101 && kind < 12)
+            operand = static_cast<uint16_t>(random.below(length + 1) * 3 - 3); // Resume at an instruction
+        else if (kind < 9)
+            operand = static_cast<uint16_t>(dataStart + random.below(0x40)); // A small window, so stores alias
+        else if (kind < 11)
+            operand = edgeAddresses[random.below(std::size(edgeAddresses))];
+        else if (kind < 12)
+            operand = static_cast<uint16_t>(random.below(length * 3)); // Instruction bytes
+        else if (kind < 13)
+            operand = static_cast<uint16_t>(0x0100 + random.below(0x100));
+        else
+            operand = static_cast<uint16_t>(random.below(0x900));
+        testCase.program.insert(testCase.program.end(), {opcode, static_cast<uint8_t>(operand >> 8), static_cast<uint8_t>(operand)});
+    }
+    // Half the programs loop forever, so the budget decides where they stop
+    if (random.below(2) == 0)
+    {
+        testCase.program.insert(testCase.program.end(), {0x05, 0xFF, 0xFD});
+    }
+
+    testCase.data.resize(0x40 + random.below(0xC0));
+    for (uint8_t &byte : testCase.data)
+    {
+        byte = static_cast<uint8_t>(random.next());
+    }
+    return testCase;
+}
+
+bool LockstepHarness::check(const LockstepCase &testCase, uint64_t blockSize, std::string &reason, uint64_t &instruction) const
+{
+    Workspace workspace;
+    return check(workspace, testCase, blockSize, reason, instruction, nullptr);
+}
+
+bool LockstepHarness::check(Workspace &workspace, const LockstepCase &testCase, uint64_t blockSize, std::string &reason,
+                            uint64_t &instruction, uint64_t *executed) const
+{
+    // Generated programs hit every RAM error path on purpose
+    std::ostream *previousLog = errorStream;
+    setErrorLog(nullptr);
+
+    RAM referenceRam(RAM::defaultSize, DumpMode::Disabled);
+    RAM candidateRam(RAM::defaultSize, DumpMode::Disabled);
+    load(referenceRam, testCase);
+    load(candidateRam, testCase);
+
+    CPU &reference = workspace.reference;
+    CPU &candidate = workspace.candidate;
+    reference.restore(workspace.initial);
+    candidate.restore(workspace.initial);
+    reference.engine = ExecutionEngine::Reference;
+    candidate.engine = options.engine;
+
+    const uint16_t end_address = static_cast<uint16_t>(testCase.program.size());
+    bool agreed = true;
+    instruction = 0;
+    while (instruction < testCase.budget)
+    {
+        const uint64_t block = std::min(blockSize, testCase.budget - instruction);
+        const uint64_t referenceRan = reference.run(referenceRam, end_address, block);
+        const uint64_t candidateRan = runner ? runner(candidate, candidateRam, end_address, block)
+                                             : candidate.run(candidateRam, end_address, block);
+        instruction += referenceRan;
+
+        if (referenceRan != candidateRan)
+            reason = "executed " + std::to_string(referenceRan) + " != " + std::to_string(candidateRan);
+        else if (reference.PC != candidate.PC)
+            reason = "PC " + hex(reference.PC) + " != " + hex(candidate.PC);
+        else if (reference.SP != candidate.SP)
+            reason = "SP " + hex(reference.SP) + " != " + hex(candidate.SP);
+        else if (reference.A != candidate.A)
+            reason = "A " + hex(reference.A) + " != " + hex(candidate.A);
+        else if (reference.getStatus() != candidate.getStatus())
+            reason = "STATUS " + hex(reference.getStatus()) + " != " + hex(candidate.getStatus());
+        else if (referenceRam.contentHash() != candidateRam.contentHash())
+        {
+            for (size_t address = 0; address < referenceRam.size(); address++)
+            {
+                uint8_t expected = referenceRam.readByte(static_cast<uint16_t>(address));
+                uint8_t actual = candidateRam.readByte(static_cast<uint16_t>(address));
+                if (expected != actual)
+                {
+                    reason = "RAM[" + hex(address) + "] " + hex(expected) + " != " + hex(actual);
+                    break;
+                }
+            }
+        }
+        else if (referenceRan < block)
+            break; // Both reached the end address
+        else
+            continue;
+
+        agreed = false;
+        break;
+    }
+
+    if (executed != nullptr)
+        *executed = instruction;
+    setErrorLog(previousLog);
+    return agreed;
+}
+
+bool LockstepHarness::diverges(Workspace &workspace, const LockstepCase &testCase) const
+{
+    std::string reason;
+    uint64_t instruction;
+    return !check(workspace, testCase, 1, reason, instruction, nullptr);
+}
+
+LockstepCase LockstepHarness::shrink(const LockstepCase &testCase) const
+{
+    Workspace workspace;
+    LockstepCase best = testCase;
+    std::string reason;
+    uint64_t instruction;
+    if (check(workspace, best, 1, reason, instruction, nullptr))
+    {
+        return best;
+    }
+    best.budget = instruction;
+
+    // Greedy passes until none of them removes anything
+    bool progress = true;
+    while (progress)
+    {
+        progress = false;
+        // Drop instructions, last first
+        for (size_t i = best.program.size() / 3; i-- > 0 && best.program.size() > 3;)
+        {
+            LockstepCase candidate = best;
+            candidate.program.erase(candidate.program.begin() + i * 3, candidate.program.begin() + i * 3 + 3);
+            relocateJumps(candidate.program, i * 3);
+            if (diverges(workspace, candidate))
+            {
+                best = std::move(candidate);
+                progress = true;
+            }
+        }
+        // Clear data bytes, then trim the zeros left at the end (RAM reads zero there anyway)
+        for (size_t i = 0; i < best.data.size(); i++)
+        {
+            if (best.data[i] == 0)
+                continue;
+            LockstepCase candidate = best;
+            candidate.data[i] = 0;
+            if (diverges(workspace, candidate))
+            {
+                best = std::move(candidate);
+                progress = true;
+            }
+        }
+        while (!best.data.empty() && best.data.back() == 0)
+        {
+            best.data.pop_back();
+        }
+        // Stop at the first difference
+        if (!check(workspace, best, 1, reason, instruction, nullptr) && instruction < best.budget)
+        {
+            best.budget = instruction;
+            progress = true;
+        }
+    }
+    return best;
+}
+
+LockstepReport LockstepHarness::run() const
+{
+    using Clock = std::chrono::steady_clock;
+    const Clock::time_point started = Clock::now();
+
+    std::atomic<uint64_t> firstDiverging{options.programs};
+    std::atomic<uint64_t> compared{0};
+    std::atomic<uint64_t> executed{0};
+    {
+        WorkStealingPool pool(options.threadCount);
+        for (uint64_t first = 0; first < options.programs; first += shardSize)
+        {
+            pool.submit([&, first]
+            {
+                Workspace workspace;
+                const uint64_t last = std::min(first + shardSize, options.programs);
+                uint64_t shardCompared = 0;
+                uint64_t shardExecuted = 0;
+                // Cases past a known divergence cannot be the lowest one
+                for (uint64_t index = first; index < last && index < firstDiverging.load(std::memory_order_relaxed); index++)
+                {
+                    std::string reason;
+                    uint64_t instruction;
+                    uint64_t ran = 0;
+                    bool agreed = check(workspace, generate(index), options.blockSize, reason, instruction, &ran);
+                    shardCompared++;
+                    shardExecuted += ran;
+                    if (!agreed)
+                    {
+                        uint64_t lowest = firstDiverging.load(std::memory_order_relaxed);
+                        while (index < lowest && !firstDiverging.compare_exchange_weak(lowest, index))
+                        {
+                        }
+                        break;
+                    }
+                }
+                compared.fetch_add(shardCompared, std::memory_order_relaxed);
+                executed.fetch_add(shardExecuted, std::memory_order_relaxed);
+            });
+        }
+        pool.wait();
+    }
+
+    LockstepReport report{};
+    report.programs = compared.load();
+    report.instructions = executed.load();
+    report.diverged = firstDiverging.load() < options.programs;
+    if (report.diverged)
+    {
+        LockstepDivergence &divergence = report.divergence;
+        divergence.index = firstDiverging.load();
+        divergence.original = generate(divergence.index);
+        divergence.reduced = shrink(divergence.original);
+        check(divergence.reduced, 1, divergence.reason, divergence.instruction);
+    }
+    report.seconds = std::chrono::duration<double>(Clock::now() - started).count();
+    return report;
+}
+
+void LockstepHarness::writeProgram(std::ostream &out, const LockstepCase &testCase)
+{
+    for (size_t i = 0; i + 2 < testCase.program.size(); i += 3)
+    {
+        for (size_t byte = 0; byte < 3; byte++)
+        {
+            std::string bits = std::bitset<8>(testCase.program[i + byte]).to_string();
+            out << (byte == 0 ? "" : " ") << bits.substr(0, 4) << " " << bits.substr(4);
+        }
+        out << "\n";
+    }
+}
+
+bool LockstepHarness::writeReproducer(const std::string &imagePath, const std::string &manifestPath, const LockstepCase &testCase,
+                                      std::string &error)
+{
+    std::vector<ImageSegment> segments;
+    segments.push_back({0x0000, SegmentKind::Code, testCase.program.data(), static_cast<uint32_t>(testCase.program.size())});
+    if (!testCase.data.empty())
+    {
+        segments.push_back({dataStart, SegmentKind::Data, testCase.data.data(), static_cast<uint32_t>(testCase.data.size())});
+    }
+    if (!ProgramImage::write(imagePath, 0x0000, static_cast<uint16_t>(testCase.program.size()), 0, segments, error))
+    {
+        return false;
+    }
+
+    std::ofstream manifest(manifestPath);
+    manifest << std::filesystem::absolute(imagePath).string() << " - name=lockstep budget=" << testCase.budget << "\n";
+    if (!manifest)
+    {
+        error = "Error: Cannot write " + manifestPath;
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,413 @@
+#include "MultiCore.h"
+#include "Trace.h"
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <sstream>
+#include <thread>
+
+namespace
+{
+    // Directory word: a bit per core holding the line, plus E/M state for a single holder
+    constexpr uint32_t sharerMask = 0xFFFF;
+    constexpr uint32_t exclusiveBit = 1u << 30;
+    constexpr uint32_t modifiedBit = 1u << 31;
+
+    constexpr size_t lineOf(uint16_t address) { return address / DataCache::lineSize; }
+
+    constexpr size_t pageWords = RAM::maxSize / RAM::pageSize / 64; // Bitmap of written pages
+}
+
+struct alignas(64) MultiCore::Core
+{
+    size_t index;
+    uint32_t bit;
+    CPU cpu;
+    uint8_t stack[0x100];
+    uint64_t executed;
+    uint64_t writtenPages[pageWords]; // Reported to RAM once every core has stopped
+    CoherenceCounters counters;
+    std::ostringstream errors; // This core's error log, merged into the caller's after the run
+};
+
+void CoherenceCounters::add(const CoherenceCounters &other)
+{
+    readHits += other.readHits;
+    readMisses += other.readMisses;
+    writeHits += other.writeHits;
+    writeMisses += other.writeMisses;
+    busReads += other.busReads;
+    busReadExclusive += other.busReadExclusive;
+    upgrades += other.upgrades;
+    invalidations += other.invalidations;
+    interventions += other.interventions;
+    writebacks += other.writebacks;
+    retries += other.retries;
+}
+
+void CoherenceCounters::writeJson(std::ostream &out) const
+{
+    out << "{\"read_hits\": " << std::dec << readHits << ", \"read_misses\": " << readMisses << ", \"write_hits\": " << writeHits
+        << ", \"write_misses\": " << writeMisses << ", \"bus_reads\": " << busReads << ", \"bus_read_exclusive\": " << busReadExclusive
+        << ", \"upgrades\": " << upgrades << ", \"invalidations\": " << invalidations << ", \"interventions\": " << interventions
+        << ", \"writebacks\": " << writebacks << ", \"retries\": " << retries << "}";
+}
+
+void MultiCoreReport::writeJson(std::ostream &out) const
+{
+    uint64_t instructions = 0;
+    for (uint64_t count : executed)
+    {
+        instructions += count;
+    }
+    out << "{\n  \"cores\": " << std::dec << executed.size() << ",\n  \"seconds\": " << seconds << ",\n  \"instructions\": " << instructions
+        << ",\n  \"instructions_per_second\": " << (seconds > 0 ? static_cast<double>(instructions) / seconds : 0.0)
+        << ",\n  \"coherence\": ";
+    total.writeJson(out);
+    out << ",\n  \"per_core\": [";
+    for (size_t index = 0; index < executed.size(); index++)
+    {
+        out << (index ? ",\n" : "\n") << "    {\"executed\": " << executed[index] << ", \"halted\": " << (halted[index] ? "true" : "false")
+            << ", \"coherence\": ";
+        cores[index].writeJson(out);
+        out << "}";
+    }
+    out << "\n  ]\n}";
+}
+
+MultiCore::MultiCore(RAM &ram, size_t coreCount) : ram(ram)
+{
+    for (size_t index = 0; index < coreCount; index++)
+    {
+        cores.push_back(std::make_unique<Core>());
+        cores.back()->index = index;
+        cores.back()->bit = index < maxCores ? 1u << index : 0;
+    }
+}
+
+MultiCore::~MultiCore() = default;
+
+CPU &MultiCore::core(size_t index)
+{
+    return cores[index]->cpu;
+}
+
+uint8_t MultiCore::readStack(size_t index, uint16_t address) const
+{
+    return cores[index]->stack[address % 0x100];
+}
+
+bool MultiCore::run(uint16_t end_address, uint64_t budget, MultiCoreReport &report, std::string &error)
+{
+    if (cores.empty() || cores.size() > maxCores)
+    {
+        error = "Multi-core runs need between 1 and " + std::to_string(maxCores) + " cores";
+        return false;
+    }
+
+    // Page tables only change here, before any core starts
+    const size_t pages = ram.size() / RAM::pageSize;
+    hostPages.assign(pages, nullptr);
+    for (size_t page = 0; page < pages; page++)
+    {
+        hostPages[page] = ram.pageData(static_cast<uint16_t>(page * RAM::pageSize));
+    }
+    // Every run starts with cold caches
+    const size_t lines = ram.size() / DataCache::lineSize;
+    directory = std::make_unique<std::atomic<uint32_t>[]>(lines);
+    for (size_t line = 0; line < lines; line++)
+    {
+        directory[line].store(0, std::memory_order_relaxed);
+    }
+    for (std::unique_ptr<Core> &core : cores)
+    {
+        core->cpu.cache.clear();
+        core->executed = 0;
+        core->counters = CoherenceCounters{};
+        core->errors.str("");
+        std::fill(std::begin(core->writtenPages), std::end(core->writtenPages), 0);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (std::unique_ptr<Core> &core : cores)
+    {
+        threads.emplace_back(&MultiCore::execute, this, std::ref(*core), end_address, budget);
+    }
+    for (std::thread &thread : threads)
+    {
+        thread.join();
+    }
+    report.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    for (const std::unique_ptr<Core> &core : cores)
+    {
+        errorLog() << core->errors.str();
+    }
+
+    report.executed.clear();
+    report.halted.clear();
+    report.cores.clear();
+    report.total = CoherenceCounters{};
+    uint64_t written[pageWords] = {};
+    for (const std::unique_ptr<Core> &core : cores)
+    {
+        report.executed.push_back(core->executed);
+        report.halted.push_back(core->cpu.isHalted());
+        report.cores.push_back(core->counters);
+        report.total.add(core->counters);
+        for (size_t word = 0; word < pageWords; word++)
+        {
+            written[word] |= core->writtenPages[word];
+        }
+    }
+    // Snapshots, RAM.txt and the shared image learn about the stores made through host pages
+    for (size_t page = 0; page < pages; page++)
+    {
+        if (written[page / 64] >> (page % 64) & 1)
+        {
+            ram.markStored(page * RAM::pageSize, RAM::pageSize);
+        }
+    }
+    return true;
+}
+
+void MultiCore::execute(Core &core, uint16_t end_address, uint64_t budget)
+{
+    CPU &cpu = core.cpu;
+    // errorLog() is per thread; buffer this core's messages so cores never share a stream
+    setErrorLog(&core.errors);
+    while (cpu.PC < end_address && core.executed < budget && !cpu.isHalted())
+    {
+        uint8_t opcode = fetch(cpu.PC);
+        uint16_t operand = static_cast<uint16_t>(fetch(cpu.PC + 1) << 8 | fetch(cpu.PC + 2));
+        switch (opcode)
+        {
+        case 0b0000: // ADC: M = A + M
+        {
+            uint8_t value = modify(core, operand, cpu.A, false);
+            cpu.flags.arithmetic(LazyFlags::Add, cpu.A, value, static_cast<uint8_t>(cpu.A + value));
+            break;
+        }
+        case 0b0001: // SBC: M = M - A
+        {
+            uint8_t value = modify(core, operand, cpu.A, true);
+            cpu.flags.arithmetic(LazyFlags::Subtract, value, cpu.A, static_cast<uint8_t>(value - cpu.A));
+            break;
+        }
+        case 0b0010: // LDA
+            cpu.A = read(core, operand);
+            cpu.flags.logic(cpu.A);
+            break;
+        case 0b0011: // AND
+            cpu.A &= read(core, operand);
+            cpu.flags.logic(cpu.A);
+            break;
+        case 0b0100: // EOR
+            cpu.A ^= read(core, operand);
+            cpu.flags.logic(cpu.A);
+            break;
+        case 0b0101: // JMP
+            cpu.PC = operand;
+            break;
+        case 0b0110: // PSH: the stack region is private to the core
+            if (cpu.SP >= 0x100 && cpu.SP < 0x200)
+                core.stack[cpu.SP - 0x100] = cpu.A;
+            else
+                errorLog() << "Core " << core.index << ": stack write out of range. Address: 0x" << std::hex << cpu.SP << std::dec << std::endl;
+            cpu.SP++;
+            break;
+        case 0b0111: // POP
+            cpu.SP--;
+            cpu.A = cpu.SP >= 0x100 && cpu.SP < 0x200 ? core.stack[cpu.SP - 0x100] : loadShared(cpu.SP);
+            cpu.flags.logic(cpu.A);
+            break;
+        case 0b1000: // HLT
+            cpu.STATUS |= CPU::haltFlag;
+            break;
+        default:
+            cpu.NOP(opcode);
+            break;
+        }
+        cpu.PC += 3;
+        core.executed++;
+    }
+}
+
+uint8_t MultiCore::loadShared(uint16_t address)
+{
+    // RAM and ROM reads are relaxed atomic loads; a device may change state when read
+    if (address < ram.size() && ram.getPageKind(address) == PageKind::Device)
+    {
+        std::lock_guard<std::mutex> lock(busLock);
+        return ram.readByte(address);
+    }
+    return ram.readByte(address);
+}
+
+uint8_t MultiCore::fetch(uint16_t address)
+{
+    // No core can store to the instruction region, so fetches skip the caches
+    return loadShared(address);
+}
+
+uint8_t MultiCore::read(Core &core, uint16_t address)
+{
+    uint8_t *page = address < ram.size() ? hostPages[address / RAM::pageSize] : nullptr;
+    if (page == nullptr)
+    {
+        return loadShared(address); // ROM, devices and out-of-range reads are uncached
+    }
+
+    uint8_t cached;
+    bool present = core.cpu.cache.lookup(address, cached);
+    uint32_t state = directory[lineOf(address)].load(std::memory_order_acquire);
+    if (present && (state & core.bit))
+    {
+        core.counters.readHits++;
+    }
+    else
+    {
+        if (present)
+        {
+            core.cpu.cache.invalidate(address); // Another core's store invalidated it
+        }
+        core.counters.readMisses++;
+        core.counters.busReads++;
+        claimLine(core, address, false, false);
+        fillLine(core, address);
+    }
+    // The value comes from RAM even on a hit, so a race in the protocol can only miscount traffic
+    return std::atomic_ref<uint8_t>(page[address % RAM::pageSize]).load();
+}
+
+uint8_t MultiCore::modify(Core &core, uint16_t address, uint8_t operand, bool subtract)
+{
+    uint8_t *page = address >= 0x200 && address < ram.size() ? hostPages[address / RAM::pageSize] : nullptr;
+    if (page == nullptr)
+    {
+        // RAM's region checks and error reports, ROM and devices
+        std::lock_guard<std::mutex> lock(busLock);
+        uint8_t value = ram.readByte(address);
+        ram.writeByte(address, static_cast<uint8_t>(subtract ? value - operand : value + operand));
+        return value;
+    }
+
+    uint8_t cached;
+    bool present = core.cpu.cache.lookup(address, cached);
+    uint32_t state = directory[lineOf(address)].load(std::memory_order_acquire);
+    bool held = present && (state & core.bit);
+    if (held && (state & exclusiveBit))
+    {
+        core.counters.writeHits++;
+        if (!(state & modifiedBit))
+        {
+            claimLine(core, address, true, true); // Silent E to M
+        }
+    }
+    else
+    {
+        if (present && !held)
+        {
+            core.cpu.cache.invalidate(address);
+        }
+        core.counters.writeMisses++;
+        (held ? core.counters.upgrades : core.counters.busReadExclusive)++;
+        claimLine(core, address, true, held);
+    }
+
+    std::atomic_ref<uint8_t> byte(page[address % RAM::pageSize]);
+    uint8_t value = subtract ? byte.fetch_sub(operand) : byte.fetch_add(operand);
+    core.writtenPages[address / RAM::pageSize / 64] |= uint64_t(1) << (address / RAM::pageSize % 64);
+    if (held || core.cpu.cache.contains(address))
+    {
+        core.cpu.cache.update(address, static_cast<uint8_t>(subtract ? value - operand : value + operand));
+    }
+    else
+    {
+        fillLine(core, address);
+    }
+    return value;
+}
+
+void MultiCore::claimLine(Core &core, uint16_t address, bool exclusive, bool wasPresent)
+{
+    std::atomic<uint32_t> &word = directory[lineOf(address)];
+    uint32_t state = word.load(std::memory_order_acquire);
+    uint32_t others;
+    while (true)
+    {
+        others = state & sharerMask & ~core.bit;
+        uint32_t desired = core.bit | exclusiveBit | modifiedBit;
+        if (!exclusive)
+        {
+            // Read: join the sharers, or take the line in E if nobody else holds it
+            desired = (state & sharerMask) | core.bit;
+            if (others == 0)
+            {
+                desired |= exclusiveBit | (wasPresent ? state & modifiedBit : 0);
+            }
+        }
+        if (word.compare_exchange_weak(state, desired, std::memory_order_acq_rel, std::memory_order_acquire))
+        {
+            break;
+        }
+        core.counters.retries++;
+    }
+
+    if (others == 0)
+    {
+        return;
+    }
+    if (exclusive)
+    {
+        core.counters.invalidations += static_cast<uint64_t>(std::popcount(others));
+    }
+    else if (state & exclusiveBit)
+    {
+        core.counters.interventions++;
+    }
+    if (state & modifiedBit)
+    {
+        core.counters.writebacks++; // The previous owner supplies its modified line
+    }
+}
+
+void MultiCore::fillLine(Core &core, uint16_t address)
+{
+    // Lines never cross a page, so one host page holds the whole line
+    const uint16_t first = static_cast<uint16_t>(address & ~(DataCache::lineSize - 1));
+    uint8_t *page = hostPages[first / RAM::pageSize];
+    for (size_t offset = 0; offset < DataCache::lineSize; offset++)
+    {
+        uint16_t at = static_cast<uint16_t>(first + offset);
+        uint8_t value = std::atomic_ref<uint8_t>(page[at % RAM::pageSize]).load();
+        uint16_t evicted;
+        if (core.cpu.cache.updateEvicting(at, value, evicted))
+        {
+            releaseLine(core, lineOf(evicted));
+        }
+    }
+}
+
+void MultiCore::releaseLine(Core &core, size_t line)
+{
+    std::atomic<uint32_t> &word = directory[line];
+    uint32_t state = word.load(std::memory_order_acquire);
+    while (state & core.bit)
+    {
+        uint32_t desired = state & ~core.bit;
+        if ((desired & sharerMask) == 0)
+        {
+            desired = 0;
+        }
+        if (word.compare_exchange_weak(state, desired, std::memory_order_acq_rel, std::memory_order_acquire))
+        {
+            if ((state & modifiedBit) && (state & sharerMask) == core.bit)
+            {
+                core.counters.writebacks++;
+            }
+            return;
+        }
+        core.counters.retries++;
+    }
+}
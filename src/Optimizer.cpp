@@ -0,0 +1,195 @@
+#include "Optimizer.h"
+#include <sstream>
+
+namespace
+{
+    bool isStack(uint16_t address)
+    {
+        return address >= 0x100 && address < 0x200;
+    }
+
+    bool isDevice(const RAM &ram, uint16_t address)
+    {
+        return address < ram.size() && ram.getPageKind(address) == PageKind::Device;
+    }
+
+    bool hasDevices(const RAM &ram)
+    {
+        for (size_t address = 0; address < ram.size(); address += RAM::pageSize)
+        {
+            if (ram.getPageKind(static_cast<uint16_t>(address)) == PageKind::Device)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    const char *opcodeName(uint8_t opcode)
+    {
+        return CPUCounters::opcodeName(DecodeCache::opcodeIndex(opcode));
+    }
+
+    const char *endName(PathEnd end)
+    {
+        switch (end)
+        {
+        case PathEnd::End:
+            return "end";
+        case PathEnd::Halt:
+            return "halt";
+        case PathEnd::Loop:
+            return "loop";
+        default:
+            return "unknown";
+        }
+    }
+}
+
+ProgramAnalysis analyzeProgram(const CPU &cpu, const RAM &ram, uint16_t end_address)
+{
+    ProgramAnalysis analysis{{}, 0, PathEnd::Unknown, false};
+
+    // 1. Follow the single successor of every instruction until the path exits or closes on itself
+    std::map<uint16_t, size_t> onPath;
+    uint16_t pc = cpu.PC;
+    while (true)
+    {
+        if (pc >= end_address)
+        {
+            analysis.end = PathEnd::End;
+            break;
+        }
+        if (pc > DecodeCache::programSize - 3)
+        {
+            analysis.end = PathEnd::Unknown;
+            break;
+        }
+        if (onPath.count(pc))
+        {
+            analysis.end = PathEnd::Loop;
+            break;
+        }
+        uint8_t opcode = ram.readByte(pc);
+        if (opcode == opcodes::HLT)
+        {
+            analysis.end = PathEnd::Halt;
+            break;
+        }
+        uint16_t operand = static_cast<uint16_t>(ram.readByte(pc + 1) << 8 | ram.readByte(pc + 2));
+        onPath[pc] = analysis.path.size();
+        analysis.path.push_back(InstructionFacts{pc, opcode, operand, false});
+        pc = opcode == opcodes::JMP ? static_cast<uint16_t>(operand + 3) : static_cast<uint16_t>(pc + 3);
+    }
+    analysis.prefixLength = analysis.end == PathEnd::Loop ? onPath[pc] : analysis.path.size();
+
+    // 2. Look for data accesses that may reach a device. Operands are constants, and SP moves by
+    // one per PSH or POP whatever the data, so it is exact through the prefix, and around the loop
+    // when a pass leaves it where it started. PSH only ever writes the stack region
+    uint16_t sp = cpu.SP;
+    bool loopPops = false;
+    auto visit = [&](InstructionFacts &facts)
+    {
+        if (facts.opcode <= opcodes::EOR)
+        {
+            analysis.touchesDevices = analysis.touchesDevices || isDevice(ram, facts.operand);
+        }
+        else if (facts.opcode == opcodes::PSH)
+        {
+            sp++;
+        }
+        else if (facts.opcode == opcodes::POP)
+        {
+            sp--;
+            analysis.touchesDevices = analysis.touchesDevices || isDevice(ram, sp);
+            loopPops = loopPops || facts.repeats;
+        }
+    };
+    for (size_t index = 0; index < analysis.prefixLength; index++)
+    {
+        visit(analysis.path[index]);
+    }
+    if (analysis.end == PathEnd::Loop)
+    {
+        uint16_t entry = sp;
+        for (size_t index = analysis.prefixLength; index < analysis.path.size(); index++)
+        {
+            analysis.path[index].repeats = true;
+            visit(analysis.path[index]);
+        }
+        // SP drifts on every pass, so a POP in the loop may eventually read any address
+        if (sp != entry && loopPops)
+        {
+            analysis.touchesDevices = analysis.touchesDevices || hasDevices(ram);
+        }
+    }
+    return analysis;
+}
+
+void ProgramAnalysis::writeJson(std::ostream &out) const
+{
+    out << "{\"end\": \"" << endName(end) << "\", \"prefix\": " << std::dec << prefixLength << ", \"devices\": " << (touchesDevices ? "true" : "false")
+        << ", \"path\": [";
+    for (size_t index = 0; index < path.size(); index++)
+    {
+        const InstructionFacts &facts = path[index];
+        out << (index ? ", " : "") << "{\"pc\": " << facts.pc << ", \"op\": \"" << opcodeName(facts.opcode) << "\", \"operand\": " << facts.operand
+            << ", \"repeats\": " << (facts.repeats ? "true" : "false") << "}";
+    }
+    out << "]}";
+}
+
+bool capturePrefix(CPU &cpu, RAM &ram, uint16_t end_address, const ProgramAnalysis &analysis, const std::ostringstream &errors,
+                   PrecomputedPrefix &prefix)
+{
+    std::vector<uint8_t> before(ram.size());
+    for (size_t address = 0; address < ram.size(); address++)
+    {
+        before[address] = ram.readByte(static_cast<uint16_t>(address));
+    }
+    size_t logged = errors.str().size();
+
+    prefix.instructions = cpu.run(ram, end_address, analysis.prefixLength);
+    if (prefix.instructions != analysis.prefixLength)
+    {
+        return false;
+    }
+
+    prefix.cpu = cpu.snapshot();
+    prefix.writes.clear();
+    for (size_t address = 0; address < ram.size(); address++)
+    {
+        uint8_t value = ram.readByte(static_cast<uint16_t>(address));
+        if (value != before[address])
+            prefix.writes.push_back({static_cast<uint16_t>(address), value});
+    }
+    prefix.log = errors.str().substr(logged);
+    return true;
+}
+
+void applyPrefix(CPU &cpu, RAM &ram, const PrecomputedPrefix &prefix)
+{
+    for (const auto &[address, value] : prefix.writes)
+    {
+        if (isStack(address))
+            ram.writeStackByte(address, value);
+        else
+            ram.writeByte(address, value);
+    }
+    cpu.restore(prefix.cpu);
+    errorLog() << prefix.log;
+}
+
+std::shared_ptr<const PrecomputedPrefix> PrefixCache::find(const std::string &key, bool &claimed)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    auto found = entries.find(key);
+    claimed = found == entries.end() && claims.insert(key).second;
+    return found != entries.end() ? found->second : nullptr;
+}
+
+void PrefixCache::store(const std::string &key, const PrecomputedPrefix &prefix)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    entries[key] = std::make_shared<const PrecomputedPrefix>(prefix);
+}
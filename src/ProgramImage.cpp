@@ -0,0 +1,228 @@
+#include "ProgramImage.h"
+#include "RAM.h"
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define SCC_HAVE_MMAP 1
+#else
+#define SCC_HAVE_MMAP 0
+#endif
+
+namespace
+{
+    uint16_t read16(const uint8_t *p) { return static_cast<uint16_t>(p[0] | p[1] << 8); }
+    uint32_t read32(const uint8_t *p) { return read16(p) | static_cast<uint32_t>(read16(p + 2)) << 16; }
+    uint64_t read64(const uint8_t *p) { return read32(p) | static_cast<uint64_t>(read32(p + 4)) << 32; }
+
+    void put(std::vector<uint8_t> &out, uint64_t value, int bytes)
+    {
+        for (int i = 0; i < bytes; i++)
+        {
+            out.push_back(static_cast<uint8_t>(value >> (8 * i)));
+        }
+    }
+
+    // Region rules of RAM::writeInstructionByte, writeStackByte and writeByte
+    bool fitsRegion(const ImageSegment &segment)
+    {
+        uint32_t last = segment.address + segment.length;
+        switch (segment.kind)
+        {
+        case SegmentKind::Code:
+            return last <= 0x100;
+        case SegmentKind::Stack:
+            return segment.address >= 0x100 && last <= 0x200;
+        case SegmentKind::Data:
+            return segment.address >= 0x200 && last <= 0x10000;
+        default:
+            return false;
+        }
+    }
+}
+
+ProgramImage::ProgramImage() : base(nullptr), length(0), mapped(false), entry(0), end(0), sourceStamp(0)
+{
+}
+
+ProgramImage::~ProgramImage()
+{
+    close();
+}
+
+bool ProgramImage::open(const std::string &path, std::string &error)
+{
+    close();
+#if SCC_HAVE_MMAP
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        error = "Error opening image " + path;
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size < static_cast<off_t>(headerSize))
+    {
+        ::close(fd);
+        error = "Error: " + path + " is not a program image";
+        return false;
+    }
+    length = static_cast<size_t>(info.st_size);
+    void *mapping = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED)
+    {
+        length = 0;
+        error = "Error mapping image " + path;
+        return false;
+    }
+    base = static_cast<const uint8_t *>(mapping);
+    mapped = true;
+#else
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open())
+    {
+        error = "Error opening image " + path;
+        return false;
+    }
+    buffer.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    base = buffer.data();
+    length = buffer.size();
+#endif
+    if (!parse(error))
+    {
+        error = path + ": " + error;
+        close();
+        return false;
+    }
+    return true;
+}
+
+void ProgramImage::close()
+{
+#if SCC_HAVE_MMAP
+    if (mapped)
+    {
+        munmap(const_cast<uint8_t *>(base), length);
+    }
+#endif
+    base = nullptr;
+    length = 0;
+    mapped = false;
+    buffer.clear();
+    segments.clear();
+    entry = end = 0;
+    sourceStamp = 0;
+}
+
+bool ProgramImage::parse(std::string &error)
+{
+    if (length < headerSize || read32(base) != MAGIC)
+    {
+        error = "not a program image";
+        return false;
+    }
+    if (read16(base + 4) != VERSION)
+    {
+        error = "unsupported image version";
+        return false;
+    }
+    uint16_t segmentCount = read16(base + 6);
+    entry = read16(base + 8);
+    end = read16(base + 10);
+    sourceStamp = read64(base + 16);
+    if (headerSize + segmentCount * segmentEntrySize > length)
+    {
+        error = "truncated segment table";
+        return false;
+    }
+
+    segments.clear();
+    for (uint16_t i = 0; i < segmentCount; i++)
+    {
+        const uint8_t *entryBytes = base + headerSize + i * segmentEntrySize;
+        uint32_t offset = read32(entryBytes + 4);
+        ImageSegment segment{read16(entryBytes), static_cast<SegmentKind>(read16(entryBytes + 2)), nullptr, read32(entryBytes + 8)};
+        if (static_cast<uint64_t>(offset) + segment.length > length || !fitsRegion(segment))
+        {
+            error = "segment " + std::to_string(i) + " is out of range";
+            return false;
+        }
+        segment.bytes = base + offset;
+        segments.push_back(segment);
+    }
+    return true;
+}
+
+bool ProgramImage::loadInto(RAM &ram) const
+{
+    for (const ImageSegment &segment : segments)
+    {
+        if (!ram.loadBytes(segment.address, segment.bytes, segment.length))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool ProgramImage::write(const std::string &path, uint16_t entry, uint16_t end, uint64_t sourceStamp,
+                         const std::vector<ImageSegment> &segments, std::string &error)
+{
+    std::vector<uint8_t> out;
+    put(out, MAGIC, 4);
+    put(out, VERSION, 2);
+    put(out, segments.size(), 2);
+    put(out, entry, 2);
+    put(out, end, 2);
+    put(out, 0, 4); // Reserved
+    put(out, sourceStamp, 8);
+    put(out, 0, 8); // Reserved
+
+    uint32_t offset = static_cast<uint32_t>(headerSize + segments.size() * segmentEntrySize);
+    for (const ImageSegment &segment : segments)
+    {
+        if (!fitsRegion(segment))
+        {
+            error = "Error: image segment at address " + std::to_string(segment.address) + " is outside its region";
+            return false;
+        }
+        put(out, segment.address, 2);
+        put(out, static_cast<uint16_t>(segment.kind), 2);
+        put(out, offset, 4);
+        put(out, segment.length, 4);
+        offset += segment.length;
+    }
+    for (const ImageSegment &segment : segments)
+    {
+        out.insert(out.end(), segment.bytes, segment.bytes + segment.length);
+    }
+
+    // Unique temporary name per writer, so concurrent conversions of one program never interleave
+    static std::atomic<uint64_t> writeCount{0};
+    std::string temporary = path + ".tmp" + std::to_string(std::hash<std::thread::id>{}(std::this_thread::get_id())) +
+                            "_" + std::to_string(writeCount.fetch_add(1));
+    {
+        std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+        if (!file.is_open() || !file.write(reinterpret_cast<const char *>(out.data()), static_cast<std::streamsize>(out.size())))
+        {
+            error = "Error writing image " + path;
+            return false;
+        }
+    }
+    std::error_code renameError;
+    std::filesystem::rename(temporary, path, renameError);
+    if (renameError)
+    {
+        std::filesystem::remove(temporary, renameError);
+        error = "Error writing image " + path;
+        return false;
+    }
+    return true;
+}
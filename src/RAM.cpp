@@ -1,162 +1,552 @@
 #include "RAM.h"
+#include "HexDump.h"
+#include <algorithm>
+#include <cstring>
 
-RAM::RAM()
+namespace
 {
+    // Every untouched RAM page reads from here. Nothing ever writes it
+    alignas(64) uint8_t zeroPage[RAM::pageSize] = {};
+
+    const std::shared_ptr<const RAMSnapshot::Page> &zeroSnapshotPage()
+    {
+        static const std::shared_ptr<const RAMSnapshot::Page> page = std::make_shared<const RAMSnapshot::Page>();
+        return page;
+    }
+}
+
+RAM::RAM() : RAM(DumpMode::Interval)
+{
+}
+
+RAM::RAM(DumpMode dumpMode, std::chrono::milliseconds dumpInterval) : RAM(defaultSize, dumpMode, dumpInterval)
+{
+}
+
+RAM::RAM(size_t size, DumpMode dumpMode, std::chrono::milliseconds dumpInterval, const std::string &dumpPath)
+    : layoutVersion(0), dumpPath(dumpPath), codeWriteCount(0), codeWriteLog{}
+{
+    static std::atomic<uint64_t> nextId{1};
+    id = nextId.fetch_add(1, std::memory_order_relaxed);
+
     // Constructor implementation
-    memory.resize(2 * 1024, 0);
-    dump_memory();
+    if (size > maxSize)
+    {
+        errorLog() << "Error: RAM size 0x" << std::hex << size << " exceeds the 16-bit address space." << std::dec << std::endl;
+        size = maxSize;
+    }
+    memorySize = (size + pageSize - 1) / pageSize * pageSize;
+    pageCount = memorySize / pageSize;
+    for (size_t page = 0; page < maxPages; page++)
+    {
+        readPages[page].store(zeroPage, std::memory_order_relaxed);
+        writePages[page].store(nullptr, std::memory_order_relaxed);
+        kinds[page] = PageKind::RAM;
+        devices[page] = nullptr;
+    }
+    baseline.resize(pageCount);
+    pageDirty.resize((pageCount + 63) / 64, 0);
+    setDumpMode(dumpMode, dumpInterval);
 }
 
 RAM::~RAM()
 {
-    // Destructor implementation
-    memory.clear();
+    // Destructor implementation. Stop the dumper first so its final flush sees the memory
+    dumper.reset();
+    shared.reset();
+}
+
+void RAM::setDumpMode(DumpMode mode, std::chrono::milliseconds interval)
+{
+    dumper.reset();
+    if (mode != DumpMode::Disabled)
+    {
+        dumper = std::make_unique<RAMDumper>(*this, dumpPath, mode, interval);
+    }
+}
+
+bool RAM::mapShared(const std::string &name)
+{
+    std::unique_ptr<SharedRAMImage> image = std::make_unique<SharedRAMImage>();
+    if (!image->create(name, static_cast<uint32_t>(memorySize)))
+    {
+        return false;
+    }
+
+    // Park the dumper while the backing store moves under it
+    DumpMode dumpMode = dumper ? dumper->getMode() : DumpMode::Disabled;
+    std::chrono::milliseconds dumpInterval = dumper ? dumper->getInterval() : RAMDumper::defaultInterval;
+    dumper.reset();
+
+    // Carry the current contents over, then serve every memory page from the image
+    for (size_t address = 0; address < memorySize; address++)
+    {
+        image->getData()[address] = peekByte(address);
+    }
+    for (size_t page = 0; page < pageCount; page++)
+    {
+        if (kinds[page] == PageKind::Device)
+        {
+            continue;
+        }
+        uint8_t *data = image->getData() + page * pageSize;
+        writePages[page].store(kinds[page] == PageKind::RAM ? data : nullptr, std::memory_order_relaxed);
+        readPages[page].store(data, std::memory_order_release);
+    }
+    for (std::unique_ptr<RAMSnapshot::Page> &page : ownedPages)
+    {
+        page.reset();
+    }
+    shared = std::move(image);
+    layoutVersion++;
+    setDumpMode(dumpMode, dumpInterval);
+    return true;
+}
+
+uint8_t *RAM::allocatePage(size_t page)
+{
+    uint8_t *data;
+    if (shared)
+    {
+        data = shared->getData() + page * pageSize;
+    }
+    else
+    {
+        ownedPages[page] = std::make_unique<RAMSnapshot::Page>();
+        data = ownedPages[page]->data();
+    }
+    if (kinds[page] == PageKind::RAM)
+    {
+        writePages[page].store(data, std::memory_order_relaxed);
+    }
+    readPages[page].store(data, std::memory_order_release);
+    return data;
+}
+
+bool RAM::storeByte(uint16_t address, uint8_t value)
+{
+    size_t page = address / pageSize;
+    uint8_t *data = writePages[page].load(std::memory_order_relaxed);
+    if (data == nullptr) [[unlikely]]
+    {
+        switch (kinds[page])
+        {
+        case PageKind::RAM:
+            data = allocatePage(page);
+            break;
+        case PageKind::ROM:
+            return false;
+        case PageKind::Device:
+            return devices[page]->write(address, value);
+        }
+    }
+    std::atomic_ref<uint8_t>(data[address % pageSize]).store(value, std::memory_order_relaxed);
+    markPageDirty(address);
+    publishStore(address, 1);
+    return true;
+}
+
+uint8_t *RAM::backingPage(size_t page)
+{
+    uint8_t *data = kinds[page] == PageKind::ROM ? readPages[page].load(std::memory_order_relaxed)
+                                                 : writePages[page].load(std::memory_order_relaxed);
+    return data != nullptr ? data : allocatePage(page);
+}
+
+void RAM::rawStore(size_t address, uint8_t value)
+{
+    std::atomic_ref<uint8_t>(backingPage(address / pageSize)[address % pageSize]).store(value, std::memory_order_relaxed);
+    markPageDirty(address);
+}
+
+bool RAM::checkRegion(uint16_t address, size_t length, const char *what) const
+{
+    if (address % pageSize != 0 || length == 0 || length % pageSize != 0 || address < 512 || address + length > memorySize)
+    {
+        errorLog() << "Error: " << what << " region at 0x" << std::hex << address << ", length 0x" << length
+                   << " is not whole pages inside the data region." << std::dec << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool RAM::mapROM(uint16_t address, size_t length, const uint8_t *data, size_t dataLength)
+{
+    if (!checkRegion(address, length, "ROM"))
+    {
+        return false;
+    }
+    for (size_t page = address / pageSize; page < (address + length) / pageSize; page++)
+    {
+        uint8_t *backing = kinds[page] == PageKind::Device ? allocatePage(page) : backingPage(page);
+        for (size_t i = 0; i < pageSize; i++)
+        {
+            size_t offset = page * pageSize + i - address;
+            std::atomic_ref<uint8_t>(backing[i]).store(offset < dataLength ? data[offset] : 0, std::memory_order_relaxed);
+        }
+        kinds[page] = PageKind::ROM;
+        devices[page] = nullptr;
+        writePages[page].store(nullptr, std::memory_order_relaxed);
+        readPages[page].store(backing, std::memory_order_release);
+        markPageDirty(page * pageSize);
+    }
+    publishStore(address, length);
+    layoutVersion++;
+    return true;
+}
+
+bool RAM::mapDevice(uint16_t address, size_t length, MemoryDevice *device)
+{
+    if (device == nullptr || !checkRegion(address, length, "Device"))
+    {
+        return false;
+    }
+    for (size_t page = address / pageSize; page < (address + length) / pageSize; page++)
+    {
+        kinds[page] = PageKind::Device;
+        devices[page] = device;
+        writePages[page].store(nullptr, std::memory_order_relaxed);
+        readPages[page].store(nullptr, std::memory_order_release);
+        markPageDirty(page * pageSize);
+    }
+    publishStore(address, length);
+    layoutVersion++;
+    return true;
+}
+
+size_t RAM::getAllocatedPages() const
+{
+    size_t allocated = 0;
+    for (size_t page = 0; page < pageCount; page++)
+    {
+        uint8_t *data = readPages[page].load(std::memory_order_relaxed);
+        allocated += data != nullptr && data != zeroPage ? 1 : 0;
+    }
+    return allocated;
+}
+
+uint64_t RAM::contentHash() const
+{
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (size_t page = 0; page < pageCount; page++)
+    {
+        const uint8_t *data = readPages[page].load(std::memory_order_relaxed);
+        for (size_t offset = 0; offset < pageSize; offset += sizeof(uint64_t))
+        {
+            uint64_t word = 0;
+            if (data != nullptr)
+            {
+                std::memcpy(&word, data + offset, sizeof(word));
+            }
+            hash = (hash ^ word) * 0x100000001b3ULL;
+            hash ^= hash >> 29;
+        }
+    }
+    return hash;
+}
+
+uint8_t *RAM::pageData(uint16_t address)
+{
+    if (address >= memorySize || kinds[address / pageSize] != PageKind::RAM)
+    {
+        return nullptr;
+    }
+    uint8_t *data = writePages[address / pageSize].load(std::memory_order_relaxed);
+    return data != nullptr ? data : allocatePage(address / pageSize);
+}
+
+void RAM::publishStore(size_t address, size_t length)
+{
+    if (shared)
+    {
+        // Single writer, so a plain load/store pair is enough to publish the change
+        std::atomic<uint64_t> &generation = shared->getHeader()->generation;
+        generation.store(generation.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+    if (dumper)
+    {
+        for (size_t line = address / RAMDumper::bytesPerLine * RAMDumper::bytesPerLine; line < address + length; line += RAMDumper::bytesPerLine)
+        {
+            dumper->markDirty(static_cast<uint16_t>(line));
+        }
+    }
+}
+
+void RAM::markStored(size_t address, size_t length)
+{
+    for (size_t page = address / RAMSnapshot::pageSize; page * RAMSnapshot::pageSize < address + length; page++)
+    {
+        markPageDirty(page * RAMSnapshot::pageSize);
+    }
+    publishStore(address, length);
 }
 
 // Additional method to read a byte at a specific address
 uint8_t RAM::readByte(uint16_t address) const
 {
-    if (address < memory.size())
+    if (address < memorySize)
     {
         // Check if the address is within the valid range
-        return memory[address];
+        return loadByte(address);
     }
     else
     {
         // Handle out-of-bounds access
-        std::cerr << "Error: Attempted to read from invalid memory address." << std::endl;
+        errorLog() << "Error: Attempted to read from invalid memory address." << std::endl;
         return 0xFF; // Return a default value 
     }
 }
-void RAM::writeInstructionByte(uint16_t address, uint8_t value)
+bool RAM::writeInstructionByte(uint16_t address, uint8_t value)
 {
-    if (address < memory.size())
+    if (address < memorySize)
     {
         if (address < 256)
         {
-            memory[address] = value;
-            std::cerr << "Wrote to instruction space memory address."
-                      << " Address: 0x" << std::hex << address
-                      << ", Memory Size: 0x" << memory.size() << std::endl;
+            storeByte(address, value);
+            logCodeWrite(address);
+            if constexpr (ActiveTrace::enabled)
+            {
+                errorLog() << "Wrote to instruction space memory address."
+                          << " Address: 0x" << std::hex << address
+                          << ", Memory Size: 0x" << memorySize << std::endl;
+            }
+            return true;
         }
         else
         {
-            std::cerr << "Error: Attempted to write instruction byte outside the Instruction space." << std::endl;
+            errorLog() << "Error: Attempted to write instruction byte outside the Instruction space." << std::endl;
+            return false;
         }
     }
     else
     {
         // Handle out-of-bounds access
-        std::cerr << "Error: Attempted to write to invalid memory address."
+        errorLog() << "Error: Attempted to write to invalid memory address."
                   << " Address: 0x" << std::hex << address
-                  << ", Memory Size: 0x" << memory.size() << std::endl;
+                  << ", Memory Size: 0x" << memorySize << std::endl;
+        return false;
     }
-    dump_memory();
 }
 
-void RAM::writeStackByte(uint16_t address, uint8_t value)
+bool RAM::loadBytes(uint16_t address, const uint8_t *data, size_t length)
 {
-    if (address < memory.size())
+    if (address + length > memorySize)
+    {
+        errorLog() << "Error: Image segment does not fit in memory."
+                  << " Address: 0x" << std::hex << address
+                  << ", Length: 0x" << length
+                  << ", Memory Size: 0x" << memorySize << std::dec << std::endl;
+        return false;
+    }
+
+    for (size_t page = address / pageSize; page * pageSize < address + length; page++)
+    {
+        if (kinds[page] == PageKind::Device)
+        {
+            errorLog() << "Error: Image segment overlaps a device page at 0x" << std::hex << page * pageSize << std::dec << std::endl;
+            return false;
+        }
+    }
+
+    for (size_t i = 0; i < length; i++)
+    {
+        rawStore(address + i, data[i]);
+    }
+    // Code bytes go through the write log like writeInstructionByte, so decoded instructions are dropped
+    for (size_t target = address; target < address + length && target < 256; target++)
+    {
+        logCodeWrite(static_cast<uint16_t>(target));
+    }
+    if (length > 0)
+    {
+        publishStore(address, length);
+    }
+    return true;
+}
+
+bool RAM::writeStackByte(uint16_t address, uint8_t value)
+{
+    if (address < memorySize)
     {
         if (address < 512 && address >= 256)
         {
-            memory[address] = value;
-            std::cerr << "Wrote to stack space memory address."
-                      << " Address: 0x" << std::hex << address
-                      << ", Memory Size: 0x" << memory.size() << std::endl;
+            storeByte(address, value);
+            if constexpr (ActiveTrace::enabled)
+            {
+                errorLog() << "Wrote to stack space memory address."
+                          << " Address: 0x" << std::hex << address
+                          << ", Memory Size: 0x" << memorySize << std::endl;
+            }
+            return true;
         }
         else
         {
-            std::cerr << "Error: Attempted to write instruction byte outside the Instruction space." << std::endl;
+            errorLog() << "Error: Attempted to write instruction byte outside the Instruction space." << std::endl;
+            return false;
         }
     }
     else
     {
         // Handle out-of-bounds access
-        std::cerr << "Error: Attempted to write to invalid memory address."
+        errorLog() << "Error: Attempted to write to invalid memory address."
                   << " Address: 0x" << std::hex << address
-                  << ", Memory Size: 0x" << memory.size() << std::endl;
+                  << ", Memory Size: 0x" << memorySize << std::endl;
+        return false;
     }
-    dump_memory();
 }
 
-void RAM::writeByte(uint16_t address, uint8_t value)
+bool RAM::writeByte(uint16_t address, uint8_t value)
 {
-    if (address < memory.size())
+    if (address < memorySize)
     {
         // Check if the address is within the valid range
         if (address < 512)
         {
-            std::cerr << "Error: Attempted to write to reserved instruction or stack space." << std::endl;
+            errorLog() << "Error: Attempted to write to reserved instruction or stack space." << std::endl;
+            return false;
+        }
+        else if (!storeByte(address, value))
+        {
+            errorLog() << "Error: Attempted to write to read-only memory or a device that refused the store."
+                      << " Address: 0x" << std::hex << address << std::endl;
+            return false;
         }
         else
         {
-            memory[address] = value;
-            std::cerr << "Wrote to memory address."
-                      << " Address: 0x" << std::hex << address
-                      << ", Memory Size: 0x" << memory.size() << std::endl;
+            if constexpr (ActiveTrace::enabled)
+            {
+                errorLog() << "Wrote to memory address."
+                          << " Address: 0x" << std::hex << address
+                          << ", Memory Size: 0x" << memorySize << std::endl;
+            }
+            return true;
         }
     }
     else
     {
         // Handle out-of-bounds access
-        std::cerr << "Error: Attempted to write to invalid memory address."
+        errorLog() << "Error: Attempted to write to invalid memory address."
                   << " Address: 0x" << std::hex << address
-                  << ", Memory Size: 0x" << memory.size() << std::endl;
+                  << ", Memory Size: 0x" << memorySize << std::endl;
+        return false;
     }
-    dump_memory();
 }
 
-void RAM::dump_memory_at_address(uint16_t address, std::ostream& out) const {
-    // Every 16 bytes, create a line of dump output in hexadecimal
-    // Print starting address of bytes in this line of output
-    out << "Address 0x" << std::hex << std::setw(4) << address << ": ";
-
-    // Print sixteen bytes in memory from starting address
-    for (int i = 0; i < 64; i++) {
-        if (address + i < memory.size()) {
-            uint8_t byte = readByte(address + i);
-            out << std::hex << std::setw(2) << std::setfill('0') << static_cast<int>(byte) << " ";
-        } else {
-            // Print spaces for empty spaces in the last line
-            out << "   ";
+RAMSnapshot RAM::snapshot()
+{
+    RAMSnapshot result;
+    result.pages.resize(baseline.size());
+    for (size_t page = 0; page < baseline.size(); page++)
+    {
+        if (baseline[page] && !isPageDirty(page))
+        {
+            // Unchanged since the last snapshot or restore: share its copy
+            result.pages[page] = baseline[page];
+            continue;
         }
+        uint8_t *data = readPages[page].load(std::memory_order_relaxed);
+        if (data == nullptr || data == zeroPage)
+        {
+            // Devices and untouched memory share one zero page
+            result.pages[page] = zeroSnapshotPage();
+            continue;
+        }
+        std::shared_ptr<RAMSnapshot::Page> copy = std::make_shared<RAMSnapshot::Page>();
+        for (size_t i = 0; i < pageSize; i++)
+        {
+            (*copy)[i] = std::atomic_ref<uint8_t>(data[i]).load(std::memory_order_relaxed);
+        }
+        result.pages[page] = std::move(copy);
+    }
+    baseline = result.pages;
+    std::fill(pageDirty.begin(), pageDirty.end(), 0);
+    return result;
+}
+
+bool RAM::restore(const RAMSnapshot &snapshot, size_t *pagesCopied)
+{
+    if (snapshot.pages.size() != baseline.size())
+    {
+        errorLog() << "Error: Snapshot was taken from a RAM of a different size." << std::endl;
+        return false;
     }
 
-    // Print ASCII representation for each byte
-    out << "| ";
-    for (int i = 0; i < 64; i++) {
-        if (address + i < memory.size()) {
-            uint8_t byte = readByte(address + i);
-            // Display printable characters, otherwise show a dot
-            char printableChar = (byte >= 32 && byte <= 126) ? static_cast<char>(byte) : '.';
-            out << printableChar;
-        } else {
-            // Print spaces for empty spaces in the last line
-            out << " ";
+    size_t copied = 0;
+    for (size_t page = 0; page < baseline.size(); page++)
+    {
+        // Memory still matches the baseline page unless it was written since
+        if (!isPageDirty(page) && baseline[page] == snapshot.pages[page])
+        {
+            continue;
+        }
+        uint8_t *data = readPages[page].load(std::memory_order_relaxed);
+        if (kinds[page] == PageKind::Device || (data == zeroPage && snapshot.pages[page] == zeroSnapshotPage()))
+        {
+            continue;
+        }
+        const RAMSnapshot::Page &source = *snapshot.pages[page];
+        size_t start = page * pageSize;
+        uint8_t *target = backingPage(page);
+        for (size_t i = 0; i < pageSize; i++)
+        {
+            // Only code bytes that actually change invalidate decoded instructions
+            if (start + i < 256 && target[i] != source[i])
+            {
+                logCodeWrite(static_cast<uint16_t>(start + i));
+            }
+            std::atomic_ref<uint8_t>(target[i]).store(source[i], std::memory_order_relaxed);
         }
+        publishStore(start, pageSize);
+        copied++;
     }
+    baseline = snapshot.pages;
+    std::fill(pageDirty.begin(), pageDirty.end(), 0);
+    if (pagesCopied != nullptr)
+    {
+        *pagesCopied = copied;
+    }
+    return true;
+}
 
-    out << std::endl;
+void RAM::dump_memory_at_address(uint16_t address, std::ostream& out) const {
+    char line[HexDump::lineLength];
+    formatDumpLine(address, line);
+    out.write(line, sizeof(line));
 }
 
+void RAM::formatDumpLine(uint16_t address, char *out) const {
+    // Copy the line once, then format it; bytes past the end of memory are left blank
+    uint8_t bytes[HexDump::bytesPerLine];
+    size_t count = address < memorySize ? std::min(HexDump::bytesPerLine, memorySize - address) : 0;
+    for (size_t i = 0; i < count; i++) {
+        bytes[i] = peekByte(address + i);
+    }
+    HexDump::formatLine(address, bytes, count, out);
+}
 
 void RAM::dump_memory() const {
-    const int bytesPerLine = 16;
-    
+    // Let the dumper write out whatever changed since its last flush
+    if (dumper) {
+        dumper->sync();
+        return;
+    }
+
     // Open file for writing
-    std::ofstream outFile("RAM.txt");
+    std::ofstream outFile(dumpPath);
     
     // Check if file opened successfully
     if (!outFile.is_open()) {
-        std::cerr << "Error opening file for writing." << std::endl;
+        errorLog() << "Error opening file for writing." << std::endl;
         return;
     }
 
-    // Iterate over each byte in memory and print in groups of 16 bytes per line
-    for (uint16_t address = 0; address < memory.size(); address += 4 * bytesPerLine) {
-        dump_memory_at_address(address, outFile);
+    // Render every line into one buffer and write it in a single call
+    const size_t lineCount = (memorySize + HexDump::bytesPerLine - 1) / HexDump::bytesPerLine;
+    std::vector<char> text(lineCount * HexDump::lineLength);
+    for (size_t line = 0; line < lineCount; line++) {
+        formatDumpLine(static_cast<uint16_t>(line * HexDump::bytesPerLine), text.data() + line * HexDump::lineLength);
     }
+    outFile.write(text.data(), static_cast<std::streamsize>(text.size()));
     
     // Close the file stream
     outFile.close();
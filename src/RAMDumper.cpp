@@ -0,0 +1,192 @@
+#include "RAMDumper.h"
+#include "HexDump.h"
+#include "RAM.h"
+#include <bit>
+#include <fstream>
+#include <utility>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#define SCC_HAVE_PWRITE 1
+#else
+#define SCC_HAVE_PWRITE 0
+#endif
+
+static_assert(RAMDumper::bytesPerLine == HexDump::bytesPerLine, "RAM.txt lines are formatted by HexDump");
+
+bool parseDumpMode(const std::string &name, DumpMode &mode)
+{
+    if (name == "off")
+        mode = DumpMode::Disabled;
+    else if (name == "manual")
+        mode = DumpMode::Manual;
+    else if (name == "interval")
+        mode = DumpMode::Interval;
+    else if (name == "immediate")
+        mode = DumpMode::Immediate;
+    else
+        return false;
+    return true;
+}
+
+RAMDumper::RAMDumper(const RAM &ram, const std::string &path, DumpMode mode, std::chrono::milliseconds interval)
+    : ram(ram), path(path), mode(mode), interval(interval), flushCount(0), bytesWritten(0), fd(-1), stopping(false)
+{
+    lineCount = (ram.size() + bytesPerLine - 1) / bytesPerLine;
+    dirty = std::vector<std::atomic<uint64_t>>((lineCount + 63) / 64);
+    text.resize(lineCount * HexDump::lineLength);
+
+    // The first flush writes the whole file
+    markAllDirty();
+
+    if (mode == DumpMode::Interval)
+    {
+        worker = std::thread(&RAMDumper::run, this);
+    }
+}
+
+RAMDumper::~RAMDumper()
+{
+    if (worker.joinable())
+    {
+        {
+            std::lock_guard<std::mutex> lock(flushMutex);
+            stopping = true;
+        }
+        wake.notify_one();
+        worker.join();
+    }
+#if SCC_HAVE_PWRITE
+    if (fd >= 0)
+    {
+        ::close(fd);
+    }
+#endif
+}
+
+void RAMDumper::markDirty(uint16_t address)
+{
+    size_t line = address / bytesPerLine;
+    dirty[line / 64].fetch_or(uint64_t(1) << (line % 64), std::memory_order_release);
+    if (mode == DumpMode::Immediate)
+    {
+        sync();
+    }
+}
+
+void RAMDumper::markAllDirty()
+{
+    for (size_t line = 0; line < lineCount; line++)
+    {
+        dirty[line / 64].fetch_or(uint64_t(1) << (line % 64), std::memory_order_release);
+    }
+}
+
+void RAMDumper::sync()
+{
+    std::lock_guard<std::mutex> lock(flushMutex);
+    flush();
+}
+
+void RAMDumper::run()
+{
+    std::unique_lock<std::mutex> lock(flushMutex);
+    while (true)
+    {
+        wake.wait_for(lock, interval, [this] { return stopping; });
+        flush();
+        if (stopping)
+        {
+            return;
+        }
+    }
+}
+
+void RAMDumper::flush()
+{
+    // Re-render only the lines that were stored to since the last flush, as runs of adjacent lines
+    std::vector<std::pair<size_t, size_t>> runs;
+    for (size_t word = 0; word < dirty.size(); word++)
+    {
+        uint64_t bits = dirty[word].exchange(0, std::memory_order_acquire);
+        while (bits != 0)
+        {
+            size_t line = word * 64 + std::countr_zero(bits);
+            bits &= bits - 1;
+
+            ram.formatDumpLine(static_cast<uint16_t>(line * bytesPerLine), text.data() + line * HexDump::lineLength);
+            if (!runs.empty() && runs.back().first + runs.back().second == line)
+                runs.back().second++;
+            else
+                runs.push_back({line, 1});
+        }
+    }
+
+    if (runs.empty())
+    {
+        return;
+    }
+
+#if SCC_HAVE_PWRITE
+    if (fd < 0)
+    {
+        // Every line is dirty before the first flush, so this writes the whole file
+        fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0)
+        {
+            errorLog() << "Error opening file for writing." << std::endl;
+            markAllDirty();
+            return;
+        }
+    }
+    for (const auto &[line, count] : runs)
+    {
+        if (!writeAt(line * HexDump::lineLength, count * HexDump::lineLength))
+        {
+            return;
+        }
+    }
+#else
+    // Open file for writing
+    std::ofstream outFile(path, std::ofstream::out | std::ofstream::trunc);
+    if (!outFile.is_open())
+    {
+        errorLog() << "Error opening file for writing." << std::endl;
+        return;
+    }
+    outFile.write(text.data(), static_cast<std::streamsize>(text.size()));
+    outFile.close();
+    bytesWritten.fetch_add(text.size(), std::memory_order_relaxed);
+#endif
+
+    flushCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+bool RAMDumper::writeAt(size_t offset, size_t length)
+{
+#if SCC_HAVE_PWRITE
+    while (length > 0)
+    {
+        ssize_t written = ::pwrite(fd, text.data() + offset, length, static_cast<off_t>(offset));
+        if (written < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (written <= 0)
+        {
+            errorLog() << "Error writing " << path << "." << std::endl;
+            return false;
+        }
+        offset += static_cast<size_t>(written);
+        length -= static_cast<size_t>(written);
+        bytesWritten.fetch_add(static_cast<uint64_t>(written), std::memory_order_relaxed);
+    }
+    return true;
+#else
+    (void)offset;
+    (void)length;
+    return false;
+#endif
+}
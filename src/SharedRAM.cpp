@@ -0,0 +1,123 @@
+#include "SharedRAM.h"
+#include "Trace.h"
+#include <new>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define SCC_HAVE_SHM 1
+#else
+#define SCC_HAVE_SHM 0
+#endif
+
+SharedRAMImage::SharedRAMImage() : header(nullptr), data(nullptr), length(0), owner(false)
+{
+}
+
+SharedRAMImage::~SharedRAMImage()
+{
+    close();
+}
+
+bool SharedRAMImage::create(const std::string &name, uint32_t size)
+{
+#if SCC_HAVE_SHM
+    close();
+    path = "/" + name;
+    length = dataOffset + size;
+
+    int fd = shm_open(path.c_str(), O_CREAT | O_RDWR | O_TRUNC, 0644);
+    if (fd < 0)
+    {
+        errorLog() << "Error: Could not create shared RAM image " << path << std::endl;
+        return false;
+    }
+    if (ftruncate(fd, static_cast<off_t>(length)) != 0)
+    {
+        errorLog() << "Error: Could not size shared RAM image " << path << std::endl;
+        ::close(fd);
+        shm_unlink(path.c_str());
+        return false;
+    }
+    void *mapping = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED)
+    {
+        errorLog() << "Error: Could not map shared RAM image " << path << std::endl;
+        shm_unlink(path.c_str());
+        return false;
+    }
+
+    owner = true;
+    header = new (mapping) SharedRAMHeader{SharedRAMHeader::MAGIC, SharedRAMHeader::VERSION, size, {1}, {0}};
+    data = static_cast<uint8_t *>(mapping) + dataOffset;
+    return true;
+#else
+    errorLog() << "Error: Shared RAM images are not supported on this platform." << std::endl;
+    return false;
+#endif
+}
+
+bool SharedRAMImage::attach(const std::string &name)
+{
+#if SCC_HAVE_SHM
+    close();
+    path = "/" + name;
+
+    int fd = shm_open(path.c_str(), O_RDONLY, 0);
+    if (fd < 0)
+    {
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < dataOffset)
+    {
+        ::close(fd);
+        return false;
+    }
+    length = static_cast<size_t>(info.st_size);
+    void *mapping = mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED)
+    {
+        return false;
+    }
+
+    SharedRAMHeader *candidate = static_cast<SharedRAMHeader *>(mapping);
+    if (candidate->magic != SharedRAMHeader::MAGIC || candidate->version != SharedRAMHeader::VERSION ||
+        dataOffset + candidate->size > length)
+    {
+        munmap(mapping, length);
+        return false;
+    }
+
+    owner = false;
+    header = candidate;
+    data = static_cast<uint8_t *>(mapping) + dataOffset;
+    return true;
+#else
+    return false;
+#endif
+}
+
+void SharedRAMImage::close()
+{
+#if SCC_HAVE_SHM
+    if (header == nullptr)
+    {
+        return;
+    }
+    if (owner)
+    {
+        header->attached.store(0, std::memory_order_release);
+        shm_unlink(path.c_str());
+    }
+    munmap(header, length);
+#endif
+    header = nullptr;
+    data = nullptr;
+    length = 0;
+    owner = false;
+}
@@ -0,0 +1,111 @@
+#include "ThreadPool.h"
+
+WorkStealingPool::WorkStealingPool(unsigned threadCount)
+    : queued(0), pending(0), nextQueue(0), stopping(false)
+{
+    if (threadCount == 0)
+    {
+        threadCount = 1;
+    }
+    for (unsigned i = 0; i < threadCount; i++)
+    {
+        queues.push_back(std::make_unique<Queue>());
+    }
+    for (unsigned i = 0; i < threadCount; i++)
+    {
+        workers.emplace_back(&WorkStealingPool::workerLoop, this, i);
+    }
+}
+
+WorkStealingPool::~WorkStealingPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        stopping = true;
+    }
+    workAvailable.notify_all();
+    for (std::thread &worker : workers)
+    {
+        worker.join();
+    }
+}
+
+void WorkStealingPool::submit(std::function<void()> task)
+{
+    pending.fetch_add(1);
+    size_t index;
+    {
+        // Count the task before any worker can pop it, so queued never drops below zero, and
+        // under the state lock so a worker about to sleep cannot miss it
+        std::lock_guard<std::mutex> lock(stateMutex);
+        index = nextQueue++ % queues.size();
+        queued.fetch_add(1);
+    }
+    {
+        std::lock_guard<std::mutex> lock(queues[index]->mutex);
+        queues[index]->tasks.push_back(std::move(task));
+    }
+    workAvailable.notify_one();
+}
+
+void WorkStealingPool::wait()
+{
+    std::unique_lock<std::mutex> lock(stateMutex);
+    allDone.wait(lock, [this] { return pending.load() == 0; });
+}
+
+bool WorkStealingPool::popLocal(size_t index, std::function<void()> &task)
+{
+    Queue &queue = *queues[index];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (queue.tasks.empty())
+    {
+        return false;
+    }
+    task = std::move(queue.tasks.back());
+    queue.tasks.pop_back();
+    return true;
+}
+
+bool WorkStealingPool::steal(size_t index, std::function<void()> &task)
+{
+    for (size_t offset = 1; offset < queues.size(); offset++)
+    {
+        Queue &victim = *queues[(index + offset) % queues.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty())
+        {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+void WorkStealingPool::workerLoop(size_t index)
+{
+    std::function<void()> task;
+    while (true)
+    {
+        if (popLocal(index, task) || steal(index, task))
+        {
+            queued.fetch_sub(1);
+            task();
+            task = nullptr;
+            if (pending.fetch_sub(1) == 1)
+            {
+                std::lock_guard<std::mutex> lock(stateMutex);
+                allDone.notify_all();
+            }
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(stateMutex);
+        workAvailable.wait(lock, [this] { return stopping || queued.load() > 0; });
+        if (stopping && queued.load() == 0)
+        {
+            return;
+        }
+    }
+}
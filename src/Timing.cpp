@@ -0,0 +1,108 @@
+#include "Timing.h"
+#include <algorithm>
+#include <cstdlib>
+#include <sstream>
+
+bool parseTimingConfig(const std::string &text, TimingConfig &config)
+{
+    TimingConfig parsed = config;
+    std::istringstream fields(text);
+    std::string field;
+    while (std::getline(fields, field, ','))
+    {
+        size_t equals = field.find('=');
+        if (equals == std::string::npos)
+        {
+            return false;
+        }
+        std::string key = field.substr(0, equals);
+        std::string value = field.substr(equals + 1);
+        char *end = nullptr;
+        unsigned long cycles = std::strtoul(value.c_str(), &end, 10);
+        if (value.empty() || *end != '\0' || cycles > UINT32_MAX)
+        {
+            return false;
+        }
+
+        uint32_t *target = key == "fetch"     ? &parsed.fetch
+                           : key == "decode"  ? &parsed.decode
+                           : key == "execute" ? &parsed.execute
+                           : key == "hit"     ? &parsed.cacheHit
+                           : key == "miss"    ? &parsed.cacheMiss
+                           : key == "hazard"  ? &parsed.hazard
+                                              : nullptr;
+        if (target == nullptr)
+        {
+            return false;
+        }
+        *target = static_cast<uint32_t>(cycles);
+    }
+    config = parsed;
+    return true;
+}
+
+void TimingReport::writeJson(std::ostream &out) const
+{
+    std::ostringstream cpiText;
+    cpiText << cpi();
+    out << "{\"instructions\": " << std::dec << instructions << ", \"cycles\": " << cycles << ", \"cpi\": " << cpiText.str()
+        << ", \"stalls\": {\"fill\": " << fill << ", \"cache_hit\": " << cacheHitStalls << ", \"cache_miss\": " << cacheMissStalls
+        << ", \"hazard\": " << hazardStalls << ", \"control\": " << controlStalls << "}}";
+}
+
+TimingModel::TimingModel(const TimingConfig &config) : config(config)
+{
+    reset();
+}
+
+void TimingModel::reset()
+{
+    report = TimingReport{};
+    pendingHits = 0;
+    pendingMisses = 0;
+    lastStored = false;
+    lastStoreAddress = 0;
+}
+
+void TimingModel::retire(uint8_t opcode, uint16_t operand)
+{
+    uint64_t slot = std::max({config.fetch, config.decode, config.execute});
+    if (report.instructions == 0)
+    {
+        report.fill = config.fetch + config.decode + config.execute - slot;
+        report.cycles += report.fill;
+    }
+    report.instructions++;
+    report.cycles += slot;
+
+    // PSH and POP go straight to RAM
+    if (opcode == 0b0110 || opcode == 0b0111)
+    {
+        pendingMisses++;
+    }
+    uint64_t hitStall = static_cast<uint64_t>(pendingHits) * config.cacheHit;
+    uint64_t missStall = static_cast<uint64_t>(pendingMisses) * config.cacheMiss;
+    report.cacheHitStalls += hitStall;
+    report.cacheMissStalls += missStall;
+    report.cycles += hitStall + missStall;
+    pendingHits = 0;
+    pendingMisses = 0;
+
+    // ADC, SBC, LDA, AND and EOR read their operand; ADC and SBC store it
+    bool reads = opcode <= 0b0100;
+    if (reads && lastStored && lastStoreAddress == operand)
+    {
+        report.hazardStalls += config.hazard;
+        report.cycles += config.hazard;
+    }
+    lastStored = opcode <= 0b0001;
+    lastStoreAddress = operand;
+
+    // The target is known once JMP executes; what was fetched behind it is discarded
+    if (opcode == 0b0101)
+    {
+        uint64_t refill = static_cast<uint64_t>(config.fetch) + config.decode;
+        report.controlStalls += refill;
+        report.cycles += refill;
+    }
+}
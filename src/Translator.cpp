@@ -0,0 +1,222 @@
+#include "Translator.h"
+#include "CPU.h"
+#include <cstdlib>
+#include <iomanip>
+#include <sstream>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <dlfcn.h>
+#define SCC_TRANSLATED_DLOPEN 1
+#else
+#define SCC_TRANSLATED_DLOPEN 0
+#endif
+
+namespace
+{
+    const char *const methodNames[] = {"ADC", "SBC", "LDA", "AND", "EOR", "JMP", "PSH", "POP", "HLT"};
+
+    std::string label(uint16_t address)
+    {
+        std::ostringstream name;
+        name << "L" << std::hex << std::setw(4) << std::setfill('0') << address;
+        return name.str();
+    }
+
+    std::string hex(uint32_t value)
+    {
+        std::ostringstream text;
+        text << "0x" << std::hex << std::setw(4) << std::setfill('0') << value;
+        return text.str();
+    }
+
+    // Instructions starting past this read operand bytes from stack space, which the
+    // program can change, so they are left to the interpreter
+    constexpr uint16_t lastTranslated = DecodeCache::programSize - 3;
+
+    // Continue at address: straight to its label, or through the dispatcher
+    std::string continueAt(uint16_t address)
+    {
+        if (address <= lastTranslated)
+            return "goto " + label(address) + ";";
+        return "cpu.PC = " + hex(address) + "; goto dispatch;";
+    }
+}
+
+void ProgramTranslator::translate(const uint8_t *program, const std::string &source, std::ostream &out)
+{
+    out << "// Translated by scc_translate from " << source << ". Do not edit.\n"
+           "#include \"CPU.h\"\n"
+           "#include \"Translator.h\"\n\n"
+           "namespace\n{\n"
+           "const uint8_t program[" << DecodeCache::programSize << "] = {";
+    for (uint16_t i = 0; i < DecodeCache::programSize; i++)
+    {
+        out << (i % 16 == 0 ? "\n    " : " ") << "0x" << std::hex << std::setw(2) << std::setfill('0')
+            << static_cast<int>(program[i]) << ",";
+    }
+    out << std::dec << "\n};\n\n"
+           "uint64_t run(CPU &cpu, RAM &ram, uint16_t end_address, uint64_t budget)\n{\n"
+           "    uint64_t executed = 0;\n"
+           "dispatch:\n"
+           "    if (cpu.PC >= end_address || executed == budget || cpu.isHalted())\n"
+           "        return executed;\n"
+           "    switch (cpu.PC)\n    {\n";
+    for (uint16_t address = 0; address <= lastTranslated; address++)
+    {
+        out << "    case " << hex(address) << ": goto " << label(address) << ";\n";
+    }
+    out << "    default: break;\n    }\n"
+           "    // Outside the translated region\n"
+           "    cpu.step(ram);\n"
+           "    executed++;\n"
+           "    goto dispatch;\n";
+
+    for (uint16_t address = 0; address <= lastTranslated; address++)
+    {
+        uint8_t opcode = program[address];
+        uint16_t operand = static_cast<uint16_t>(program[address + 1] << 8 | program[address + 2]);
+        std::string name = opcode <= 8 ? methodNames[opcode] : "NOP";
+
+        out << "\n" << label(address) << ": // " << name << " " << hex(operand) << "\n"
+            << "    if (" << hex(address) << " >= end_address || executed == budget)\n"
+            << "    {\n"
+            << "        cpu.PC = " << hex(address) << ";\n"
+            << "        return executed;\n"
+            << "    }\n"
+            << "    executed++;\n"
+            << "    cpu.traceFetch(" << hex(opcode) << ", " << hex(operand) << ");\n"
+            << "    cpu.traceExecute(" << hex(operand) << ");\n";
+        if (opcode == 0b0101)
+        {
+            // JMP sets PC to the operand and execution resumes three bytes later
+            out << "    cpu.JMP(ram, " << hex(operand) << ");\n"
+                << "    " << continueAt(static_cast<uint16_t>(operand + 3)) << "\n";
+            continue;
+        }
+        if (opcode == 0b1000)
+        {
+            out << "    cpu.HLT();\n"
+                << "    cpu.PC = " << hex(address + 3) << ";\n"
+                << "    return executed;\n";
+            continue;
+        }
+        if (opcode == 0b0110 || opcode == 0b0111)
+            out << "    cpu." << name << "(ram);\n";
+        else if (opcode < 8)
+            out << "    cpu." << name << "(ram, " << hex(operand) << ");\n";
+        else
+            out << "    cpu.NOP(" << hex(opcode) << ");\n";
+        out << "    " << continueAt(static_cast<uint16_t>(address + 3)) << "\n";
+    }
+    out << "}\n}\n\n"
+           "extern \"C\" const TranslatedProgramInfo *"
+        << translatedEntryPoint << "()\n{\n"
+           "    static const TranslatedProgramInfo info = {translatedAbiVersion, sizeof(CPU), sizeof(RAM), program, run};\n"
+           "    return &info;\n"
+           "}\n";
+}
+
+bool ProgramTranslator::compile(const std::string &sourcePath, const std::string &libraryPath, std::string &error)
+{
+#ifdef SCC_TRANSLATE_COMMAND
+    std::string command = std::string(SCC_TRANSLATE_COMMAND) + " -o \"" + libraryPath + "\" \"" + sourcePath + "\"";
+    if (std::system(command.c_str()) != 0)
+    {
+        error = "Error: Compiling " + sourcePath + " failed: " + command;
+        return false;
+    }
+    return true;
+#else
+    (void)sourcePath;
+    (void)libraryPath;
+    error = "Error: This build has no compiler command for translated programs.";
+    return false;
+#endif
+}
+
+TranslatedProgram::TranslatedProgram() : handle(nullptr), info(nullptr), checkedRam(0), checkedCodeWrites(0), checkedMatch(false)
+{
+}
+
+TranslatedProgram::~TranslatedProgram()
+{
+    unload();
+}
+
+void TranslatedProgram::unload()
+{
+#if SCC_TRANSLATED_DLOPEN
+    if (handle != nullptr)
+    {
+        dlclose(handle);
+    }
+#endif
+    handle = nullptr;
+    info = nullptr;
+    checkedRam = 0;
+}
+
+bool TranslatedProgram::load(const std::string &path, std::string &error)
+{
+    unload();
+#if SCC_TRANSLATED_DLOPEN
+    // A bare file name would make dlopen search the library path instead of the current directory
+    std::string file = path.find('/') == std::string::npos ? "./" + path : path;
+    handle = dlopen(file.c_str(), RTLD_NOW | RTLD_LOCAL);
+    if (handle == nullptr)
+    {
+        error = "Error: Cannot load translated program " + path + ": " + dlerror();
+        return false;
+    }
+    auto entry = reinterpret_cast<const TranslatedProgramInfo *(*)()>(dlsym(handle, translatedEntryPoint));
+    const TranslatedProgramInfo *candidate = entry != nullptr ? entry() : nullptr;
+    if (candidate == nullptr)
+    {
+        error = "Error: " + path + " is not a translated program.";
+    }
+    else if (candidate->abiVersion != translatedAbiVersion)
+    {
+        error = "Error: " + path + " was translated for ABI version " + std::to_string(candidate->abiVersion) +
+                ", this build uses " + std::to_string(translatedAbiVersion) + ".";
+    }
+    else if (candidate->cpuSize != sizeof(CPU) || candidate->ramSize != sizeof(RAM))
+    {
+        error = "Error: " + path + " was compiled against a different CPU or RAM layout; translate it again.";
+    }
+    else
+    {
+        info = candidate;
+        return true;
+    }
+    unload();
+    return false;
+#else
+    error = "Error: Cannot load " + path + ": translated programs need dlopen.";
+    return false;
+#endif
+}
+
+bool TranslatedProgram::matches(const RAM &ram)
+{
+    // Translated code is only valid for the bytes it was made from; recheck after any code write
+    if (checkedRam != ram.getId() || checkedCodeWrites != ram.getCodeWriteCount())
+    {
+        checkedMatch = true;
+        for (uint16_t i = 0; i < DecodeCache::programSize && checkedMatch; i++)
+        {
+            checkedMatch = ram.readByte(i) == info->program[i];
+        }
+        checkedRam = ram.getId();
+        checkedCodeWrites = ram.getCodeWriteCount();
+    }
+    return checkedMatch;
+}
+
+uint64_t TranslatedProgram::run(CPU &cpu, RAM &ram, uint16_t end_address, uint64_t budget)
+{
+    if (info == nullptr || cpu.journal != nullptr || !matches(ram))
+    {
+        return cpu.run(ram, end_address, budget);
+    }
+    return info->run(cpu, ram, end_address, budget);
+}
@@ -0,0 +1,150 @@
+#include "UndoJournal.h"
+#include "Fusion.h"
+#include <algorithm>
+
+UndoJournal::UndoJournal(size_t capacity, uint64_t checkpointInterval, size_t checkpointCount)
+    : entries(capacity > 0 ? capacity : 1), head(0), count(0), position(0),
+      checkpointInterval(checkpointInterval > 0 ? checkpointInterval : 1), checkpointCount(checkpointCount)
+{
+}
+
+void UndoJournal::record(const CPU &cpu, RAM &ram)
+{
+    if (checkpointCount > 0 && position % checkpointInterval == 0 &&
+        (checkpoints.empty() || checkpoints.back().position != position))
+    {
+        checkpoints.push_back({position, takeSnapshot(cpu, ram)});
+        if (checkpoints.size() > checkpointCount)
+        {
+            checkpoints.pop_front();
+        }
+    }
+
+    Entry &entry = entries[head];
+    entry = Entry{cpu.PC, cpu.SP, 0, cpu.A, cpu.getStatus(), 0, false, false, {}};
+    // ADC..EOR read their operand through the cache and may claim a line, evicting another
+    if (cpu.PC + 2u < ram.size() && ram.readByte(cpu.PC) <= opcodes::EOR)
+    {
+        entry.cached = true;
+        entry.line = cpu.cache.saveLine(static_cast<uint16_t>(ram.readByte(cpu.PC + 1) << 8 | ram.readByte(cpu.PC + 2)));
+    }
+    head = (head + 1) % entries.size();
+    if (count < entries.size())
+    {
+        count++;
+    }
+    position++;
+}
+
+void UndoJournal::recordWrite(uint16_t address, uint8_t previous)
+{
+    if (count == 0)
+    {
+        return;
+    }
+    Entry &entry = newest();
+    entry.writeAddress = address;
+    entry.previous = previous;
+    entry.wrote = true;
+}
+
+void UndoJournal::undoNewest(CPU &cpu, RAM &ram)
+{
+    const Entry &entry = newest();
+    if (entry.wrote)
+    {
+        // Raw store: the byte was written through writeByte or writeStackByte, so its region is valid
+        ram.loadBytes(entry.writeAddress, &entry.previous, 1);
+    }
+    if (entry.cached)
+    {
+        cpu.cache.restoreLine(entry.line);
+    }
+    cpu.PC = entry.PC;
+    cpu.SP = entry.SP;
+    cpu.A = entry.A;
+    cpu.setStatus(entry.STATUS);
+
+    head = (head + entries.size() - 1) % entries.size();
+    count--;
+    position--;
+    while (!checkpoints.empty() && checkpoints.back().position > position)
+    {
+        checkpoints.pop_back();
+    }
+}
+
+uint64_t UndoJournal::stepBack(CPU &cpu, RAM &ram, uint64_t steps)
+{
+    steps = std::min(steps, position);
+    if (steps <= count)
+    {
+        for (uint64_t i = 0; i < steps; i++)
+        {
+            undoNewest(cpu, ram);
+        }
+        return steps;
+    }
+
+    // Past the ring: restart from the newest checkpoint at or before the target
+    uint64_t target = position - steps;
+    while (!checkpoints.empty() && checkpoints.back().position > target)
+    {
+        checkpoints.pop_back();
+    }
+    if (checkpoints.empty())
+    {
+        // History is gone; undo what the ring still holds
+        uint64_t undone = count;
+        while (count > 0)
+        {
+            undoNewest(cpu, ram);
+        }
+        return undone;
+    }
+
+    uint64_t reached = position;
+    Checkpoint checkpoint = checkpoints.back();
+    restoreSnapshot(cpu, ram, checkpoint.state);
+    head = 0;
+    count = 0;
+    position = checkpoint.position;
+
+    // Re-execute (and re-journal) forward to the target
+    UndoJournal *previous = cpu.journal;
+    cpu.journal = this;
+    cpu.run(ram, 0xFFFF, target - position);
+    cpu.journal = previous;
+    return reached - position;
+}
+
+bool UndoJournal::runBackToWrite(CPU &cpu, RAM &ram, uint16_t address)
+{
+    // Find it first, so a miss leaves the machine untouched
+    size_t distance = 0;
+    for (; distance < count; distance++)
+    {
+        const Entry &entry = entries[(head + entries.size() - 1 - distance) % entries.size()];
+        if (entry.wrote && entry.writeAddress == address)
+        {
+            break;
+        }
+    }
+    if (distance == count)
+    {
+        return false;
+    }
+    for (size_t i = 0; i <= distance; i++)
+    {
+        undoNewest(cpu, ram);
+    }
+    return true;
+}
+
+void UndoJournal::clear()
+{
+    head = 0;
+    count = 0;
+    position = 0;
+    checkpoints.clear();
+}
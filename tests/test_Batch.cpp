@@ -0,0 +1,156 @@
+#include <iostream>
+#include <string>
+#include <fstream>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include "BatchRunner.h"
+#include "ThreadPool.h"
+
+// Writes the sample program and data next to the test binary
+void writeSampleFiles()
+{
+    std::ofstream program("batch_program.txt", std::ofstream::trunc);
+    program << "0000 0010 0000 0010 0000 0000\n"
+               "0000 0011 0000 0010 0000 1000\n"
+               "0000 0100 0000 0010 0000 1001\n"
+               "0000 0000 0000 0010 0000 0000\n"
+               "0000 0001 0000 0010 0000 0001\n"
+               "0000 0000 0000 0010 0000 0010\n"
+               "0000 0001 0000 0010 0000 0011\n"
+               "0000 0101 0000 0000 0000 0000";
+    std::ofstream data("batch_data.txt", std::ofstream::trunc);
+    data << "This is some data";
+
+    // LDA 0x202, then a chain of running sums 0x300 += A, 0x301 += 0x300, ... whose last byte
+    // feeds A on the next pass. It never settles into a cycle short enough to be found idle
+    // within the timeout
+    auto instruction = [](int opcode, int address)
+    {
+        std::string bits;
+        for (int bit = 23; bit >= 0; bit--)
+        {
+            bits += ((opcode << 16 | address) >> bit & 1) ? '1' : '0';
+            if (bit % 4 == 0 && bit != 0)
+                bits += ' ';
+        }
+        return bits + "\n";
+    };
+    std::ofstream slow("batch_slow.txt", std::ofstream::trunc);
+    slow << instruction(0b0010, 0x202) << instruction(0b0000, 0x300);
+    for (int level = 0; level < 20; level++)
+        slow << instruction(0b0010, 0x300 + level) << instruction(0b0000, 0x301 + level);
+    slow << instruction(0b0101, 0x0000);
+}
+
+bool testPool()
+{
+    // A few slow tasks per round leave the fast ones queued behind them for other workers to steal
+    std::atomic<int> completed{0};
+    WorkStealingPool pool(4);
+    for (int round = 0; round < 2; round++)
+    {
+        for (int i = 0; i < 500; i++)
+        {
+            pool.submit([&completed, i]
+            {
+                if (i % 50 == 0)
+                {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+                }
+                completed++;
+            });
+        }
+        pool.wait();
+    }
+
+    if (completed == 1000)
+    {
+        std::cout << "Test work-stealing pool passed." << std::endl;
+        return true;
+    }
+    else
+    {
+        std::cout << "completed = " << completed << std::endl;
+        std::cout << "Test work-stealing pool failed." << std::endl;
+        return false;
+    }
+}
+
+bool testJobs()
+{
+    writeSampleFiles();
+    BatchJob finished{"finished", "batch_program.txt", "batch_data.txt", 0x15, BatchRunner::defaultBudget, 0};
+    BatchJob budget{"budget", "batch_program.txt", "batch_data.txt", 0, 1000, 0};
+    BatchJob timeout{"timeout", "batch_slow.txt", "batch_data.txt", 0, UINT64_MAX, 20};
+    BatchJob missing{"missing", "no_such_program.txt", "batch_data.txt", 0, 1000, 0};
+
+    // The reference engine run alone is the expected result for every parallel copy
+    BatchResult expected = BatchRunner::runJob(finished, ExecutionEngine::Reference);
+    std::vector<BatchJob> jobs(64, finished);
+    jobs.push_back(budget);
+    jobs.push_back(timeout);
+    jobs.push_back(missing);
+    std::vector<BatchResult> results = BatchRunner(4, ExecutionEngine::Threaded).run(jobs);
+
+    bool copiesMatch = expected.status == BatchStatus::Finished && expected.instructions == 7;
+    for (size_t i = 0; i < 64; i++)
+    {
+        copiesMatch = copiesMatch && results[i].status == BatchStatus::Finished &&
+                      results[i].instructions == expected.instructions && results[i].A == expected.A &&
+                      results[i].PC == expected.PC && results[i].memoryHash == expected.memoryHash;
+    }
+    bool budgetOk = results[64].status == BatchStatus::BudgetExhausted && results[64].instructions == 1000;
+    bool timeoutOk = results[65].status == BatchStatus::Timeout && results[65].instructions > 0;
+    bool missingOk = results[66].status == BatchStatus::LoadError && !results[66].error.empty();
+
+    if (copiesMatch && budgetOk && timeoutOk && missingOk)
+    {
+        std::cout << "Test batch jobs passed." << std::endl;
+        return true;
+    }
+    else
+    {
+        std::cout << "copies " << copiesMatch << " budget " << budgetOk << " timeout " << timeoutOk
+                  << " missing " << missingOk << std::endl;
+        std::cout << "Test batch jobs failed." << std::endl;
+        return false;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    int tests_passed = 0;
+    int total_tests = 0;
+
+    if (argc == 1 || (argc == 2 && std::string(argv[1]) == "all"))
+    {
+        total_tests = 2;
+        if (testPool())
+            tests_passed++;
+        if (testJobs())
+            tests_passed++;
+    }
+    else if (argc == 2 && std::string(argv[1]) == "pool")
+    {
+        total_tests = 1;
+        if (testPool())
+            tests_passed++;
+    }
+    else if (argc == 2 && std::string(argv[1]) == "jobs")
+    {
+        total_tests = 1;
+        if (testJobs())
+            tests_passed++;
+    }
+    else
+    {
+        std::cerr << "Invalid command-line arguments. Usage: test_Batch [all|pool|jobs]" << std::endl;
+        return 1;
+    }
+
+    std::cout << "Total passed tests: " << tests_passed << "/" << total_tests << std::endl;
+
+    // Return exit code based on tests passed/failed
+    return (tests_passed == total_tests) ? 0 : 1;
+}
@@ -1,7 +1,13 @@
 #include <iostream>
 #include <string>
 #include "CPU.h"
+#include "Snapshot.h"
+#include "UndoJournal.h"
+#include "IdleDetector.h"
+#include <algorithm>
 #include <random>
+#include <vector>
+#include <sstream>
 
 bool testLDA()
 {
@@ -204,26 +210,25 @@ bool testCache1()
     // Define the distribution for integers between 0 and 2 (inclusive)
     std::uniform_int_distribution<int> distribution(0, 2);
 
-    // Generate a random integer between 0 and 2
+    // Cache a random number of other locations first, so 0x0001 lands in a random way
     int random_number = distribution(gen);
+    for (int i = 0; i < random_number; i++)
+    {
+        cpu.updateCache(0x0010 + i, 0x11);
+    }
 
-    cpu.cache[random_number].location = 0x0001;
-    cpu.cache[random_number].value = 0xAF;
-
+    cpu.updateCache(0x0001, 0xAF);
     cpu.updateCache(0x0001, 0xCE);
 
-    if (cpu.cache[random_number].value == 0xCE)
+    uint8_t value = 0;
+    if (cpu.getCachedValue(0x0001, value) && value == 0xCE)
     {
         std::cout << "Test Cache Update if location is already in cache passed." << std::endl;
         return true;
     }
     else
     {
-        for (int i = 0; i < 3; i++)
-        {
-            std::cout << "Register " << i << " Location = " << std::hex << static_cast<int>(cpu.cache[i].location) << std::endl;
-            std::cout << "Register " << i << " Value = " << std::hex << static_cast<int>(cpu.cache[i].value) << std::endl;
-        }
+        std::cout << "Location 0x1 Value = " << std::hex << static_cast<int>(value) << std::endl;
     }
     std::cout << "Test Cache Update if location is already in cache failed." << std::endl;
     return false;
@@ -235,31 +240,557 @@ bool testCache2()
     RAM ram;
     CPU cpu;
 
-    cpu.cache[0].location = 0x0003;
-    cpu.cache[0].value = 0xAF;
+    // Fill every way of set 0, then add one more location mapping to the same set.
+    // The least recently used location (the first one) must be the one evicted.
+    const uint16_t stride = DataCache::sets * DataCache::lineSize;
+    for (uint16_t i = 0; i < DataCache::ways; i++)
+    {
+        cpu.updateCache(static_cast<uint16_t>((i + 1) * stride), static_cast<uint8_t>(0xA0 + i));
+    }
+    cpu.updateCache(static_cast<uint16_t>((DataCache::ways + 1) * stride), 0xCE);
 
-    cpu.cache[1].location = 0x0002;
-    cpu.cache[1].value = 0xD4;
+    uint8_t value = 0;
+    bool evicted = !cpu.cache.contains(stride);
+    bool inserted = cpu.getCachedValue(static_cast<uint16_t>((DataCache::ways + 1) * stride), value) && value == 0xCE;
+    bool othersKept = true;
+    for (uint16_t i = 1; i < DataCache::ways; i++)
+    {
+        othersKept = othersKept && cpu.cache.contains(static_cast<uint16_t>((i + 1) * stride));
+    }
 
-    cpu.cache[2].location = 0x0001;
-    cpu.cache[2].value = 0x25;
+    if (evicted && inserted && othersKept)
+    {
+        std::cout << "Test Cache Update if location is doesn't exist in cache passed." << std::endl;
+        return true;
+    }
+    else
+    {
+        std::cout << "Evicted = " << evicted << ", Inserted = " << inserted << ", Others kept = " << othersKept << std::endl;
+    }
+    std::cout << "Test Cache Update if location is doesn't exist in cache failed." << std::endl;
+    return false;
+}
 
-    cpu.updateCache(0x0004, 0xCE);
+bool testDecodeCache()
+{
+    // LDA 0x200; ADC 0x201 run from the decode cache, then patch the ADC into an SBC.
+    // Only the patched instruction may be re-decoded, and it must take effect on the next run.
+    RAM ram(DumpMode::Disabled);
+    CPU cpu;
+    uint8_t program[] = {0x02, 0x02, 0x00, 0x00, 0x02, 0x01};
+    for (uint16_t i = 0; i < sizeof(program); i++)
+    {
+        ram.writeInstructionByte(i, program[i]);
+    }
+    ram.writeByte(0x200, 0x05);
+    ram.writeByte(0x201, 0x07);
+
+    cpu.process_instructions(ram, 0x0000, 0x0006);
+    uint8_t afterADC = ram.readByte(0x201);
 
-    if (cpu.cache[2].value == 0xCE)
+    ram.writeInstructionByte(0x0003, 0x01);
+    cpu.process_instructions(ram, 0x0000, 0x0006);
+    uint8_t afterSBC = ram.readByte(0x201);
+
+    // The reference engine must agree with the decoded one
+    RAM referenceRam(DumpMode::Disabled);
+    CPU referenceCpu;
+    referenceCpu.engine = ExecutionEngine::Reference;
+    for (uint16_t i = 0; i < sizeof(program); i++)
     {
-        std::cout << "Test Cache Update if location is doesn't exist in cache passed." << std::endl;
+        referenceRam.writeInstructionByte(i, program[i]);
+    }
+    referenceRam.writeByte(0x200, 0x05);
+    referenceRam.writeByte(0x201, 0x07);
+    referenceCpu.process_instructions(referenceRam, 0x0000, 0x0006);
+
+    if (afterADC == 0x0C && afterSBC == 0x07 && referenceRam.readByte(0x201) == afterADC)
+    {
+        std::cout << "Test decode cache passed." << std::endl;
         return true;
     }
     else
     {
-        for (int i = 0; i < 3; i++)
+        std::cout << "After ADC = " << std::hex << static_cast<int>(afterADC) << ", after SBC = " << static_cast<int>(afterSBC) << std::endl;
+        std::cout << "Test decode cache failed." << std::endl;
+        return false;
+    }
+}
+
+bool testEnginesAgree()
+{
+    // Random straight-line programs must leave identical state under every engine
+    std::mt19937 gen(250);
+    std::uniform_int_distribution<int> opcodeDistribution(0, 8);
+    std::uniform_int_distribution<int> addressDistribution(0x0000, 0x0900);
+    std::uniform_int_distribution<int> byteDistribution(0x00, 0xFF);
+
+    for (int round = 0; round < 20; round++)
+    {
+        std::vector<uint8_t> program;
+        for (int i = 0; i < 60; i++)
         {
-            std::cout << "Register " << i << " Location = " << std::hex << static_cast<int>(cpu.cache[i].location) << std::endl;
-            std::cout << "Register " << i << " Value = " << std::hex << static_cast<int>(cpu.cache[i].value) << std::endl;
+            int opcode = opcodeDistribution(gen);
+            if (opcode == 0b0101)
+                opcode = 0b0010; // No jumps, so every run terminates
+            int address = addressDistribution(gen);
+            program.push_back(static_cast<uint8_t>(opcode));
+            program.push_back(static_cast<uint8_t>(address >> 8));
+            program.push_back(static_cast<uint8_t>(address & 0xFF));
+        }
+        std::vector<uint8_t> data;
+        for (int i = 0; i < 0x600; i++)
+            data.push_back(static_cast<uint8_t>(byteDistribution(gen)));
+
+        ExecutionEngine engines[] = {ExecutionEngine::Reference, ExecutionEngine::Decoded, ExecutionEngine::Threaded};
+        std::vector<uint8_t> expected;
+        for (ExecutionEngine engine : engines)
+        {
+            RAM ram(DumpMode::Disabled);
+            CPU cpu;
+            cpu.engine = engine;
+            for (uint16_t i = 0; i < program.size(); i++)
+                ram.writeInstructionByte(i, program[i]);
+            for (uint16_t i = 0; i < data.size(); i++)
+                ram.writeByte(0x200 + i, data[i]);
+            cpu.process_instructions(ram, 0x0000, static_cast<uint16_t>(program.size()));
+
+            std::vector<uint8_t> state = {cpu.A, static_cast<uint8_t>(cpu.SP), static_cast<uint8_t>(cpu.SP >> 8),
+                                          static_cast<uint8_t>(cpu.PC), static_cast<uint8_t>(cpu.PC >> 8)};
+            for (uint16_t i = 0; i < ram.size(); i++)
+                state.push_back(ram.readByte(i));
+            if (expected.empty())
+            {
+                expected = state;
+            }
+            else if (state != expected)
+            {
+                std::cout << "Round " << std::dec << round << ": engine " << static_cast<int>(engine) << " diverged." << std::endl;
+                std::cout << "Test engines agree failed." << std::endl;
+                return false;
+            }
         }
     }
-    std::cout << "Test Cache Update if location is doesn't exist in cache failed." << std::endl;
+    std::cout << "Test engines agree passed." << std::endl;
+    return true;
+}
+
+bool testCounters()
+{
+    // LDA/ADC hit and miss the cache, ADC 0x010 is refused by RAM, 0x0F is unsupported
+    const uint8_t program[] = {0x02, 0x02, 0x00, 0x00, 0x02, 0x00, 0x00, 0x00, 0x10, 0x06, 0x00, 0x00,
+                               0x07, 0x00, 0x00, 0x0F, 0x00, 0x00, 0x04, 0x03, 0x00};
+    ExecutionEngine engines[] = {ExecutionEngine::Reference, ExecutionEngine::Decoded, ExecutionEngine::Threaded};
+    for (ExecutionEngine engine : engines)
+    {
+        RAM ram(DumpMode::Disabled);
+        CPU cpu;
+        cpu.engine = engine;
+        for (uint16_t i = 0; i < sizeof(program); i++)
+            ram.writeInstructionByte(i, program[i]);
+        cpu.process_instructions(ram, 0x0000, sizeof(program));
+
+        CPUCounters counters = cpu.getCounters();
+        // The reference engine also fetches its 7 instructions (21 bytes) from RAM
+        uint64_t instructionReads = engine == ExecutionEngine::Reference ? 22 : 1;
+        bool countsOk = counters.instructions() == 7 && counters.executed[0] == 2 && counters.executed[2] == 1 &&
+                        counters.executed[4] == 1 && counters.executed[6] == 1 && counters.executed[7] == 1 &&
+                        counters.executed[9] == 1 && counters.cacheHits == 1 && counters.cacheMisses == 3 &&
+                        counters.cacheUpdates == 3 && counters.reads[0] == instructionReads && counters.reads[1] == 1 &&
+                        counters.reads[2] == 2 && counters.writes[0] == 0 && counters.writes[1] == 1 &&
+                        counters.writes[2] == 1 && counters.rejectedWrites == 1;
+
+        std::ostringstream json;
+        cpu.writeCountersJson(json);
+        bool jsonOk = json.str().find("\"ADC\": 2") != std::string::npos &&
+                      json.str().find("\"rejected_writes\": 1") != std::string::npos;
+
+        cpu.resetCounters();
+        bool resetOk = cpu.getCounters().instructions() == 0 && cpu.getCounters().rejectedWrites == 0;
+        if (CPUCounters::enabled && !(countsOk && jsonOk && resetOk))
+        {
+            std::cout << "Engine " << static_cast<int>(engine) << ": " << json.str() << std::endl;
+            std::cout << "Test execution counters failed." << std::endl;
+            return false;
+        }
+    }
+    std::cout << "Test execution counters passed." << std::endl;
+    return true;
+}
+
+bool testSnapshot()
+{
+    // Rerunning from a snapshot must reproduce the first run exactly, including cache contents
+    RAM ram(DumpMode::Disabled);
+    CPU cpu;
+    const uint8_t program[] = {0x02, 0x02, 0x00, 0x00, 0x02, 0x01, 0x06, 0x00, 0x00, 0x01, 0x02, 0x02, 0x07, 0x00, 0x00};
+    for (uint16_t i = 0; i < sizeof(program); i++)
+        ram.writeInstructionByte(i, program[i]);
+    ram.writeByte(0x200, 0x05);
+    ram.writeByte(0x201, 0x07);
+    ram.writeByte(0x202, 0x09);
+
+    cpu.PC = 0;
+    cpu.run(ram, sizeof(program), 2); // LDA, ADC
+    MachineSnapshot start = takeSnapshot(cpu, ram);
+    cpu.run(ram, sizeof(program), 10);
+    uint8_t firstA = cpu.A;
+    uint8_t first201 = ram.readByte(0x201), first202 = ram.readByte(0x202);
+
+    size_t copied = 0;
+    bool restored = restoreSnapshot(cpu, ram, start, &copied) && cpu.PC == 6 && ram.readByte(0x202) == 0x09 &&
+                    cpu.cache.contains(0x201) && copied == 2; // Stack and data pages
+    cpu.run(ram, sizeof(program), 10);
+    bool rerunMatches = cpu.A == firstA && ram.readByte(0x201) == first201 && ram.readByte(0x202) == first202;
+
+    if (restored && rerunMatches)
+    {
+        std::cout << "Test CPU/RAM snapshot passed." << std::endl;
+        return true;
+    }
+    else
+    {
+        std::cout << "Test CPU/RAM snapshot failed." << std::endl;
+        return false;
+    }
+}
+
+bool testUndoJournal()
+{
+    // LDA 0x200, ADC 0x201, PSH, POP, JMP 0 forever
+    const uint8_t program[] = {0x02, 0x02, 0x00, 0x00, 0x02, 0x01, 0x06, 0x00, 0x00, 0x07, 0x00, 0x00, 0x05, 0xFF, 0xFD};
+    auto load = [&](RAM &ram)
+    {
+        for (uint16_t i = 0; i < sizeof(program); i++)
+            ram.writeInstructionByte(i, program[i]);
+        ram.writeByte(0x200, 0x03);
+    };
+    // State after running n instructions from scratch
+    auto stateAfter = [&](uint64_t n)
+    {
+        RAM ram(DumpMode::Disabled);
+        CPU cpu;
+        load(ram);
+        cpu.run(ram, 0xFFFF, n);
+        std::vector<uint8_t> state = {cpu.A, static_cast<uint8_t>(cpu.SP), static_cast<uint8_t>(cpu.PC)};
+        for (uint16_t i = 0; i < ram.size(); i++)
+            state.push_back(ram.readByte(i));
+        return state;
+    };
+
+    RAM ram(DumpMode::Disabled);
+    CPU cpu;
+    load(ram);
+    UndoJournal journal(64, 100, 16);
+    cpu.journal = &journal;
+    cpu.run(ram, 0xFFFF, 1000);
+    auto state = [&]
+    {
+        std::vector<uint8_t> current = {cpu.A, static_cast<uint8_t>(cpu.SP), static_cast<uint8_t>(cpu.PC)};
+        for (uint16_t i = 0; i < ram.size(); i++)
+            current.push_back(ram.readByte(i));
+        return current;
+    };
+
+    // Within the ring, then past it through a checkpoint, then forward again
+    bool nearOk = journal.stepBack(cpu, ram, 10) == 10 && journal.getPosition() == 990 && state() == stateAfter(990);
+    bool farOk = journal.stepBack(cpu, ram, 500) == 500 && journal.getPosition() == 490 && state() == stateAfter(490);
+    cpu.run(ram, 0xFFFF, 20);
+    bool forwardOk = journal.getPosition() == 510 && state() == stateAfter(510);
+
+    // Last write of 0x201 is the ADC of the current loop iteration
+    bool writeOk = journal.runBackToWrite(cpu, ram, 0x201) && cpu.PC == 3 &&
+                   state() == stateAfter(journal.getPosition()) && !journal.runBackToWrite(cpu, ram, 0x400);
+
+    // LDA 0x200; ADC 0x150 (refused, but cached); LDA 0x150; three LDAs that evict it; HLT.
+    // Stepping back over the evictions must bring the cached 0x150 back, from the ring or a checkpoint
+    const uint8_t evicting[] = {0x02, 0x02, 0x00, 0x00, 0x01, 0x50, 0x02, 0x01, 0x50, 0x02, 0x02, 0x01, 0x02, 0x02, 0x02,
+                                0x02, 0x02, 0x03, 0x08, 0x00, 0x00};
+    bool evictOk = true;
+    for (size_t capacity : {size_t{64}, size_t{2}})
+    {
+        RAM evictRam(DumpMode::Disabled);
+        for (uint16_t i = 0; i < sizeof(evicting); i++)
+            evictRam.writeInstructionByte(i, evicting[i]);
+        evictRam.writeByte(0x200, 0x05);
+        CPU evictCpu;
+        UndoJournal evictJournal(capacity, 1, 16);
+        evictCpu.journal = &evictJournal;
+        evictCpu.run(evictRam, 0xFFFF, 100);
+        bool halted = evictCpu.isHalted() && evictJournal.getPosition() == 7;
+        evictCpu.STATUS &= ~CPU::haltFlag;
+        bool undone = evictJournal.stepBack(evictCpu, evictRam, 5) == 5 && evictCpu.PC == 6 && evictCpu.cache.contains(0x150);
+        evictCpu.run(evictRam, 0xFFFF, 1);
+        evictOk = evictOk && halted && undone && evictCpu.A == 0x05;
+    }
+
+    if (nearOk && farOk && forwardOk && writeOk && evictOk)
+    {
+        std::cout << "Test undo journal passed." << std::endl;
+        return true;
+    }
+    else
+    {
+        std::cout << nearOk << farOk << forwardOk << writeOk << evictOk << std::endl;
+        std::cout << "Test undo journal failed." << std::endl;
+        return false;
+    }
+}
+
+bool testHalt()
+{
+    // LDA 0x200; HLT; LDA 0x201: every engine stops past the HLT and stays stopped until the flag is cleared
+    const uint8_t program[] = {0x02, 0x02, 0x00, 0x08, 0x00, 0x00, 0x02, 0x02, 0x01};
+    ExecutionEngine engines[] = {ExecutionEngine::Reference, ExecutionEngine::Decoded, ExecutionEngine::Threaded, ExecutionEngine::Jit};
+    for (ExecutionEngine engine : engines)
+    {
+        RAM ram(DumpMode::Disabled);
+        CPU cpu;
+        cpu.engine = engine;
+        for (uint16_t i = 0; i < sizeof(program); i++)
+            ram.writeInstructionByte(i, program[i]);
+        ram.writeByte(0x200, 0x11);
+        ram.writeByte(0x201, 0x22);
+
+        bool halted = cpu.run(ram, sizeof(program), 100) == 2 && cpu.isHalted() && cpu.PC == 6 && cpu.A == 0x11 &&
+                      cpu.run(ram, sizeof(program), 100) == 0;
+        cpu.STATUS &= ~CPU::haltFlag;
+        bool resumed = cpu.run(ram, sizeof(program), 100) == 1 && cpu.A == 0x22 && !cpu.isHalted();
+        bool counted = !CPUCounters::enabled || cpu.getCounters().executed[8] == 1;
+        if (!(halted && resumed && counted))
+        {
+            std::cout << "Engine " << static_cast<int>(engine) << ": halted " << halted << " resumed " << resumed << " counted " << counted << std::endl;
+            std::cout << "Test HLT failed." << std::endl;
+            return false;
+        }
+    }
+    std::cout << "Test HLT passed." << std::endl;
+    return true;
+}
+
+// Reads zero, accepts every write
+class NullDevice : public MemoryDevice
+{
+public:
+    uint8_t read(uint16_t) override { return 0; }
+    bool write(uint16_t, uint8_t) override { return true; }
+};
+
+RunResult runIdleProgram(const std::vector<uint8_t> &program, uint64_t budget, bool withDevice = false)
+{
+    RAM ram(withDevice ? RAM::maxSize : RAM::defaultSize, DumpMode::Disabled);
+    NullDevice device;
+    if (withDevice)
+        ram.mapDevice(0x8000, 0x100, &device);
+    CPU cpu;
+    cpu.engine = ExecutionEngine::Threaded;
+    for (uint16_t i = 0; i < program.size(); i++)
+        ram.writeInstructionByte(i, program[i]);
+    ram.writeByte(0x200, 0x5A);
+    ram.writeByte(0x201, 0x01);
+    IdleDetector detector(64);
+    return runUntilHalt(cpu, ram, static_cast<uint16_t>(program.size()), budget, detector);
+}
+
+bool testIdle()
+{
+    // LDA 0x200, then a JMP to itself
+    RunResult selfJump = runIdleProgram({0x02, 0x02, 0x00, 0x05, 0x00, 0x00}, UINT64_MAX);
+    // EOR 0x200 forever: A flips between two values, RAM never changes
+    RunResult toggle = runIdleProgram({0x04, 0x02, 0x00, 0x05, 0xFF, 0xFD}, UINT64_MAX);
+    // LDA 0x201; ADC 0x200 forever: a new byte every pass until it wraps after 768 instructions
+    RunResult counting = runIdleProgram({0x02, 0x02, 0x01, 0x00, 0x02, 0x00, 0x05, 0x00, 0x00}, 500);
+    // A device could answer differently next time, so the same loop with one mapped never idles
+    RunResult device = runIdleProgram({0x04, 0x02, 0x00, 0x05, 0xFF, 0xFD}, 5000, true);
+    RunResult straight = runIdleProgram({0x02, 0x02, 0x00, 0x04, 0x02, 0x01}, UINT64_MAX);
+
+    bool selfJumpOk = selfJump.outcome == RunOutcome::Idle && selfJump.executed <= 64;
+    bool toggleOk = toggle.outcome == RunOutcome::Idle && toggle.executed <= 64 * 8;
+    bool countingOk = counting.outcome == RunOutcome::BudgetExhausted && counting.executed == 500;
+    bool deviceOk = device.outcome == RunOutcome::BudgetExhausted && device.executed == 5000;
+    bool straightOk = straight.outcome == RunOutcome::EndReached && straight.executed == 2;
+    if (selfJumpOk && toggleOk && countingOk && deviceOk && straightOk)
+    {
+        std::cout << "Test idle loop detection passed." << std::endl;
+        return true;
+    }
+    std::cout << "selfJump " << selfJumpOk << " toggle " << toggleOk << " counting " << countingOk << " device " << deviceOk
+              << " straight " << straightOk << std::endl;
+    std::cout << "Test idle loop detection failed." << std::endl;
+    return false;
+}
+
+bool testFlags()
+{
+    constexpr uint8_t C = LazyFlags::carry, Z = LazyFlags::zero, V = LazyFlags::overflow, N = LazyFlags::negative;
+    struct FlagCase
+    {
+        std::vector<uint8_t> program;
+        uint8_t data[3];
+        uint8_t expected;
+    };
+    const FlagCase cases[] = {
+        {{0x02, 0x02, 0x00, 0x00, 0x02, 0x01}, {0x50, 0x50, 0x00}, V | N},                  // LDA; ADC: 0x50 + 0x50 overflows
+        {{0x02, 0x02, 0x00, 0x00, 0x02, 0x01}, {0x01, 0xFF, 0x00}, C | Z},                  // LDA; ADC: 0xFF + 0x01 carries to zero
+        {{0x02, 0x02, 0x00, 0x01, 0x02, 0x01}, {0x01, 0x00, 0x00}, N},                      // LDA; SBC: 0x00 - 0x01 borrows
+        {{0x02, 0x02, 0x00, 0x01, 0x02, 0x01}, {0x01, 0x80, 0x00}, C | V},                  // LDA; SBC: 0x80 - 0x01 overflows
+        {{0x02, 0x02, 0x00, 0x00, 0x02, 0x01, 0x02, 0x02, 0x02}, {0x01, 0xFF, 0x80}, C | N}, // LDA keeps ADC's carry
+        {{0x02, 0x02, 0x00, 0x06, 0x00, 0x00, 0x02, 0x02, 0x01, 0x07, 0x00, 0x00}, {0x00, 0x80, 0x00}, Z}, // POP sets Z
+    };
+    ExecutionEngine engines[] = {ExecutionEngine::Reference, ExecutionEngine::Decoded, ExecutionEngine::Threaded, ExecutionEngine::Jit};
+    for (ExecutionEngine engine : engines)
+    {
+        for (const FlagCase &flagCase : cases)
+        {
+            RAM ram(DumpMode::Disabled);
+            CPU cpu;
+            cpu.engine = engine;
+            for (uint16_t i = 0; i < flagCase.program.size(); i++)
+                ram.writeInstructionByte(i, flagCase.program[i]);
+            for (uint16_t i = 0; i < 3; i++)
+                ram.writeByte(0x200 + i, flagCase.data[i]);
+            cpu.run(ram, static_cast<uint16_t>(flagCase.program.size()), 100);
+            uint8_t status = cpu.getStatus();
+            // Writing STATUS replaces the pending flags
+            cpu.setStatus(0);
+            if (status != flagCase.expected || cpu.getStatus() != 0)
+            {
+                std::cout << "Engine " << static_cast<int>(engine) << ": STATUS " << std::hex << static_cast<int>(status)
+                          << " expected " << static_cast<int>(flagCase.expected) << std::dec << std::endl;
+                std::cout << "Test STATUS flags failed." << std::endl;
+                return false;
+            }
+        }
+    }
+    std::cout << "Test STATUS flags passed." << std::endl;
+    return true;
+}
+
+TimingReport timeProgram(const TimingConfig &config)
+{
+    // LDA 0x200 (miss); ADC 0x200 (hit, stores); LDA 0x200 (hit, reads the store); JMP to the end
+    const uint8_t program[] = {0x02, 0x02, 0x00, 0x00, 0x02, 0x00, 0x02, 0x02, 0x00, 0x05, 0x00, 0x09};
+    RAM ram(DumpMode::Disabled);
+    CPU cpu;
+    cpu.engine = ExecutionEngine::Jit; // Timing selects the reference loop whatever the engine
+    TimingModel timing(config);
+    cpu.timing = &timing;
+    for (uint16_t i = 0; i < sizeof(program); i++)
+        ram.writeInstructionByte(i, program[i]);
+    ram.writeByte(0x200, 0x21);
+    cpu.process_instructions(ram, 0, sizeof(program));
+    return timing.getReport();
+}
+
+bool testTiming()
+{
+    if constexpr (!TimingModel::enabled)
+    {
+        std::cout << "Test timing model skipped: built without EMULATOR_TIMING." << std::endl;
+        return true;
+    }
+
+    // Defaults: 2 fill + 4 slots + 2 hits + 1 miss (10) + 1 hazard (2) + JMP refill (2)
+    TimingReport defaults = timeProgram(TimingConfig{});
+    bool defaultsOk = defaults.instructions == 4 && defaults.cycles == 22 && defaults.fill == 2 && defaults.cacheHitStalls == 2 &&
+                      defaults.cacheMissStalls == 10 && defaults.hazardStalls == 2 && defaults.controlStalls == 2 && defaults.cpi() == 5.5;
+
+    // A two-cycle fetch is the slowest stage: 2 fill + 4 * 2 + 2 + 20 + 2 + 3
+    TimingConfig slow;
+    bool parsed = parseTimingConfig("fetch=2,miss=20", slow) && slow.fetch == 2 && slow.cacheMiss == 20 && slow.decode == 1 &&
+                  !parseTimingConfig("fetch=2,bogus=1", slow) && !parseTimingConfig("miss=", slow) && slow.fetch == 2;
+    TimingReport slowReport = timeProgram(slow);
+    bool slowOk = slowReport.cycles == 37 && slowReport.controlStalls == 3;
+
+    if (defaultsOk && parsed && slowOk)
+    {
+        std::cout << "Test timing model passed." << std::endl;
+        return true;
+    }
+    std::cout << "defaults " << defaultsOk << " (" << defaults.cycles << " cycles) parsed " << parsed << " slow " << slowOk << " ("
+              << slowReport.cycles << " cycles)" << std::endl;
+    std::cout << "Test timing model failed." << std::endl;
+    return false;
+}
+
+bool testFusion()
+{
+    // The shipped program, then a stack loop: LDA; AND; EOR; ADC; SBC; ADC; SBC; JMP back to the AND
+    const std::vector<uint8_t> program = {0x02, 0x02, 0x00, 0x03, 0x02, 0x08, 0x04, 0x02, 0x09, 0x00, 0x02, 0x00, 0x01, 0x02, 0x01,
+                                          0x00, 0x02, 0x02, 0x01, 0x02, 0x03, 0x05, 0x00, 0x00};
+    const std::vector<uint8_t> stack = {0x02, 0x02, 0x04, 0x06, 0x00, 0x00, 0x06, 0x00, 0x00, 0x07, 0x00, 0x00, 0x07, 0x00, 0x00,
+                                        0x00, 0x02, 0x05, 0x05, 0xFF, 0xFD};
+
+    // 1000 instructions: LDA, then 142 passes of the loop. The table keeps its pairs and drops LDA; AND, which ran once
+    FusionProfile profile{};
+    {
+        RAM ram(DumpMode::Disabled);
+        CPU cpu;
+        cpu.engine = ExecutionEngine::Threaded; // Profiling selects the reference loop whatever the engine
+        cpu.fusionProfile = &profile;
+        for (uint16_t i = 0; i < program.size(); i++)
+            ram.writeInstructionByte(i, program[i]);
+        cpu.run(ram, static_cast<uint16_t>(program.size()), 1000);
+    }
+    std::stringstream written;
+    profile.write(written);
+    FusionProfile reread{};
+    std::string error;
+    FusionProfile malformed{};
+    std::stringstream bogus("ADC XYZ 3\n");
+    FusionTable table = FusionTable::fromProfile(profile);
+    bool profiled = profile.pairs[0b0000][0b0001] == 285 && profile.pairs[0b0001][0b0101] == 142 && profile.pairs[0b0101][0b0011] == 0 &&
+                    table.allows(fusedPairIndex(0b0000, 0b0001)) && table.allows(fusedPairIndex(0b0001, 0b0101)) &&
+                    !table.allows(fusedPairIndex(0b0010, 0b0011)) && reread.read(written, error) &&
+                    FusionTable::fromProfile(reread).getMask() == table.getMask() && !malformed.read(bogus, error);
+
+    // Fused engines match the reference loop, including when budgets and end addresses split a pair
+    bool agree = true;
+    for (const std::vector<uint8_t> *code : {&program, &stack})
+    {
+        std::vector<uint8_t> expected;
+        ExecutionEngine engines[] = {ExecutionEngine::Reference, ExecutionEngine::Decoded, ExecutionEngine::Threaded};
+        for (ExecutionEngine engine : engines)
+        {
+            for (uint64_t slice : {1, 2, 3, 7, 1000})
+            {
+                RAM ram(DumpMode::Disabled);
+                CPU cpu;
+                cpu.engine = engine;
+                for (uint16_t i = 0; i < code->size(); i++)
+                    ram.writeInstructionByte(i, (*code)[i]);
+                for (uint16_t i = 0; i < 0x10; i++)
+                    ram.writeByte(0x200 + i, static_cast<uint8_t>(i * 37 + 5));
+                for (uint64_t executed = 0; executed < 1000;)
+                    executed += cpu.run(ram, static_cast<uint16_t>(code->size()), std::min<uint64_t>(slice, 1000 - executed));
+                // Rewrite the second half of the ADC; SBC pair: the fused entry must see it
+                ram.writeInstructionByte(12, 0x02);
+                cpu.run(ram, static_cast<uint16_t>(code->size()), 500);
+                // Stop right after the first half of a pair
+                cpu.PC = 9;
+                cpu.run(ram, 12, 100);
+
+                CPUCounters counters = cpu.getCounters();
+                std::vector<uint8_t> state = {cpu.A, cpu.getStatus(), static_cast<uint8_t>(cpu.SP), static_cast<uint8_t>(cpu.PC)};
+                for (uint64_t count : counters.executed)
+                    state.push_back(static_cast<uint8_t>(count));
+                for (uint16_t i = 0; i < ram.size(); i++)
+                    state.push_back(ram.readByte(i));
+                if (expected.empty())
+                    expected = state;
+                agree = agree && state == expected;
+            }
+        }
+    }
+
+    if (profiled && agree)
+    {
+        std::cout << "Test instruction fusion passed." << std::endl;
+        return true;
+    }
+    std::cout << "profiled " << profiled << " agree " << agree << std::endl;
+    profile.write(std::cout);
+    std::cout << "Test instruction fusion failed." << std::endl;
     return false;
 }
 
@@ -357,6 +888,71 @@ int main(int argc, char *argv[])
         if (testCache2())
             tests_passed++;
     }
+    else if (argc == 2 && std::string(argv[1]) == "test_decode_cache")
+    {
+
+        total_tests = 1;
+        if (testDecodeCache())
+            tests_passed++;
+    }
+    else if (argc == 2 && std::string(argv[1]) == "test_undo_journal")
+    {
+        total_tests = 1;
+        if (testUndoJournal())
+            tests_passed++;
+    }
+    else if (argc == 2 && std::string(argv[1]) == "test_snapshot")
+    {
+        total_tests = 1;
+        if (testSnapshot())
+            tests_passed++;
+    }
+    else if (argc == 2 && std::string(argv[1]) == "test_counters")
+    {
+        total_tests = 1;
+        if (testCounters())
+            tests_passed++;
+    }
+    else if (argc == 2 && std::string(argv[1]) == "test_engines_agree")
+    {
+
+        total_tests = 1;
+        if (testEnginesAgree())
+            tests_passed++;
+    }
+    else if (argc == 2 && std::string(argv[1]) == "test_halt")
+    {
+        total_tests = 1;
+        if (testHalt())
+            tests_passed++;
+    }
+    else if (argc == 2 && std::string(argv[1]) == "test_flags")
+    {
+
+        total_tests = 1;
+        if (testFlags())
+            tests_passed++;
+    }
+    else if (argc == 2 && std::string(argv[1]) == "test_fusion")
+    {
+
+        total_tests = 1;
+        if (testFusion())
+            tests_passed++;
+    }
+    else if (argc == 2 && std::string(argv[1]) == "test_timing")
+    {
+
+        total_tests = 1;
+        if (testTiming())
+            tests_passed++;
+    }
+    else if (argc == 2 && std::string(argv[1]) == "test_idle")
+    {
+        total_tests = 1;
+        if (testIdle())
+            tests_passed++;
+    }
 
     else
     {
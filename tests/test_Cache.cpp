@@ -0,0 +1,136 @@
+// test_Cache.cpp
+#include <iostream>
+#include <string>
+#include "Cache.h"
+
+// Function to test that a cached zero is a hit, not a miss
+bool testZeroIsHit() {
+    SetAssociativeCache<1, 3, 1> cache;
+    uint8_t value = 0xFF;
+    bool missBefore = !cache.lookup(0x200, value);
+    cache.update(0x200, 0x00);
+    bool hitAfter = cache.lookup(0x200, value) && value == 0x00;
+    if (missBefore && hitAfter && cache.getStats().hits == 1 && cache.getStats().misses == 1) {
+        std::cout << "Test cached zero is a hit passed." << std::endl;
+        return true;
+    } else {
+        std::cout << "Test cached zero is a hit failed." << std::endl;
+        return false;
+    }
+}
+
+// Function to test that LRU evicts the least recently used way and FIFO the oldest fill
+bool testLRUAndFIFO() {
+    SetAssociativeCache<1, 2, 1> lru(ReplacementPolicy::LRU);
+    SetAssociativeCache<1, 2, 1> fifo(ReplacementPolicy::FIFO);
+    uint8_t value;
+    for (auto *cache : {&lru, &fifo}) {
+        cache->update(0x10, 1);
+        cache->update(0x20, 2);
+        cache->lookup(0x10, value); // 0x10 is now the most recently used
+        cache->update(0x30, 3);
+    }
+    bool lruOk = lru.contains(0x10) && !lru.contains(0x20) && lru.contains(0x30);
+    bool fifoOk = !fifo.contains(0x10) && fifo.contains(0x20) && fifo.contains(0x30);
+    if (lruOk && fifoOk) {
+        std::cout << "Test LRU and FIFO replacement passed." << std::endl;
+        return true;
+    } else {
+        std::cout << "Test LRU and FIFO replacement failed." << std::endl;
+        return false;
+    }
+}
+
+// Function to test bit-PLRU and random replacement keep the set full and the new line cached
+bool testPseudoLRUAndRandom() {
+    SetAssociativeCache<1, 4, 1> plru(ReplacementPolicy::PseudoLRU);
+    SetAssociativeCache<1, 4, 1> random(ReplacementPolicy::Random);
+    uint8_t value;
+    for (auto *cache : {&plru, &random}) {
+        for (uint16_t address = 0x10; address < 0x14; address++)
+            cache->update(address, static_cast<uint8_t>(address));
+        cache->lookup(0x10, value);
+        cache->update(0x20, 0x20);
+    }
+    // Bit-PLRU: 0x10 was touched last before the fill, so it must survive
+    int plruCached = 0, randomCached = 0;
+    for (uint16_t address = 0x10; address < 0x14; address++) {
+        plruCached += plru.contains(address);
+        randomCached += random.contains(address);
+    }
+    if (plru.contains(0x10) && plru.contains(0x20) && plruCached == 3 && random.contains(0x20) && randomCached == 3) {
+        std::cout << "Test pseudo-LRU and random replacement passed." << std::endl;
+        return true;
+    } else {
+        std::cout << "Test pseudo-LRU and random replacement failed." << std::endl;
+        return false;
+    }
+}
+
+// Function to test set indexing, line sharing and the wide (SIMD) tag compare
+bool testGeometry() {
+    // 4 sets of 8-byte lines: 0x200 and 0x207 share a line, 0x220 maps to the same set with another tag
+    SetAssociativeCache<4, 1, 8> direct;
+    direct.update(0x200, 0xAA);
+    direct.update(0x207, 0xBB);
+    bool lineShared = direct.contains(0x200) && direct.contains(0x207) && !direct.contains(0x203);
+    direct.update(0x220, 0xCC);
+    bool conflictEvicts = !direct.contains(0x200) && direct.contains(0x220);
+
+    // Fully associative with 40 ways exercises several 8-wide tag vectors
+    SetAssociativeCache<1, 40, 1> wide;
+    for (uint16_t i = 0; i < 40; i++)
+        wide.update(static_cast<uint16_t>(0x300 + i * 7), static_cast<uint8_t>(i));
+    bool allFound = true;
+    uint8_t value;
+    for (uint16_t i = 0; i < 40; i++)
+        allFound = allFound && wide.lookup(static_cast<uint16_t>(0x300 + i * 7), value) && value == i;
+    bool missFound = wide.lookup(0x301, value);
+
+    if (lineShared && conflictEvicts && allFound && !missFound) {
+        std::cout << "Test cache geometry passed." << std::endl;
+        return true;
+    } else {
+        std::cout << "Test cache geometry failed." << std::endl;
+        return false;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    int tests_passed = 0;
+    int total_tests = 0;
+
+    if (argc == 1 || (argc == 2 && std::string(argv[1]) == "all")) {
+        total_tests = 4;
+        if (testZeroIsHit())
+            tests_passed++;
+        if (testLRUAndFIFO())
+            tests_passed++;
+        if (testPseudoLRUAndRandom())
+            tests_passed++;
+        if (testGeometry())
+            tests_passed++;
+    } else if (argc == 2 && std::string(argv[1]) == "zero_hit") {
+        total_tests = 1;
+        if (testZeroIsHit())
+            tests_passed++;
+    } else if (argc == 2 && std::string(argv[1]) == "replacement") {
+        total_tests = 2;
+        if (testLRUAndFIFO())
+            tests_passed++;
+        if (testPseudoLRUAndRandom())
+            tests_passed++;
+    } else if (argc == 2 && std::string(argv[1]) == "geometry") {
+        total_tests = 1;
+        if (testGeometry())
+            tests_passed++;
+    } else {
+        std::cerr << "Invalid command-line arguments. Usage: test_Cache [all|zero_hit|replacement|geometry]" << std::endl;
+        return 1;
+    }
+
+    std::cout << "Total passed tests: " << tests_passed << "/" << total_tests << std::endl;
+
+    // Return exit code based on tests passed/failed
+    return (tests_passed == total_tests) ? 0 : 1;
+}
@@ -0,0 +1,299 @@
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#include "CPU.h"
+#include "IdleDetector.h"
+#include "Jit.h"
+#include "RAM.h"
+
+// Registers, RAM and per-opcode counts after running program from 0 on one engine
+std::vector<uint64_t> runProgram(ExecutionEngine engine, const std::vector<uint8_t> &program, const std::vector<uint8_t> &data,
+                                 uint16_t stackPointer, uint64_t budget, bool mapped = false)
+{
+    RAM ram(mapped ? RAM::maxSize : RAM::defaultSize, DumpMode::Disabled);
+    const uint8_t rom[] = {0x01, 0x02, 0x03};
+    if (mapped)
+        ram.mapROM(0x0300, 0x0100, rom, sizeof(rom));
+    CPU cpu;
+    cpu.engine = engine;
+    cpu.SP = stackPointer;
+    for (uint16_t i = 0; i < program.size(); i++)
+        ram.writeInstructionByte(i, program[i]);
+    for (uint16_t i = 0; i < data.size(); i++)
+        ram.writeByte(0x200 + i, data[i]);
+
+    uint64_t executed = cpu.run(ram, 0x0100, budget);
+    std::vector<uint64_t> state = {executed, cpu.PC, cpu.SP, cpu.A};
+    for (size_t i = 0; i < ram.size(); i++)
+        state.push_back(ram.readByte(static_cast<uint16_t>(i)));
+    for (uint64_t count : cpu.getCounters().executed)
+        state.push_back(count);
+    return state;
+}
+
+bool testAgree()
+{
+    // Random looping programs, with operands and stack pointers on both sides of every region
+    // boundary, must leave the same state under the JIT as under the reference interpreter
+    std::mt19937 gen(13);
+    std::uniform_int_distribution<int> opcodeDistribution(0, 8);
+    std::uniform_int_distribution<int> addressDistribution(0x01F0, 0x0810);
+    std::uniform_int_distribution<int> byteDistribution(0x00, 0xFF);
+    const uint16_t stackPointers[] = {0x0100, 0x0101, 0x0180, 0x01FE, 0x0000};
+
+    for (int round = 0; round < 40; round++)
+    {
+        std::vector<uint8_t> program;
+        int length = 4 + round % 20;
+        for (int i = 0; i < length; i++)
+        {
+            int opcode = opcodeDistribution(gen);
+            int address = addressDistribution(gen);
+            if (opcode == 0b0101)
+                address = (static_cast<int>(gen() % length) * 3 - 3) & 0xFFFF; // Resume at an instruction
+            program.push_back(static_cast<uint8_t>(opcode));
+            program.push_back(static_cast<uint8_t>(address >> 8));
+            program.push_back(static_cast<uint8_t>(address & 0xFF));
+        }
+        // Loop forever, so the budget decides where the run stops
+        program.insert(program.end(), {0x05, 0xFF, 0xFD});
+        std::vector<uint8_t> data;
+        for (int i = 0; i < 0x600; i++)
+            data.push_back(static_cast<uint8_t>(byteDistribution(gen)));
+
+        uint16_t stackPointer = stackPointers[round % 5];
+        uint64_t budget = 1000 + gen() % 5000;
+        if (runProgram(ExecutionEngine::Jit, program, data, stackPointer, budget) !=
+            runProgram(ExecutionEngine::Reference, program, data, stackPointer, budget))
+        {
+            std::cout << "Round " << round << " diverged." << std::endl;
+            std::cout << "Test JIT agrees with reference failed." << std::endl;
+            return false;
+        }
+    }
+    std::cout << "Test JIT agrees with reference passed." << std::endl;
+    return true;
+}
+
+bool testBudget()
+{
+    // A five-instruction loop run for a budget that is not a multiple of its length
+    const std::vector<uint8_t> program = {0x02, 0x02, 0x00, 0x00, 0x02, 0x01, 0x06, 0x00, 0x00,
+                                          0x07, 0x00, 0x00, 0x05, 0xFF, 0xFD};
+    const std::vector<uint8_t> data = {0x03, 0x00};
+    for (uint64_t budget : {1ULL, 4ULL, 5ULL, 6ULL, 100003ULL})
+    {
+        std::vector<uint64_t> state = runProgram(ExecutionEngine::Jit, program, data, 0x0100, budget);
+        if (state[0] != budget || state != runProgram(ExecutionEngine::Reference, program, data, 0x0100, budget))
+        {
+            std::cout << "Budget " << budget << " ran " << state[0] << " instructions." << std::endl;
+            std::cout << "Test JIT budget failed." << std::endl;
+            return false;
+        }
+    }
+    std::cout << "Test JIT budget passed." << std::endl;
+    return true;
+}
+
+bool testCodeWrite()
+{
+    // Rewriting the loop between runs must discard the compiled block
+    RAM ram(DumpMode::Disabled);
+    CPU cpu;
+    cpu.engine = ExecutionEngine::Jit;
+    const uint8_t program[] = {0x00, 0x02, 0x00, 0x05, 0xFF, 0xFD};
+    for (uint16_t i = 0; i < sizeof(program); i++)
+        ram.writeInstructionByte(i, program[i]);
+    cpu.A = 1;
+    cpu.run(ram, 0x0100, 10); // ADC five times: M = 5
+    ram.writeInstructionByte(0, 0x01);
+    cpu.PC = 0;
+    cpu.run(ram, 0x0100, 4); // SBC twice: M = 3
+    ram.writeInstructionByte(0, 0x02);
+    cpu.PC = 0;
+    cpu.run(ram, 0x0100, 2); // LDA once: A = 3
+
+    if (ram.readByte(0x200) == 3 && cpu.A == 3)
+    {
+        std::cout << "Test JIT code write passed." << std::endl;
+        return true;
+    }
+    else
+    {
+        std::cout << "M = " << static_cast<int>(ram.readByte(0x200)) << ", A = " << static_cast<int>(cpu.A) << std::endl;
+        std::cout << "Test JIT code write failed." << std::endl;
+        return false;
+    }
+}
+
+bool testStaleCache()
+{
+    // A rejected ADC leaves a value in the cache that RAM does not have; the JIT must
+    // not read around it
+    const std::vector<uint8_t> program = {0x02, 0x02, 0x00, 0x00, 0x00, 0x10, 0x02, 0x00, 0x10,
+                                          0x00, 0x02, 0x01, 0x05, 0x00, 0x03};
+    const std::vector<uint8_t> data = {0x07, 0x00};
+    if (runProgram(ExecutionEngine::Jit, program, data, 0x0100, 50) ==
+        runProgram(ExecutionEngine::Reference, program, data, 0x0100, 50))
+    {
+        std::cout << "Test JIT stale cache passed." << std::endl;
+        return true;
+    }
+    else
+    {
+        std::cout << "Test JIT stale cache failed." << std::endl;
+        return false;
+    }
+}
+
+bool testPagedMemory()
+{
+    // Operands on ROM pages and high in a 64 KB space: ROM stores are refused by RAM and
+    // must leave the block to the interpreter
+    std::mt19937 gen(15);
+    std::uniform_int_distribution<int> opcodeDistribution(0, 4);
+    const uint16_t operands[] = {0x0300, 0x0302, 0x0250, 0x8000, 0xFFFF, 0x0900};
+    for (int round = 0; round < 10; round++)
+    {
+        std::vector<uint8_t> program;
+        for (int i = 0; i < 12; i++)
+        {
+            uint16_t operand = operands[gen() % 6];
+            program.insert(program.end(), {static_cast<uint8_t>(opcodeDistribution(gen)), static_cast<uint8_t>(operand >> 8),
+                                           static_cast<uint8_t>(operand & 0xFF)});
+        }
+        program.insert(program.end(), {0x05, 0xFF, 0xFD});
+        std::vector<uint8_t> data(0x100, static_cast<uint8_t>(round + 1));
+        if (runProgram(ExecutionEngine::Jit, program, data, 0x0100, 3001, true) !=
+            runProgram(ExecutionEngine::Reference, program, data, 0x0100, 3001, true))
+        {
+            std::cout << "Round " << round << " diverged." << std::endl;
+            std::cout << "Test JIT paged memory failed." << std::endl;
+            return false;
+        }
+    }
+    std::cout << "Test JIT paged memory passed." << std::endl;
+    return true;
+}
+
+// Outcome, instruction count and PC when runUntilHalt stops program on one engine
+std::vector<uint64_t> runIdle(ExecutionEngine engine, const std::vector<uint8_t> &program, uint64_t interval)
+{
+    RAM ram(DumpMode::Disabled);
+    CPU cpu;
+    cpu.engine = engine;
+    for (uint16_t i = 0; i < program.size(); i++)
+        ram.writeInstructionByte(i, program[i]);
+    ram.writeByte(0x200, 0x5A);
+    ram.writeByte(0x201, 0x01);
+    IdleDetector detector(interval);
+    RunResult result = runUntilHalt(cpu, ram, static_cast<uint16_t>(program.size()), UINT64_MAX, detector);
+    return {static_cast<uint64_t>(result.outcome), result.executed, cpu.PC};
+}
+
+bool testIdle()
+{
+    // The JIT skips the data cache, so the idle stop point must not depend on it: every engine
+    // stops at the same PC after the same number of instructions
+    const std::vector<std::vector<uint8_t>> programs = {
+        // LDA; AND; EOR; ADC; SBC; ADC; SBC; JMP back to the first ADC
+        {0x02, 0x02, 0x00, 0x03, 0x02, 0x08, 0x04, 0x02, 0x09, 0x00, 0x02, 0x00, 0x01, 0x02, 0x01, 0x00, 0x02, 0x02,
+         0x01, 0x02, 0x03, 0x05, 0x00, 0x00},
+        {0x04, 0x02, 0x00, 0x05, 0xFF, 0xFD},                        // EOR 0x200 forever
+        {0x02, 0x02, 0x01, 0x00, 0x02, 0x00, 0x05, 0x00, 0x00}};     // ADC 0x200 until the byte wraps
+    const ExecutionEngine engines[] = {ExecutionEngine::Decoded, ExecutionEngine::Threaded, ExecutionEngine::Jit};
+    for (size_t p = 0; p < programs.size(); p++)
+    {
+        for (uint64_t interval : {uint64_t{64}, IdleDetector::defaultInterval})
+        {
+            std::vector<uint64_t> reference = runIdle(ExecutionEngine::Reference, programs[p], interval);
+            bool same = reference[0] == static_cast<uint64_t>(RunOutcome::Idle);
+            for (ExecutionEngine engine : engines)
+                same = same && runIdle(engine, programs[p], interval) == reference;
+            if (!same)
+            {
+                std::cout << "Program " << p << " with interval " << interval << " stopped differently." << std::endl;
+                std::cout << "Test idle detection across engines failed." << std::endl;
+                return false;
+            }
+        }
+    }
+    std::cout << "Test idle detection across engines passed." << std::endl;
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    int tests_passed = 0;
+    int total_tests = 0;
+    setErrorLog(nullptr); // The random programs hit every RAM error path
+
+    if (!JitCompiler::supported)
+    {
+        std::cout << "JIT not supported on this platform; the engine falls back to threaded dispatch." << std::endl;
+    }
+
+    if (argc == 1 || (argc == 2 && std::string(argv[1]) == "all"))
+    {
+        total_tests = 6;
+        if (testPagedMemory())
+            tests_passed++;
+        if (testAgree())
+            tests_passed++;
+        if (testBudget())
+            tests_passed++;
+        if (testCodeWrite())
+            tests_passed++;
+        if (testStaleCache())
+            tests_passed++;
+        if (testIdle())
+            tests_passed++;
+    }
+    else if (argc == 2 && std::string(argv[1]) == "agree")
+    {
+        total_tests = 1;
+        if (testAgree())
+            tests_passed++;
+    }
+    else if (argc == 2 && std::string(argv[1]) == "budget")
+    {
+        total_tests = 1;
+        if (testBudget())
+            tests_passed++;
+    }
+    else if (argc == 2 && std::string(argv[1]) == "code_write")
+    {
+        total_tests = 1;
+        if (testCodeWrite())
+            tests_passed++;
+    }
+    else if (argc == 2 && std::string(argv[1]) == "paged")
+    {
+        total_tests = 1;
+        if (testPagedMemory())
+            tests_passed++;
+    }
+    else if (argc == 2 && std::string(argv[1]) == "stale_cache")
+    {
+        total_tests = 1;
+        if (testStaleCache())
+            tests_passed++;
+    }
+    else if (argc == 2 && std::string(argv[1]) == "idle")
+    {
+        total_tests = 1;
+        if (testIdle())
+            tests_passed++;
+    }
+    else
+    {
+        std::cerr << "Invalid command-line arguments. Usage: test_Jit [all|agree|budget|code_write|stale_cache|paged|idle]" << std::endl;
+        return 1;
+    }
+
+    std::cout << "Total passed tests: " << tests_passed << "/" << total_tests << std::endl;
+
+    // Return exit code based on tests passed/failed
+    return (tests_passed == total_tests) ? 0 : 1;
+}
@@ -0,0 +1,151 @@
+#include <iostream>
+#include <sstream>
+#include <string>
+#include "CPU.h"
+#include "Lockstep.h"
+
+// An engine with a planted bug: SBC adds instead of subtracting
+uint64_t runWithBrokenSBC(CPU &cpu, RAM &ram, uint16_t end_address, uint64_t budget)
+{
+    uint64_t executed = 0;
+    while (cpu.PC < end_address && executed < budget && !cpu.isHalted())
+    {
+        uint8_t opcode = ram.readByte(cpu.PC);
+        uint16_t operand = static_cast<uint16_t>(ram.readByte(cpu.PC + 1) << 8 | ram.readByte(cpu.PC + 2));
+        cpu.executeInstruction(ram, opcode == 0b0001 ? 0b0000 : opcode, operand);
+        cpu.PC += 3;
+        executed++;
+    }
+    return executed;
+}
+
+bool testAgree()
+{
+    // Every engine matches the reference interpreter on a few thousand random programs
+    const ExecutionEngine engines[] = {ExecutionEngine::Decoded, ExecutionEngine::Threaded, ExecutionEngine::Jit};
+    bool agreed = true;
+    for (ExecutionEngine engine : engines)
+    {
+        LockstepOptions options;
+        options.engine = engine;
+        options.programs = 3000;
+        options.threadCount = 2;
+        LockstepReport report = LockstepHarness(options).run();
+        if (report.diverged || report.programs != options.programs || report.instructions == 0)
+        {
+            std::cout << "Program " << report.divergence.index << " diverged: " << report.divergence.reason << std::endl;
+            agreed = false;
+        }
+    }
+
+    if (agreed)
+    {
+        std::cout << "Test lockstep engines agree passed." << std::endl;
+        return true;
+    }
+    std::cout << "Test lockstep engines agree failed." << std::endl;
+    return false;
+}
+
+bool testShrink()
+{
+    // The planted bug is found and shrunk to LDA plus SBC, which still reproduces it
+    LockstepOptions options;
+    options.programs = 2000;
+    LockstepHarness harness(options);
+    harness.setRunner(runWithBrokenSBC);
+    LockstepReport report = harness.run();
+
+    const LockstepDivergence &divergence = report.divergence;
+    std::string reason;
+    uint64_t instruction;
+    bool found = report.diverged;
+    bool reduced = found && divergence.reduced.program.size() <= 6 &&
+                   divergence.reduced.program.size() <= divergence.original.program.size() &&
+                   divergence.reduced.budget <= 2 && divergence.instruction == divergence.reduced.budget;
+    bool reproduces = found && !harness.check(divergence.reduced, 1, reason, instruction) && reason == divergence.reason;
+
+    std::ostringstream text;
+    LockstepHarness::writeProgram(text, divergence.reduced);
+    bool written = text.str().size() == divergence.reduced.program.size() / 3 * 30;
+
+    if (found && reduced && reproduces && written)
+    {
+        std::cout << "Test lockstep shrink passed." << std::endl;
+        return true;
+    }
+    std::cout << "found " << found << " reduced " << reduced << " reproduces " << reproduces << " written " << written << std::endl;
+    std::cout << "Test lockstep shrink failed." << std::endl;
+    return false;
+}
+
+bool testShards()
+{
+    // The lowest diverging case is reported whatever the thread count
+    LockstepOptions options;
+    options.programs = 5000;
+    options.seed = 7;
+    uint64_t first[2];
+    for (unsigned threads : {1u, 4u})
+    {
+        options.threadCount = threads;
+        LockstepHarness harness(options);
+        harness.setRunner(runWithBrokenSBC);
+        LockstepReport report = harness.run();
+        first[threads == 1 ? 0 : 1] = report.diverged ? report.divergence.index : UINT64_MAX;
+    }
+
+    if (first[0] != UINT64_MAX && first[0] == first[1])
+    {
+        std::cout << "Test lockstep shards passed." << std::endl;
+        return true;
+    }
+    std::cout << "First divergence " << first[0] << " vs " << first[1] << std::endl;
+    std::cout << "Test lockstep shards failed." << std::endl;
+    return false;
+}
+
+int main(int argc, char *argv[])
+{
+    int tests_passed = 0;
+    int total_tests = 0;
+
+    if (argc == 1 || (argc == 2 && std::string(argv[1]) == "all"))
+    {
+        total_tests = 3;
+        if (testAgree())
+            tests_passed++;
+        if (testShrink())
+            tests_passed++;
+        if (testShards())
+            tests_passed++;
+    }
+    else if (argc == 2 && std::string(argv[1]) == "agree")
+    {
+        total_tests = 1;
+        if (testAgree())
+            tests_passed++;
+    }
+    else if (argc == 2 && std::string(argv[1]) == "shrink")
+    {
+        total_tests = 1;
+        if (testShrink())
+            tests_passed++;
+    }
+    else if (argc == 2 && std::string(argv[1]) == "shards")
+    {
+        total_tests = 1;
+        if (testShards())
+            tests_passed++;
+    }
+    else
+    {
+        std::cerr << "Invalid command-line arguments. Usage: test_Lockstep [all|agree|shrink|shards]" << std::endl;
+        return 1;
+    }
+
+    std::cout << "Total passed tests: " << tests_passed << "/" << total_tests << std::endl;
+
+    // Return exit code based on tests passed/failed
+    return (tests_passed == total_tests) ? 0 : 1;
+}
@@ -0,0 +1,224 @@
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "MultiCore.h"
+
+void loadProgram(RAM &ram, const std::vector<uint8_t> &program)
+{
+    for (uint16_t i = 0; i < program.size(); i++)
+        ram.writeInstructionByte(i, program[i]);
+}
+
+bool testShared()
+{
+    // Four cores run LDA 0x201 once, then ADC 0x200 and a JMP back to it: no increment may be lost
+    RAM ram(DumpMode::Disabled);
+    loadProgram(ram, {0x02, 0x02, 0x01, 0x00, 0x02, 0x00, 0x05, 0x00, 0x00});
+    ram.writeByte(0x201, 1);
+    MultiCore machine(ram, 4);
+    MultiCoreReport report;
+    std::string error;
+    const uint64_t adds = 20000;
+    bool ran = machine.run(9, 1 + 2 * adds, report, error);
+
+    const CoherenceCounters &total = report.total;
+    bool counted = ram.readByte(0x200) == static_cast<uint8_t>(4 * adds);
+    bool traffic = total.writeHits + total.writeMisses == 4 * adds && total.invalidations >= 3 && total.writebacks >= 3;
+    bool registers = true;
+    for (size_t index = 0; index < 4; index++)
+        registers = registers && machine.core(index).A == 1 && report.executed[index] == 1 + 2 * adds && !report.halted[index];
+
+    if (ran && counted && traffic && registers)
+    {
+        std::cout << "Test multi-core shared counter passed." << std::endl;
+        return true;
+    }
+    std::cout << "ran " << ran << " counted " << counted << " (" << static_cast<int>(ram.readByte(0x200)) << ") traffic " << traffic
+              << " registers " << registers << std::endl;
+    std::cout << "Test multi-core shared counter failed." << std::endl;
+    return false;
+}
+
+bool testPrivate()
+{
+    // Core i adds to its own line at 0x240 + 0x40 * i; they only share the read-only 0x201
+    const size_t cores = 4;
+    const uint64_t adds = 1000;
+    std::vector<uint8_t> program;
+    for (size_t index = 0; index < cores; index++)
+    {
+        uint16_t start = static_cast<uint16_t>(program.size());
+        uint16_t counter = static_cast<uint16_t>(0x240 + 0x40 * index);
+        uint16_t back = static_cast<uint16_t>(start);
+        std::vector<uint8_t> block = {0x02, 0x02, 0x01, 0x00, static_cast<uint8_t>(counter >> 8), static_cast<uint8_t>(counter),
+                                      0x05, static_cast<uint8_t>(back >> 8), static_cast<uint8_t>(back), 0x08, 0x00, 0x00};
+        program.insert(program.end(), block.begin(), block.end());
+    }
+    RAM ram(DumpMode::Disabled);
+    loadProgram(ram, program);
+    ram.writeByte(0x201, 1);
+    MultiCore machine(ram, cores);
+    for (size_t index = 0; index < cores; index++)
+        machine.core(index).PC = static_cast<uint16_t>(12 * index);
+    MultiCoreReport report;
+    std::string error;
+    bool ran = machine.run(static_cast<uint16_t>(program.size()), 1 + 2 * adds, report, error);
+
+    bool counted = true;
+    for (size_t index = 0; index < cores; index++)
+        counted = counted && ram.readByte(static_cast<uint16_t>(0x240 + 0x40 * index)) == static_cast<uint8_t>(adds);
+    const CoherenceCounters &total = report.total;
+    // One BusRdX per counter, then hits; one intervention when a second core first reads 0x201 held in E
+    bool traffic = total.invalidations == 0 && total.busReadExclusive == cores && total.writeHits == cores * (adds - 1) &&
+                   total.readMisses == cores && total.interventions == 1;
+    if (ran && counted && traffic)
+    {
+        std::cout << "Test multi-core private lines passed." << std::endl;
+        return true;
+    }
+    std::cout << "ran " << ran << " counted " << counted << " traffic " << traffic << std::endl;
+    report.writeJson(std::cout);
+    std::cout << std::endl << "Test multi-core private lines failed." << std::endl;
+    return false;
+}
+
+bool testSharing()
+{
+    // Two cores keep reading 0x200: after one miss each the line is shared and every read hits
+    RAM ram(DumpMode::Disabled);
+    loadProgram(ram, {0x02, 0x02, 0x00, 0x05, 0xFF, 0xFD});
+    ram.writeByte(0x200, 0x5A);
+    MultiCore machine(ram, 2);
+    MultiCoreReport report;
+    std::string error;
+    bool ran = machine.run(6, 1000, report, error);
+
+    const CoherenceCounters &total = report.total;
+    bool traffic = total.readMisses == 2 && total.busReads == 2 && total.interventions == 1 && total.invalidations == 0 &&
+                   total.readHits == 1000 - 2 && total.writebacks == 0;
+    bool loaded = machine.core(0).A == 0x5A && machine.core(1).A == 0x5A && machine.core(0).getStatus() == 0;
+    if (ran && traffic && loaded)
+    {
+        std::cout << "Test multi-core read sharing passed." << std::endl;
+        return true;
+    }
+    std::cout << "ran " << ran << " traffic " << traffic << " loaded " << loaded << std::endl;
+    std::cout << "Test multi-core read sharing failed." << std::endl;
+    return false;
+}
+
+bool testLimits()
+{
+    RAM ram(DumpMode::Disabled);
+    MultiCoreReport report;
+    std::string none;
+    std::string tooMany;
+    MultiCore empty(ram, 0);
+    MultiCore crowded(ram, MultiCore::maxCores + 1);
+    if (!empty.run(0, 10, report, none) && !crowded.run(0, 10, report, tooMany) && !none.empty() && !tooMany.empty())
+    {
+        std::cout << "Test multi-core limits passed." << std::endl;
+        return true;
+    }
+    std::cout << "Test multi-core limits failed." << std::endl;
+    return false;
+}
+
+bool testErrors()
+{
+    // Every core pushes twice from the top of the stack, so the second push runs past it, then
+    // hits an unsupported opcode. The messages reach the caller's log core by core
+    RAM ram(DumpMode::Disabled);
+    loadProgram(ram, {0x06, 0x00, 0x00, 0x06, 0x00, 0x00, 0x09, 0x00, 0x00});
+    MultiCore machine(ram, 3);
+    for (size_t index = 0; index < 3; index++)
+        machine.core(index).SP = 0x1FF;
+    MultiCoreReport report;
+    std::string error;
+    std::ostringstream log;
+    setErrorLog(&log);
+    bool ran = machine.run(9, 100, report, error);
+    setErrorLog(&std::cerr);
+
+    std::istringstream lines(log.str());
+    std::string line;
+    std::vector<std::string> messages;
+    while (std::getline(lines, line))
+        messages.push_back(line);
+    bool ordered = messages.size() == 6;
+    for (size_t index = 0; ordered && index < 3; index++)
+    {
+        ordered = messages[2 * index] == "Core " + std::to_string(index) + ": stack write out of range. Address: 0x200" &&
+                  messages[2 * index + 1].rfind("NOP Unsupported opcode", 0) == 0;
+    }
+    if (ran && ordered)
+    {
+        std::cout << "Test multi-core error log passed." << std::endl;
+        return true;
+    }
+    std::cout << "ran " << ran << " ordered " << ordered << std::endl << log.str();
+    std::cout << "Test multi-core error log failed." << std::endl;
+    return false;
+}
+
+int main(int argc, char *argv[])
+{
+    int tests_passed = 0;
+    int total_tests = 0;
+
+    if (argc == 1 || (argc == 2 && std::string(argv[1]) == "all"))
+    {
+        total_tests = 5;
+        if (testShared())
+            tests_passed++;
+        if (testPrivate())
+            tests_passed++;
+        if (testSharing())
+            tests_passed++;
+        if (testLimits())
+            tests_passed++;
+        if (testErrors())
+            tests_passed++;
+    }
+    else if (argc == 2 && std::string(argv[1]) == "shared")
+    {
+        total_tests = 1;
+        if (testShared())
+            tests_passed++;
+    }
+    else if (argc == 2 && std::string(argv[1]) == "private")
+    {
+        total_tests = 1;
+        if (testPrivate())
+            tests_passed++;
+    }
+    else if (argc == 2 && std::string(argv[1]) == "sharing")
+    {
+        total_tests = 1;
+        if (testSharing())
+            tests_passed++;
+    }
+    else if (argc == 2 && std::string(argv[1]) == "limits")
+    {
+        total_tests = 1;
+        if (testLimits())
+            tests_passed++;
+    }
+    else if (argc == 2 && std::string(argv[1]) == "errors")
+    {
+        total_tests = 1;
+        if (testErrors())
+            tests_passed++;
+    }
+    else
+    {
+        std::cerr << "Invalid command-line arguments. Usage: test_MultiCore [all|shared|private|sharing|limits|errors]" << std::endl;
+        return 1;
+    }
+
+    std::cout << "Total passed tests: " << tests_passed << "/" << total_tests << std::endl;
+
+    // Return exit code based on tests passed/failed
+    return (tests_passed == total_tests) ? 0 : 1;
+}
@@ -0,0 +1,303 @@
+#include <iostream>
+#include <string>
+#include <fstream>
+#include <random>
+#include <vector>
+#include "BatchRunner.h"
+#include "Optimizer.h"
+
+void loadProgram(RAM &ram, const std::vector<uint8_t> &program)
+{
+    for (uint16_t i = 0; i < program.size(); i++)
+        ram.writeInstructionByte(i, program[i]);
+}
+
+class NullDevice : public MemoryDevice
+{
+public:
+    uint8_t read(uint16_t) override { return 0; }
+    bool write(uint16_t, uint8_t) override { return true; }
+};
+
+// The state a run leaves behind: registers, flags, cached bytes and all of RAM
+std::vector<uint8_t> machineState(const CPU &cpu, const RAM &ram)
+{
+    std::vector<uint8_t> state = {cpu.A, cpu.getStatus(), static_cast<uint8_t>(cpu.SP), static_cast<uint8_t>(cpu.SP >> 8),
+                                  static_cast<uint8_t>(cpu.PC), static_cast<uint8_t>(cpu.PC >> 8)};
+    cpu.cache.forEachValid([&state](uint32_t address, uint8_t value)
+    {
+        state.push_back(static_cast<uint8_t>(address));
+        state.push_back(static_cast<uint8_t>(address >> 8));
+        state.push_back(value);
+    });
+    for (uint16_t i = 0; i < ram.size(); i++)
+        state.push_back(ram.readByte(i));
+    return state;
+}
+
+bool testPath()
+{
+    // The shipped program: LDA once, then AND; EOR; ADC; SBC; ADC; SBC; JMP back to the AND
+    RAM ram(DumpMode::Disabled);
+    loadProgram(ram, {0x02, 0x02, 0x00, 0x03, 0x02, 0x08, 0x04, 0x02, 0x09, 0x00, 0x02, 0x00, 0x01, 0x02, 0x01, 0x00, 0x02, 0x02,
+                      0x01, 0x02, 0x03, 0x05, 0x00, 0x00});
+    const std::string data = "This is some data";
+    for (uint16_t i = 0; i < data.size(); i++)
+        ram.writeByte(0x200 + i, static_cast<uint8_t>(data[i]));
+    CPU cpu;
+    ProgramAnalysis analysis = analyzeProgram(cpu, ram, 24);
+
+    const std::vector<InstructionFacts> &path = analysis.path;
+    bool shape = analysis.end == PathEnd::Loop && analysis.prefixLength == 1 && path.size() == 8 && path[1].pc == 3 && !path[0].repeats &&
+                 path[1].repeats && path[7].opcode == 0b0101 && analysis.prefixPrecomputable();
+
+    // A device under an operand, or under a POP once SP drifts there, keeps the prefix from being replayed
+    RAM mapped(RAM::maxSize, DumpMode::Disabled);
+    NullDevice device;
+    mapped.mapDevice(0x0400, 0x100, &device);
+    loadProgram(mapped, {0x02, 0x04, 0x10, 0x05, 0xFF, 0xFD});
+    bool operandDevice = analyzeProgram(cpu, mapped, 6).touchesDevices;
+    loadProgram(mapped, {0x07, 0x00, 0x00, 0x07, 0x00, 0x00, 0x05, 0xFF, 0xFD});
+    bool popDevice = analyzeProgram(cpu, mapped, 9).touchesDevices;
+    loadProgram(mapped, {0x06, 0x00, 0x00, 0x07, 0x00, 0x00, 0x05, 0xFF, 0xFD});
+    bool balanced = !analyzeProgram(cpu, mapped, 9).touchesDevices;
+    // Outside a drifting loop SP is exact: POP; HLT reads the device only when SP starts just above it
+    loadProgram(mapped, {0x07, 0x00, 0x00, 0x08, 0x00, 0x00});
+    CPU stacked;
+    stacked.SP = 0x0401;
+    bool exactPop = analyzeProgram(stacked, mapped, 6).touchesDevices && !analyzeProgram(cpu, mapped, 6).touchesDevices;
+    bool devices = operandDevice && popDevice && exactPop && balanced;
+    if (shape && devices)
+    {
+        std::cout << "Test optimizer path passed." << std::endl;
+        return true;
+    }
+    std::cout << "shape " << shape << " devices " << operandDevice << popDevice << exactPop << balanced << std::endl;
+    analysis.writeJson(std::cout);
+    std::cout << std::endl << "Test optimizer path failed." << std::endl;
+    return false;
+}
+
+bool testStraightLine()
+{
+    // LDA 0x200; ADC 0x201; ADC 0x201; SBC 0x202; PSH; POP; HLT: the whole run is prefix
+    RAM ram(DumpMode::Disabled);
+    loadProgram(ram, {0x02, 0x02, 0x00, 0x00, 0x02, 0x01, 0x00, 0x02, 0x01, 0x01, 0x02, 0x02, 0x06, 0x00, 0x00, 0x07, 0x00, 0x00,
+                      0x08, 0x00, 0x00});
+    ram.writeByte(0x200, 0x11);
+    ram.writeByte(0x201, 0x22);
+    ram.writeByte(0x202, 0x05);
+    CPU cpu;
+    ProgramAnalysis analysis = analyzeProgram(cpu, ram, 0x100);
+    const std::vector<InstructionFacts> &path = analysis.path;
+    bool shape = analysis.end == PathEnd::Halt && analysis.prefixLength == 6 && path.size() == 6 && !path[5].repeats;
+
+    // Replaying the captured prefix leaves a fresh machine where running it would
+    std::ostringstream log;
+    PrecomputedPrefix prefix;
+    bool captured = capturePrefix(cpu, ram, 0x100, analysis, log, prefix) && prefix.instructions == 6 && prefix.writes.size() == 3;
+    RAM replayed(DumpMode::Disabled);
+    loadProgram(replayed, {0x02, 0x02, 0x00, 0x00, 0x02, 0x01, 0x00, 0x02, 0x01, 0x01, 0x02, 0x02, 0x06, 0x00, 0x00, 0x07, 0x00,
+                           0x00, 0x08, 0x00, 0x00});
+    replayed.writeByte(0x200, 0x11);
+    replayed.writeByte(0x201, 0x22);
+    replayed.writeByte(0x202, 0x05);
+    CPU fresh;
+    applyPrefix(fresh, replayed, prefix);
+    // 0x22 + 0x11 = 0x33, then 0x44; 0x05 - 0x11 = 0xF4; POP gives back the pushed 0x11
+    bool same = machineState(fresh, replayed) == machineState(cpu, ram) && replayed.readByte(0x201) == 0x44 &&
+                replayed.readByte(0x202) == 0xF4 && fresh.A == 0x11;
+
+    if (shape && captured && same)
+    {
+        std::cout << "Test optimizer straight line passed." << std::endl;
+        return true;
+    }
+    std::cout << "shape " << shape << " captured " << captured << " same " << same << std::endl;
+    analysis.writeJson(std::cout);
+    std::cout << std::endl << "Test optimizer straight line failed." << std::endl;
+    return false;
+}
+
+bool testRandom()
+{
+    // Random programs with jumps, stack traffic and refused stores: execution must follow the
+    // path, and a replayed prefix must end where running it does
+    std::mt19937 gen(250);
+    std::uniform_int_distribution<int> opcodeDistribution(0, 9);
+    std::uniform_int_distribution<int> addressDistribution(0x0F0, 0x20F);
+    std::uniform_int_distribution<int> slotDistribution(0, 19);
+    const uint64_t budget = 400;
+
+    for (int round = 0; round < 300; round++)
+    {
+        std::vector<uint8_t> program;
+        for (int i = 0; i < 20; i++)
+        {
+            int opcode = opcodeDistribution(gen);
+            int address = opcode == 0b0101 ? slotDistribution(gen) * 3 - 3 : addressDistribution(gen);
+            program.push_back(static_cast<uint8_t>(opcode == 0b1000 ? 0b0010 : opcode)); // HLT only ends the path early
+            program.push_back(static_cast<uint8_t>(address >> 8));
+            program.push_back(static_cast<uint8_t>(address & 0xFF));
+        }
+        auto load = [&](RAM &ram)
+        {
+            loadProgram(ram, program);
+            for (uint16_t i = 0x200; i < 0x210; i++)
+                ram.writeByte(i, static_cast<uint8_t>(i * 29 + round));
+        };
+
+        RAM ram(DumpMode::Disabled);
+        load(ram);
+        CPU cpu;
+        ProgramAnalysis analysis = analyzeProgram(cpu, ram, static_cast<uint16_t>(program.size()));
+        const std::vector<InstructionFacts> &path = analysis.path;
+        const size_t loopLength = path.size() - analysis.prefixLength;
+
+        std::vector<uint8_t> afterPrefix;
+        uint64_t executed = 0;
+        for (; executed < budget && cpu.PC < program.size(); executed++)
+        {
+            if (executed == analysis.prefixLength)
+                afterPrefix = machineState(cpu, ram);
+            // The prefix runs once in order, then the loop repeats
+            size_t index = executed < analysis.prefixLength ? executed
+                           : loopLength > 0 ? analysis.prefixLength + (executed - analysis.prefixLength) % loopLength
+                                            : path.size();
+            if (index >= path.size() || path[index].pc != cpu.PC || path[index].repeats != (index >= analysis.prefixLength))
+            {
+                std::cout << "Round " << round << ", instruction " << executed << " at " << cpu.PC << " is off the path" << std::endl;
+                analysis.writeJson(std::cout);
+                std::cout << std::endl << "Test optimizer random programs failed." << std::endl;
+                return false;
+            }
+            cpu.step(ram);
+        }
+        if (executed == analysis.prefixLength)
+            afterPrefix = machineState(cpu, ram);
+
+        if (analysis.prefixPrecomputable() && analysis.prefixLength <= executed)
+        {
+            RAM captureRAM(DumpMode::Disabled);
+            load(captureRAM);
+            CPU captureCPU;
+            captureCPU.engine = ExecutionEngine::Threaded;
+            std::ostringstream log;
+            PrecomputedPrefix prefix;
+            RAM replayRAM(DumpMode::Disabled);
+            load(replayRAM);
+            CPU replayCPU;
+            bool captured = capturePrefix(captureCPU, captureRAM, static_cast<uint16_t>(program.size()), analysis, log, prefix);
+            applyPrefix(replayCPU, replayRAM, prefix);
+            if (!captured || machineState(replayCPU, replayRAM) != afterPrefix)
+            {
+                std::cout << "Round " << round << ": replayed prefix of " << analysis.prefixLength << " diverged." << std::endl;
+                std::cout << "Test optimizer random programs failed." << std::endl;
+                return false;
+            }
+        }
+    }
+    std::cout << "Test optimizer random programs passed." << std::endl;
+    return true;
+}
+
+bool testBatch()
+{
+    // Jobs sharing a program replay its prefix and report exactly what plain runs report
+    std::ofstream program("optimizer_program.txt", std::ofstream::trunc);
+    program << "0000 0010 0000 0010 0000 0000\n"
+               "0000 0000 0000 0010 0000 0001\n"
+               "0000 0110 0000 0000 0000 0000\n"
+               "0000 0011 0000 0010 0000 1000\n"
+               "0000 0100 0000 0010 0000 1001\n"
+               "0000 0000 0000 0010 0000 0000\n"
+               "0000 0001 0000 0010 0000 0001\n"
+               "0000 0101 0000 0000 0000 1001";
+    program.close();
+    std::ofstream data("optimizer_data.txt", std::ofstream::trunc);
+    data << "This is some data";
+    data.close();
+
+    std::vector<BatchJob> jobs;
+    for (uint64_t budget : {1, 2, 3, 4, 100, 65535, 65536, 65537, 300000})
+        jobs.push_back(BatchJob{"budget", "optimizer_program.txt", "optimizer_data.txt", 0, budget, 0});
+    jobs.push_back(BatchJob{"end", "optimizer_program.txt", "optimizer_data.txt", 0x0C, 1000, 0});
+    jobs.push_back(BatchJob{"end", "optimizer_program.txt", "optimizer_data.txt", 0x0C, 1000, 0});
+
+    std::vector<BatchResult> plain = BatchRunner(1, ExecutionEngine::Threaded).run(jobs);
+    std::vector<BatchResult> optimized = BatchRunner(1, ExecutionEngine::Threaded, true).run(jobs);
+    bool same = true;
+    uint64_t precomputed = 0;
+    for (size_t i = 0; i < jobs.size(); i++)
+    {
+        const BatchResult &a = plain[i];
+        const BatchResult &b = optimized[i];
+        same = same && a.status == b.status && a.instructions == b.instructions && a.PC == b.PC && a.SP == b.SP && a.A == b.A &&
+               a.memoryHash == b.memoryHash && a.errorCount == b.errorCount && a.precomputed == 0;
+        precomputed += b.precomputed;
+    }
+    // LDA; ADC; PSH; AND run once before the loop from 12. Per key one job records them and
+    // the others replay them, except those whose budget ends inside the prefix
+    if (same && precomputed == 5 * 4 + 4)
+    {
+        std::cout << "Test optimizer batch passed." << std::endl;
+        return true;
+    }
+    std::cout << "same " << same << " precomputed " << precomputed << std::endl;
+    std::cout << "Test optimizer batch failed." << std::endl;
+    return false;
+}
+
+int main(int argc, char *argv[])
+{
+    int tests_passed = 0;
+    int total_tests = 0;
+    setErrorLog(nullptr); // The random programs hit every RAM error path
+
+    if (argc == 1 || (argc == 2 && std::string(argv[1]) == "all"))
+    {
+        total_tests = 4;
+        if (testPath())
+            tests_passed++;
+        if (testStraightLine())
+            tests_passed++;
+        if (testRandom())
+            tests_passed++;
+        if (testBatch())
+            tests_passed++;
+    }
+    else if (argc == 2 && std::string(argv[1]) == "path")
+    {
+        total_tests = 1;
+        if (testPath())
+            tests_passed++;
+    }
+    else if (argc == 2 && std::string(argv[1]) == "straight")
+    {
+        total_tests = 1;
+        if (testStraightLine())
+            tests_passed++;
+    }
+    else if (argc == 2 && std::string(argv[1]) == "random")
+    {
+        total_tests = 1;
+        if (testRandom())
+            tests_passed++;
+    }
+    else if (argc == 2 && std::string(argv[1]) == "batch")
+    {
+        total_tests = 1;
+        if (testBatch())
+            tests_passed++;
+    }
+    else
+    {
+        std::cerr << "Invalid command-line arguments. Usage: test_Optimizer [all|path|straight|random|batch]" << std::endl;
+        return 1;
+    }
+
+    std::cout << "Total passed tests: " << tests_passed << "/" << total_tests << std::endl;
+
+    // Return exit code based on tests passed/failed
+    return (tests_passed == total_tests) ? 0 : 1;
+}
@@ -1,7 +1,30 @@
 // test_RAM.cpp
 #include <iostream>
 #include <string>
+#include <sstream>
 #include "RAM.h"
+#include <fstream>
+#include <filesystem>
+#include "Loader.h"
+#include "ProgramImage.h"
+#include "HexDump.h"
+#include <random>
+#if defined(__unix__) || defined(__APPLE__)
+#include <unistd.h>
+#endif
+
+// Distinct per process, so test cases run in parallel never share a dump file or shm name
+std::string uniqueName(const std::string &stem) {
+#if defined(__unix__) || defined(__APPLE__)
+    return stem + "_" + std::to_string(getpid());
+#else
+    return stem + "_" + std::to_string(std::random_device{}());
+#endif
+}
+
+std::string tempDumpPath(const std::string &stem) {
+    return (std::filesystem::temp_directory_path() / (uniqueName(stem) + ".txt")).string();
+}
 
 // Function to test reading from valid memory address
 bool testValidMemoryAddress() {
@@ -128,7 +151,308 @@ bool testValidWriteByte(){
     }
 }
 
+bool testDumpCoalescesStores(){
+    // Thousands of stores between two sync points should cost a single flush of RAM.txt
+    const std::string path = tempDumpPath("scc_dump_coalesce");
+    bool flushedOnce;
+    {
+        RAM ram(RAM::defaultSize, DumpMode::Manual, RAMDumper::defaultInterval, path);
+        for (int i = 0; i < 5000; i++) {
+            ram.writeByte(0x200 + (i % 0x600), static_cast<uint8_t>(i));
+        }
+        ram.writeByte(0x240, 0xAB);
+        ram.dump_memory();
+        flushedOnce = ram.getDumper()->getFlushCount() == 1;
+    }
+
+    std::ifstream dumpFile(path);
+    std::string line;
+    bool found = false;
+    while (std::getline(dumpFile, line)) {
+        if (line.rfind("Address 0x0240: ab ", 0) == 0)
+            found = true;
+    }
+    dumpFile.close();
+    std::filesystem::remove(path);
+    if (flushedOnce && found) {
+        std::cout << "Test coalescing stores into one RAM.txt flush passed." << std::endl;
+        return true;
+    } else {
+        std::cout << "Test coalescing stores into one RAM.txt flush failed." << std::endl;
+        return false;
+    }
+}
+
+bool testDumpInPlace(){
+    // After the first flush writes RAM.txt whole, a store only rewrites its own line in place
+    const size_t fileSize = (RAM::defaultSize + HexDump::bytesPerLine - 1) / HexDump::bytesPerLine * HexDump::lineLength;
+    const std::string path = tempDumpPath("scc_dump_in_place");
+    bool whole, oneLine, twoLines;
+    {
+        RAM ram(RAM::defaultSize, DumpMode::Immediate, RAMDumper::defaultInterval, path);
+        ram.writeByte(0x240, 0xAB);
+        whole = ram.getDumper()->getBytesWritten() == fileSize;
+        ram.writeByte(0x300, 0xCD);
+        oneLine = ram.getDumper()->getBytesWritten() == fileSize + HexDump::lineLength;
+
+        // Stores to two adjacent lines between sync points go out as one positioned write
+        ram.setDumpMode(DumpMode::Manual);
+        ram.dump_memory();
+        uint64_t before = ram.getDumper()->getBytesWritten();
+        for (int i = 0; i < 128; i++) {
+            ram.writeByte(0x400 + i, static_cast<uint8_t>(i));
+        }
+        ram.dump_memory();
+        twoLines = ram.getDumper()->getBytesWritten() - before == 2 * HexDump::lineLength;
+    }
+
+    std::ifstream dumpFile(path);
+    std::string line;
+    bool first = false, second = false, third = false;
+    size_t lines = 0;
+    while (std::getline(dumpFile, line)) {
+        lines++;
+        first = first || line.rfind("Address 0x0240: ab ", 0) == 0;
+        second = second || line.rfind("Address 0x0300: cd ", 0) == 0;
+        third = third || line.rfind("Address 0x0440: 40 41 ", 0) == 0;
+    }
+    bool contents = first && second && third && lines == fileSize / HexDump::lineLength &&
+                    std::filesystem::file_size(path) == fileSize;
+    dumpFile.close();
+    std::filesystem::remove(path);
+    if (whole && oneLine && twoLines && contents) {
+        std::cout << "Test patching RAM.txt lines in place passed." << std::endl;
+        return true;
+    } else {
+        std::cout << "whole = " << whole << ", oneLine = " << oneLine << ", twoLines = " << twoLines << ", contents = " << contents << std::endl;
+        std::cout << "Test patching RAM.txt lines in place failed." << std::endl;
+        return false;
+    }
+}
+
+bool testSharedImage(){
+    // Stores must show up in the shared image a viewer maps, with a new generation number
+    RAM ram(DumpMode::Disabled);
+    ram.writeByte(0x210, 0x5A);
+    std::string name = uniqueName("scc_test_ram_shared");
+    if (!ram.mapShared(name)) {
+        std::cout << "Test publishing RAM in shared memory failed." << std::endl;
+        return false;
+    }
+    ram.writeByte(0x200, 0x42);
+
+    SharedRAMImage viewer;
+    bool attached = viewer.attach(name);
+
+    // A failure is reported through errorLog(), so a redirected log sees it
+    std::ostringstream log;
+    setErrorLog(&log);
+    SharedRAMImage invalid;
+    bool refused = !invalid.create("scc/invalid", 0x100) && log.str().find("Could not create shared RAM image") != std::string::npos;
+    setErrorLog(&std::cerr);
+
+    if (attached && refused && viewer.getHeader()->size == ram.size() && viewer.getData()[0x200] == 0x42 &&
+        viewer.getData()[0x210] == 0x5A && ram.readByte(0x210) == 0x5A &&
+        viewer.getHeader()->generation.load() == 1) {
+        std::cout << "Test publishing RAM in shared memory passed." << std::endl;
+        return true;
+    } else {
+        std::cout << "Test publishing RAM in shared memory failed." << std::endl;
+        return false;
+    }
+}
+
+bool testProgramImage(){
+    // An image converted from text must load the same bytes as the text loader, and the
+    // cache must only convert again when the text changes
+    {
+        std::ofstream program("image_program.txt");
+        program << "0000 0010 0000 0010 0000 0000\n0000 0101 0000 0000 0000 0000\n";
+        std::ofstream data("image_data.txt");
+        data << "Hi there\n";
+    }
+    RAM textRam(DumpMode::Disabled), imageRam(DumpMode::Disabled), cachedRam(DumpMode::Disabled);
+    uint16_t textEnd = 0, entry = 0xFFFF, imageEnd = 0, cachedEntry = 0xFFFF, cachedEnd = 0;
+    std::string error;
+    bool loaded = ProgramLoader::loadTextProgram(textRam, "image_program.txt", textEnd, error) &&
+                  ProgramLoader::loadTextData(textRam, "image_data.txt", error) &&
+                  ProgramLoader::convertText("image_program.txt", "image_data.txt", "image_test.sccimg", error) &&
+                  ProgramLoader::loadImage(imageRam, "image_test.sccimg", entry, imageEnd, error);
+    bool same = loaded && entry == 0 && imageEnd == 6 && textEnd == 6;
+    for (uint16_t address = 0; same && address < textRam.size(); address++) {
+        same = textRam.readByte(address) == imageRam.readByte(address);
+    }
+
+    std::filesystem::remove_all("image_cache");
+    bool cached = ProgramLoader::loadCached(cachedRam, "image_program.txt", "image_data.txt", "image_cache", cachedEntry, cachedEnd, error);
+    std::filesystem::path cachedImage = std::filesystem::directory_iterator("image_cache")->path();
+    auto converted = std::filesystem::last_write_time(cachedImage);
+    cached = cached && ProgramLoader::loadCached(cachedRam, "image_program.txt", "image_data.txt", "image_cache", cachedEntry, cachedEnd, error) &&
+             std::filesystem::last_write_time(cachedImage) == converted && cachedRam.readByte(0x201) == 'i';
+    {
+        std::ofstream data("image_data.txt");
+        data << "Yo there, longer\n";
+    }
+    cached = cached && ProgramLoader::loadCached(cachedRam, "image_program.txt", "image_data.txt", "image_cache", cachedEntry, cachedEnd, error) &&
+             cachedRam.readByte(0x201) == 'o' && cachedEnd == 6;
+
+    // A file that is not an image is rejected
+    std::string rejectError;
+    bool rejected = !ProgramLoader::loadImage(cachedRam, "image_data.txt", entry, imageEnd, rejectError) && !rejectError.empty();
+
+    if (same && cached && rejected) {
+        std::cout << "Test loading binary program images passed." << std::endl;
+        return true;
+    } else {
+        std::cout << error << std::endl;
+        std::cout << "Test loading binary program images failed." << std::endl;
+        return false;
+    }
+}
+
+bool testSnapshotRestore(){
+    // Restoring copies back only the pages written since the snapshot, and
+    // snapshots taken without writes in between share every page
+    RAM ram(DumpMode::Disabled);
+    ram.writeInstructionByte(0x00, 0x02);
+    ram.writeByte(0x200, 0x11);
+    ram.writeByte(0x7FF, 0x22);
+    RAMSnapshot first = ram.snapshot();
+
+    ram.writeByte(0x205, 0x33);
+    ram.writeByte(0x206, 0x44);
+    ram.writeInstructionByte(0x00, 0x05);
+    uint64_t codeWrites = ram.getCodeWriteCount();
+    size_t copied = 0;
+    bool restored = ram.restore(first, &copied) && copied == 2 && ram.readByte(0x205) == 0 &&
+                    ram.readByte(0x206) == 0 && ram.readByte(0x200) == 0x11 && ram.readByte(0x7FF) == 0x22 &&
+                    ram.readByte(0x00) == 0x02 && ram.getCodeWriteCount() == codeWrites + 1;
+
+    // Nothing written since the restore: nothing to copy
+    bool clean = ram.restore(first, &copied) && copied == 0;
+
+    ram.writeByte(0x300, 0x55);
+    RAMSnapshot second = ram.snapshot();
+    ram.writeByte(0x300, 0x66);
+    bool switched = ram.restore(first, &copied) && copied == 1 && ram.readByte(0x300) == 0 &&
+                    ram.restore(second, &copied) && copied == 1 && ram.readByte(0x300) == 0x55;
+
+    if (restored && clean && switched) {
+        std::cout << "Test copy-on-write snapshots passed." << std::endl;
+        return true;
+    } else {
+        std::cout << "Test copy-on-write snapshots failed." << std::endl;
+        return false;
+    }
+}
+
+bool testPagedAddressSpace(){
+    // A 64 KB RAM only allocates the pages that are stored to
+    RAM ram(RAM::maxSize, DumpMode::Disabled);
+    bool lazy = ram.size() == 0x10000 && ram.getAllocatedPages() == 0 && ram.readByte(0xFFFF) == 0;
+    bool stored = ram.writeByte(0xF001, 0x42) && ram.writeByte(0xF0FF, 0x43) && ram.getAllocatedPages() == 1 &&
+                  ram.readByte(0xF001) == 0x42 && ram.readByte(0xF0FF) == 0x43;
 
+    // Untouched pages share one zero page in snapshots, and restoring them allocates nothing
+    RAMSnapshot snapshot = ram.snapshot();
+    ram.writeByte(0x8000, 0x01);
+    size_t copied = 0;
+    bool restored = ram.restore(snapshot, &copied) && copied == 1 && ram.readByte(0x8000) == 0 &&
+                    ram.readByte(0xF001) == 0x42 && ram.getAllocatedPages() == 2;
+
+    // The default size keeps the 2 KB bounds
+    RAM small(DumpMode::Disabled);
+    bool bounded = small.size() == RAM::defaultSize && small.readByte(0x0800) == 0xFF && !small.writeByte(0x0800, 1);
+
+    if (lazy && stored && restored && bounded) {
+        std::cout << "Test paged address space passed." << std::endl;
+        return true;
+    } else {
+        std::cout << "lazy = " << lazy << ", stored = " << stored << ", restored = " << restored << ", bounded = " << bounded << std::endl;
+        std::cout << "Test paged address space failed." << std::endl;
+        return false;
+    }
+}
+
+// Reads return the low address byte; writes are remembered, except at 0x6FF which refuses them
+class EchoDevice : public MemoryDevice {
+public:
+    uint16_t lastAddress = 0;
+    uint8_t lastValue = 0;
+    uint8_t read(uint16_t address) override { return static_cast<uint8_t>(address); }
+    bool write(uint16_t address, uint8_t value) override {
+        lastAddress = address;
+        lastValue = value;
+        return address != 0x6FF;
+    }
+};
+
+bool testBus(){
+    RAM ram(RAM::maxSize, DumpMode::Disabled);
+    const uint8_t rom[] = {0x10, 0x20, 0x30};
+    EchoDevice device;
+    // ROM at 0x400-0x5FF, the device at 0x600-0x6FF; regions must be whole data-region pages
+    bool mapped = ram.mapROM(0x0400, 0x0200, rom, sizeof(rom)) && ram.mapDevice(0x0600, 0x0100, &device) &&
+                  !ram.mapROM(0x0410, 0x0100, rom, sizeof(rom)) && !ram.mapDevice(0x0100, 0x0100, &device);
+    bool romOk = ram.getPageKind(0x0401) == PageKind::ROM && ram.readByte(0x0401) == 0x20 && ram.readByte(0x0403) == 0 &&
+                 !ram.writeByte(0x0401, 0x99) && ram.readByte(0x0401) == 0x20;
+    bool deviceOk = ram.getPageKind(0x06AB) == PageKind::Device && ram.readByte(0x06AB) == 0xAB &&
+                    ram.writeByte(0x0610, 0x77) && device.lastAddress == 0x0610 && device.lastValue == 0x77 &&
+                    !ram.writeByte(0x06FF, 0x01) && ram.getAllocatedPages() == 2;
+
+    // Loaders may still fill ROM, but not device pages
+    const uint8_t image[] = {0x55};
+    bool loadOk = ram.loadBytes(0x0402, image, 1) && ram.readByte(0x0402) == 0x55 && !ram.loadBytes(0x06FF, image, 1);
+
+    if (mapped && romOk && deviceOk && loadOk) {
+        std::cout << "Test ROM and device pages passed." << std::endl;
+        return true;
+    } else {
+        std::cout << "mapped = " << mapped << ", romOk = " << romOk << ", deviceOk = " << deviceOk << ", loadOk = " << loadOk << std::endl;
+        std::cout << "Test ROM and device pages failed." << std::endl;
+        return false;
+    }
+}
+
+bool testDumpFormat(){
+    // Every byte value through the vector path must match the scalar path (used for short lines)
+    // and the layout RAM.txt always had
+    uint8_t bytes[HexDump::bytesPerLine];
+    bool matches = true;
+    for (int base = 0; base < 256; base += HexDump::bytesPerLine) {
+        for (size_t i = 0; i < HexDump::bytesPerLine; i++)
+            bytes[i] = static_cast<uint8_t>(base + i);
+        char full[HexDump::lineLength];
+        char partial[HexDump::lineLength];
+        HexDump::formatLine(0x0240, bytes, HexDump::bytesPerLine, full);
+        HexDump::formatLine(0x0240, bytes, HexDump::bytesPerLine - 1, partial);
+        std::string a(full, sizeof(full));
+        std::string b(partial, sizeof(partial));
+        // The partial line only differs in the blanked last byte
+        size_t lastHex = 16 + (HexDump::bytesPerLine - 1) * 3;
+        size_t lastAscii = HexDump::lineLength - 2;
+        matches = matches && b.substr(lastHex, 3) == "   " && b[lastAscii] == ' ' &&
+                  a.substr(0, lastHex) == b.substr(0, lastHex) && a.substr(lastHex + 3, lastAscii - lastHex - 3) == b.substr(lastHex + 3, lastAscii - lastHex - 3);
+    }
+
+    RAM ram(DumpMode::Disabled);
+    ram.writeByte(0x0240, 0x41);
+    ram.writeByte(0x0241, 0x9F);
+    std::ostringstream out;
+    ram.dump_memory_at_address(0x0240, out);
+    std::string line = out.str();
+    bool layout = line.size() == HexDump::lineLength && line.rfind("Address 0x0240: 41 9f 00 ", 0) == 0 &&
+                  line.find("| A..") == 16 + HexDump::bytesPerLine * 3 && line.back() == '\n';
+
+    if (matches && layout) {
+        std::cout << "Test dump line format passed." << std::endl;
+        return true;
+    } else {
+        std::cout << "matches = " << matches << ", layout = " << layout << " (" << HexDump::implementation() << ")" << std::endl;
+        std::cout << "Test dump line format failed." << std::endl;
+        return false;
+    }
+}
 
 int main(int argc, char* argv[]) {
     int tests_passed = 0;
@@ -179,6 +503,46 @@ int main(int argc, char* argv[]) {
             tests_passed++;
         if (testValidWriteByte())
             tests_passed++;
+    }else if (argc == 2 && std::string(argv[1]) == "dump") {
+
+        total_tests = 1;
+        if (testDumpCoalescesStores())
+            tests_passed++;
+    }else if (argc == 2 && std::string(argv[1]) == "dump_in_place") {
+
+        total_tests = 1;
+        if (testDumpInPlace())
+            tests_passed++;
+    }else if (argc == 2 && std::string(argv[1]) == "shared") {
+
+        total_tests = 1;
+        if (testSharedImage())
+            tests_passed++;
+    }else if (argc == 2 && std::string(argv[1]) == "snapshot") {
+
+        total_tests = 1;
+        if (testSnapshotRestore())
+            tests_passed++;
+    }else if (argc == 2 && std::string(argv[1]) == "image") {
+
+        total_tests = 1;
+        if (testProgramImage())
+            tests_passed++;
+    }else if (argc == 2 && std::string(argv[1]) == "paged") {
+
+        total_tests = 1;
+        if (testPagedAddressSpace())
+            tests_passed++;
+    }else if (argc == 2 && std::string(argv[1]) == "bus") {
+
+        total_tests = 1;
+        if (testBus())
+            tests_passed++;
+    }else if (argc == 2 && std::string(argv[1]) == "dump_format") {
+
+        total_tests = 1;
+        if (testDumpFormat())
+            tests_passed++;
     }else {
         std::cerr << "Invalid command-line arguments. Usage: test_RAM [all|valid|invalid]" << std::endl;
         return 1;
@@ -0,0 +1,266 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "BinaryTrace.h"
+#include "CPU.h"
+
+void loadProgram(RAM &ram, const std::vector<uint8_t> &program)
+{
+    for (uint16_t i = 0; i < program.size(); i++)
+        ram.writeInstructionByte(i, program[i]);
+}
+
+std::vector<TraceRecord> readTrace(const std::string &path)
+{
+    std::vector<TraceRecord> records;
+    TraceReader reader;
+    std::string error;
+    TraceRecord record;
+    if (reader.open(path, error))
+    {
+        while (reader.next(record))
+            records.push_back(record);
+    }
+    return records;
+}
+
+bool sameRecord(const TraceRecord &a, const TraceRecord &b)
+{
+    return a.sequence == b.sequence && a.pc == b.pc && a.address == b.address && a.kind == b.kind && a.value == b.value && a.A == b.A &&
+           a.status == b.status;
+}
+
+bool testRing()
+{
+    // A writer thread draining an 8-slot ring sees every record exactly once and in order
+    TraceRing ring(5);
+    const uint64_t count = 20000;
+    bool ordered = true;
+    std::thread consumer([&]()
+    {
+        TraceRecord batch[3];
+        uint64_t expected = 0;
+        while (expected < count)
+        {
+            size_t popped = ring.pop(batch, 3);
+            if (popped == 0)
+                std::this_thread::yield();
+            for (size_t i = 0; i < popped; i++, expected++)
+                ordered = ordered && batch[i].sequence == expected && batch[i].address == static_cast<uint16_t>(expected * 7);
+        }
+    });
+    for (uint64_t sequence = 0; sequence < count; sequence++)
+    {
+        TraceRecord record{sequence, 0, static_cast<uint16_t>(sequence * 7), TraceKind::Read, 0, 0, 0};
+        while (!ring.tryPush(record))
+            std::this_thread::yield();
+    }
+    consumer.join();
+
+    // Capacity is rounded up to a power of two
+    TraceRing small(5);
+    int accepted = 0;
+    while (small.tryPush(TraceRecord{}))
+        accepted++;
+
+    if (ordered && accepted == 8)
+    {
+        std::cout << "Test trace ring passed." << std::endl;
+        return true;
+    }
+    std::cout << "ordered " << ordered << " accepted " << accepted << std::endl;
+    std::cout << "Test trace ring failed." << std::endl;
+    return false;
+}
+
+bool testEngines()
+{
+    // LDA; PSH; ADC; POP; SBC into the code region (refused); AND; EOR; PSH; JMP back to the ADC.
+    // The stack grows until PSH runs past 0x1FF and is refused too
+    const std::vector<uint8_t> program = {0x02, 0x02, 0x00, 0x06, 0x00, 0x00, 0x00, 0x02, 0x01, 0x07, 0x00, 0x00, 0x01, 0x00, 0x50,
+                                          0x03, 0x02, 0x02, 0x04, 0x02, 0x03, 0x06, 0x00, 0x00, 0x05, 0x00, 0x03};
+    const uint64_t budget = 3000;
+    const ExecutionEngine engines[] = {ExecutionEngine::Reference, ExecutionEngine::Decoded, ExecutionEngine::Threaded,
+                                       ExecutionEngine::Jit};
+    std::vector<TraceRecord> reference;
+    bool same = true;
+    bool complete = true;
+    uint64_t stalls = 0;
+    for (ExecutionEngine engine : engines)
+    {
+        RAM ram(DumpMode::Disabled);
+        loadProgram(ram, program);
+        for (uint16_t i = 0; i < 4; i++)
+            ram.writeByte(0x200 + i, static_cast<uint8_t>(0x35 + 11 * i));
+        CPU cpu;
+        cpu.engine = engine;
+        TraceWriter tracer;
+        std::string error;
+        // A small ring makes the CPU wait on the writer now and then
+        complete = complete && tracer.open("trace_engines.scctrace", error, 64);
+        cpu.tracer = &tracer;
+        uint64_t executed = cpu.run(ram, static_cast<uint16_t>(program.size()), budget);
+        cpu.tracer = nullptr;
+        complete = complete && tracer.close() && executed == budget;
+        stalls += tracer.getStalls();
+
+        std::vector<TraceRecord> records = readTrace("trace_engines.scctrace");
+        complete = complete && records.size() == tracer.getRecordCount();
+        if (engine == ExecutionEngine::Reference)
+        {
+            reference = records;
+            continue;
+        }
+        same = same && records.size() == reference.size();
+        for (size_t i = 0; same && i < records.size(); i++)
+            same = sameRecord(records[i], reference[i]);
+    }
+
+    // Per instruction: LDA/AND/EOR and POP read, PSH writes, ADC and SBC read then write
+    uint64_t instructions = 0, reads = 0, writes = 0, rejected = 0;
+    uint64_t expectedReads = 0, expectedWrites = 0;
+    for (const TraceRecord &record : reference)
+    {
+        switch (record.kind)
+        {
+        case TraceKind::Instruction:
+            instructions++;
+            expectedReads += record.value <= 0b0100 || record.value == 0b0111;
+            expectedWrites += record.value <= 0b0001 || record.value == 0b0110;
+            break;
+        case TraceKind::Read:
+            reads++;
+            break;
+        case TraceKind::Write:
+            writes++;
+            break;
+        default:
+            rejected++;
+            break;
+        }
+    }
+    bool counted = instructions == budget && reads == expectedReads && writes + rejected == expectedWrites && rejected > 0 &&
+                   reference.back().sequence == budget - 1;
+
+    if (same && complete && counted)
+    {
+        std::cout << "Test trace engines passed (" << stalls << " stalls)." << std::endl;
+        return true;
+    }
+    std::cout << "same " << same << " complete " << complete << " counted " << counted << std::endl;
+    std::cout << "Test trace engines failed." << std::endl;
+    return false;
+}
+
+bool testDecode()
+{
+    // LDA 0x200; ADC 0x201; HLT
+    RAM ram(DumpMode::Disabled);
+    loadProgram(ram, {0x02, 0x02, 0x00, 0x00, 0x02, 0x01, 0x08, 0x00, 0x00});
+    ram.writeByte(0x200, 0x11);
+    ram.writeByte(0x201, 0x22);
+    CPU cpu;
+    cpu.engine = ExecutionEngine::Reference;
+    TraceWriter tracer;
+    std::string error;
+    bool written = tracer.open("trace_decode.scctrace", error);
+    cpu.tracer = &tracer;
+    cpu.run(ram, 9, 100);
+    written = written && tracer.close();
+
+    std::ostringstream text;
+    TraceReader textReader;
+    bool decoded = textReader.open("trace_decode.scctrace", error) && writeTraceText(textReader, text) == 6;
+    bool textMatches = text.str() == "0 0x0000 LDA 0x0200 A=0 STATUS=0\n"
+                                     "    read 0x0200 = 17\n"
+                                     "1 0x0003 ADC 0x0201 A=17 STATUS=0\n"
+                                     "    read 0x0201 = 34\n"
+                                     "    write 0x0201 = 51\n"
+                                     "2 0x0006 HLT 0x0000 A=17 STATUS=0\n";
+
+    std::ostringstream chrome;
+    TraceReader chromeReader;
+    decoded = decoded && chromeReader.open("trace_decode.scctrace", error) && writeChromeTrace(chromeReader, chrome) == 6;
+    std::string json = chrome.str();
+    bool chromeMatches = json.rfind("{\"displayTimeUnit\": \"ns\", \"traceEvents\": [", 0) == 0 &&
+                         json.find("{\"name\": \"ADC\", \"ph\": \"X\", \"ts\": 1, \"dur\": 1") != std::string::npos &&
+                         json.find("{\"name\": \"write 0x0201\", \"ph\": \"i\"") != std::string::npos &&
+                         json.find("{\"name\": \"A\", \"ph\": \"C\", \"ts\": 2, \"pid\": 1, \"args\": {\"A\": 17}}") != std::string::npos &&
+                         json.size() >= 4 && json.compare(json.size() - 4, 4, "\n]}\n") == 0;
+
+    // A partial last record is reported, and a file that is not a trace is refused
+    {
+        std::ofstream append("trace_decode.scctrace", std::ios::binary | std::ios::app);
+        append.write("SCC", 3);
+    }
+    TraceReader partialReader;
+    std::ostringstream ignored;
+    bool partial = partialReader.open("trace_decode.scctrace", error) && writeTraceText(partialReader, ignored) == 6 &&
+                   partialReader.truncated();
+    {
+        std::ofstream other("trace_other.scctrace", std::ios::binary | std::ios::trunc);
+        other << "not a trace file at all";
+    }
+    TraceReader otherReader;
+    bool refused = !otherReader.open("trace_other.scctrace", error) && error.find("not a version 1 trace") != std::string::npos;
+
+    if (written && decoded && textMatches && chromeMatches && partial && refused)
+    {
+        std::cout << "Test trace decoding passed." << std::endl;
+        return true;
+    }
+    std::cout << "written " << written << " decoded " << decoded << " text " << textMatches << " chrome " << chromeMatches << " partial "
+              << partial << " refused " << refused << std::endl
+              << text.str();
+    std::cout << "Test trace decoding failed." << std::endl;
+    return false;
+}
+
+int main(int argc, char *argv[])
+{
+    int tests_passed = 0;
+    int total_tests = 0;
+    setErrorLog(nullptr); // Refused stores are expected
+
+    if (argc == 1 || (argc == 2 && std::string(argv[1]) == "all"))
+    {
+        total_tests = 3;
+        if (testRing())
+            tests_passed++;
+        if (testEngines())
+            tests_passed++;
+        if (testDecode())
+            tests_passed++;
+    }
+    else if (argc == 2 && std::string(argv[1]) == "ring")
+    {
+        total_tests = 1;
+        if (testRing())
+            tests_passed++;
+    }
+    else if (argc == 2 && std::string(argv[1]) == "engines")
+    {
+        total_tests = 1;
+        if (testEngines())
+            tests_passed++;
+    }
+    else if (argc == 2 && std::string(argv[1]) == "decode")
+    {
+        total_tests = 1;
+        if (testDecode())
+            tests_passed++;
+    }
+    else
+    {
+        std::cerr << "Invalid command-line arguments. Usage: test_Trace [all|ring|engines|decode]" << std::endl;
+        return 1;
+    }
+
+    std::cout << "Total passed tests: " << tests_passed << "/" << total_tests << std::endl;
+
+    // Return exit code based on tests passed/failed
+    return (tests_passed == total_tests) ? 0 : 1;
+}
@@ -0,0 +1,176 @@
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "CPU.h"
+#include "Translator.h"
+
+// Translate program into name.cpp, apply edit to the generated text, and compile it into ./name.so
+bool buildProgram(const std::vector<uint8_t> &program, const std::string &name, const std::string &find = "",
+                  const std::string &replace = "")
+{
+    std::vector<uint8_t> bytes(program);
+    bytes.resize(DecodeCache::programSize, 0);
+    std::ostringstream source;
+    ProgramTranslator::translate(bytes.data(), name, source);
+    std::string text = source.str();
+    if (!find.empty())
+        text.replace(text.find(find), find.size(), replace);
+    std::ofstream(name + ".cpp", std::ofstream::trunc) << text;
+
+    std::string error;
+    if (!ProgramTranslator::compile(name + ".cpp", "./" + name + ".so", error))
+    {
+        std::cout << error << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// Registers, RAM, counters and cache statistics after running program from 0
+std::vector<uint64_t> runProgram(TranslatedProgram *translated, const std::vector<uint8_t> &program,
+                                 const std::vector<uint8_t> &data, uint64_t budget)
+{
+    RAM ram(DumpMode::Disabled);
+    CPU cpu;
+    cpu.engine = ExecutionEngine::Reference;
+    for (uint16_t i = 0; i < program.size(); i++)
+        ram.writeInstructionByte(i, program[i]);
+    for (uint16_t i = 0; i < data.size(); i++)
+        ram.writeByte(0x200 + i, data[i]);
+
+    uint64_t executed = translated != nullptr ? translated->run(cpu, ram, 0x0100, budget) : cpu.run(ram, 0x0100, budget);
+    CPUCounters counters = cpu.getCounters();
+    std::vector<uint64_t> state = {executed, cpu.PC, cpu.SP, cpu.A, counters.cacheHits, counters.cacheMisses};
+    for (uint16_t i = 0; i < ram.size(); i++)
+        state.push_back(ram.readByte(i));
+    for (uint64_t count : counters.executed)
+        state.push_back(count);
+    return state;
+}
+
+std::vector<uint8_t> randomProgram(std::mt19937 &gen, int length)
+{
+    std::uniform_int_distribution<int> opcodeDistribution(0, 8);
+    std::uniform_int_distribution<int> addressDistribution(0x01F0, 0x0810);
+    std::vector<uint8_t> program;
+    for (int i = 0; i < length; i++)
+    {
+        int opcode = opcodeDistribution(gen);
+        int address = addressDistribution(gen);
+        if (opcode == 0b0101)
+            address = (static_cast<int>(gen() % length) * 3 - 3) & 0xFFFF;
+        program.push_back(static_cast<uint8_t>(opcode));
+        program.push_back(static_cast<uint8_t>(address >> 8));
+        program.push_back(static_cast<uint8_t>(address & 0xFF));
+    }
+    program.insert(program.end(), {0x05, 0xFF, 0xFD}); // Loop forever
+    return program;
+}
+
+bool testAgree()
+{
+    // Translated code calls the same CPU methods, so even cache statistics must match the interpreter
+    std::mt19937 gen(14);
+    std::uniform_int_distribution<int> byteDistribution(0x00, 0xFF);
+    for (int round = 0; round < 2; round++)
+    {
+        std::vector<uint8_t> program = randomProgram(gen, 40);
+        std::vector<uint8_t> data;
+        for (int i = 0; i < 0x600; i++)
+            data.push_back(static_cast<uint8_t>(byteDistribution(gen)));
+
+        std::string name = "translated_agree_" + std::to_string(round);
+        TranslatedProgram translated;
+        std::string error;
+        if (!buildProgram(program, name) || !translated.load("./" + name + ".so", error))
+        {
+            std::cout << error << std::endl;
+            std::cout << "Test translated program agrees failed." << std::endl;
+            return false;
+        }
+        for (uint64_t budget : {1ULL, 37ULL, 20000ULL})
+        {
+            if (runProgram(&translated, program, data, budget) != runProgram(nullptr, program, data, budget))
+            {
+                std::cout << "Round " << round << ", budget " << budget << " diverged." << std::endl;
+                std::cout << "Test translated program agrees failed." << std::endl;
+                return false;
+            }
+        }
+    }
+    std::cout << "Test translated program agrees passed." << std::endl;
+    return true;
+}
+
+bool testAbi()
+{
+    std::mt19937 gen(15);
+    std::vector<uint8_t> program = randomProgram(gen, 10);
+    std::vector<uint8_t> other = randomProgram(gen, 10);
+    std::vector<uint8_t> data(0x600, 0x11);
+
+    // A layout mismatch is refused at load time
+    TranslatedProgram translated;
+    std::string error;
+    bool mismatchRefused = buildProgram(program, "translated_abi", "sizeof(CPU)", "sizeof(CPU) + 1") &&
+                           !translated.load("./translated_abi.so", error) && !translated.isLoaded();
+    bool missingRefused = !translated.load("./translated_missing.so", error);
+
+    // RAM holding a different program runs on the interpreter instead
+    bool fallbackOk = buildProgram(program, "translated_fallback") && translated.load("./translated_fallback.so", error) &&
+                      runProgram(&translated, other, data, 500) == runProgram(nullptr, other, data, 500);
+
+    if (mismatchRefused && missingRefused && fallbackOk)
+    {
+        std::cout << "Test translated program ABI passed." << std::endl;
+        return true;
+    }
+    else
+    {
+        std::cout << "mismatchRefused = " << mismatchRefused << ", missingRefused = " << missingRefused
+                  << ", fallbackOk = " << fallbackOk << std::endl;
+        std::cout << "Test translated program ABI failed." << std::endl;
+        return false;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    int tests_passed = 0;
+    int total_tests = 0;
+    setErrorLog(nullptr); // The random programs hit every RAM error path
+
+    if (argc == 1 || (argc == 2 && std::string(argv[1]) == "all"))
+    {
+        total_tests = 2;
+        if (testAgree())
+            tests_passed++;
+        if (testAbi())
+            tests_passed++;
+    }
+    else if (argc == 2 && std::string(argv[1]) == "agree")
+    {
+        total_tests = 1;
+        if (testAgree())
+            tests_passed++;
+    }
+    else if (argc == 2 && std::string(argv[1]) == "abi")
+    {
+        total_tests = 1;
+        if (testAbi())
+            tests_passed++;
+    }
+    else
+    {
+        std::cerr << "Invalid command-line arguments. Usage: test_Translator [all|agree|abi]" << std::endl;
+        return 1;
+    }
+
+    std::cout << "Total passed tests: " << tests_passed << "/" << total_tests << std::endl;
+
+    // Return exit code based on tests passed/failed
+    return (tests_passed == total_tests) ? 0 : 1;
+}
@@ -0,0 +1,124 @@
+// BatchMain.cpp : Runs every program of a manifest on its own CPU/RAM pair
+// across a work-stealing thread pool and prints one aggregated JSON report.
+// Built with EMULATOR_TRACE_LEVEL=0, so instances never write to the console.
+
+#include "BatchRunner.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+int main(int argc, char *argv[])
+{
+    std::string manifestPath;
+    std::string reportPath;
+    unsigned threadCount = std::max(1u, std::thread::hardware_concurrency());
+    unsigned repeat = 1;
+    ExecutionEngine engine = ExecutionEngine::Threaded;
+    bool optimize = false;
+    BatchJob defaults{"", "", "", 0, BatchRunner::defaultBudget, 0, ".scc_cache"};
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "--threads" && i + 1 < argc)
+        {
+            threadCount = static_cast<unsigned>(std::max(1, std::atoi(argv[++i])));
+        }
+        else if (arg == "--budget" && i + 1 < argc)
+        {
+            defaults.budget = std::strtoull(argv[++i], nullptr, 0);
+        }
+        else if (arg == "--timeout" && i + 1 < argc)
+        {
+            defaults.timeoutMs = std::strtoull(argv[++i], nullptr, 0);
+        }
+        else if (arg == "--cache-dir" && i + 1 < argc)
+        {
+            defaults.cacheDir = argv[++i];
+        }
+        else if (arg == "--no-cache")
+        {
+            defaults.cacheDir.clear();
+        }
+        else if (arg == "--optimize")
+        {
+            optimize = true;
+        }
+        else if (arg == "--repeat" && i + 1 < argc)
+        {
+            repeat = static_cast<unsigned>(std::max(1, std::atoi(argv[++i])));
+        }
+        else if (arg == "--report" && i + 1 < argc)
+        {
+            reportPath = argv[++i];
+        }
+        else if (arg == "--engine" && i + 1 < argc && parseEngine(argv[i + 1], engine))
+        {
+            i++;
+        }
+        else if (manifestPath.empty() && arg[0] != '-')
+        {
+            manifestPath = arg;
+        }
+        else
+        {
+            manifestPath.clear();
+            break;
+        }
+    }
+    if (manifestPath.empty())
+    {
+        std::cerr << "Usage: scc_batch <manifest> [--threads N] [--budget N] [--timeout ms] [--repeat N]"
+                     " [--cache-dir dir | --no-cache] [--optimize]"
+                     " [--engine reference|decoded|threaded|jit] [--report file]" << std::endl;
+        return 1;
+    }
+
+    std::vector<BatchJob> manifest;
+    std::string error;
+    if (!BatchRunner::parseManifest(manifestPath, defaults, manifest, error))
+    {
+        std::cerr << error << std::endl;
+        return 1;
+    }
+    // --repeat replicates the manifest, for throughput measurements
+    std::vector<BatchJob> jobs;
+    for (unsigned r = 0; r < repeat; r++)
+    {
+        jobs.insert(jobs.end(), manifest.begin(), manifest.end());
+    }
+
+    BatchRunner runner(threadCount, engine, optimize);
+    auto started = std::chrono::steady_clock::now();
+    std::vector<BatchResult> results = runner.run(jobs);
+    double wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+    if (reportPath.empty())
+    {
+        BatchRunner::writeReport(std::cout, jobs, results, threadCount, wallSeconds);
+    }
+    else
+    {
+        std::ofstream report(reportPath, std::ofstream::out | std::ofstream::trunc);
+        if (!report.is_open())
+        {
+            std::cerr << "Error opening report file." << std::endl;
+            return 1;
+        }
+        BatchRunner::writeReport(report, jobs, results, threadCount, wallSeconds);
+    }
+
+    // Non-zero if any job could not be loaded
+    for (const BatchResult &result : results)
+    {
+        if (result.status == BatchStatus::LoadError)
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
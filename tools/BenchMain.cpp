@@ -0,0 +1,309 @@
+// BenchMain.cpp : Emulator throughput benchmarks. Runs representative instruction
+// mixes on every execution engine, plus raw RAM and data cache access, and prints
+// JSON. With --baseline <file> (a previous run's output) each result carries its
+// baseline and ratio, and --fail-below turns a regression into a non-zero exit.
+
+#include "CPU.h"
+#include "Snapshot.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    struct BenchResult
+    {
+        std::string name;
+        std::string unit; // Every unit is a rate: higher is better
+        double value;
+    };
+
+    enum Opcode : uint8_t
+    {
+        ADC = 0b0000,
+        SBC = 0b0001,
+        LDA = 0b0010,
+        AND = 0b0011,
+        EOR = 0b0100,
+        JMP = 0b0101,
+        PSH = 0b0110,
+        POP = 0b0111
+    };
+
+    struct Instruction
+    {
+        uint8_t opcode;
+        uint16_t address;
+    };
+
+    // Instructions that fit before the closing JMP back to 0x0000
+    constexpr int programLength = 0x100 / 3 - 1;
+
+    std::vector<Instruction> aluMix(std::mt19937 &random)
+    {
+        const uint8_t ops[] = {ADC, SBC, AND, EOR};
+        std::vector<Instruction> program;
+        for (int i = 0; i < programLength; i++)
+            program.push_back({ops[i % 4], static_cast<uint16_t>(0x200 + random() % 8)});
+        return program;
+    }
+
+    std::vector<Instruction> loadMix(std::mt19937 &random)
+    {
+        // Spread over the data region, so the data cache misses as well as hits
+        std::vector<Instruction> program;
+        for (int i = 0; i < programLength; i++)
+            program.push_back({LDA, static_cast<uint16_t>(0x200 + random() % 0x600)});
+        return program;
+    }
+
+    std::vector<Instruction> stackMix(std::mt19937 &)
+    {
+        std::vector<Instruction> program;
+        for (int i = 0; i < programLength; i++)
+            program.push_back({static_cast<uint8_t>(i % 4 < 2 ? PSH : POP), 0});
+        return program;
+    }
+
+    std::vector<Instruction> jumpMix(std::mt19937 &random)
+    {
+        // Every instruction jumps to a shuffled successor: a JMP to x resumes at x + 3
+        std::vector<int> order(programLength);
+        for (int i = 0; i < programLength; i++)
+            order[i] = i;
+        std::shuffle(order.begin() + 1, order.end(), random);
+        std::vector<Instruction> program(programLength);
+        for (int i = 0; i < programLength; i++)
+        {
+            int next = order[(i + 1) % programLength];
+            program[order[i]] = {JMP, static_cast<uint16_t>(next * 3 - 3)};
+        }
+        return program;
+    }
+
+    void loadProgram(RAM &ram, const std::vector<Instruction> &program)
+    {
+        uint16_t address = 0;
+        for (const Instruction &instruction : program)
+        {
+            ram.writeInstructionByte(address++, instruction.opcode);
+            ram.writeInstructionByte(address++, static_cast<uint8_t>(instruction.address >> 8));
+            ram.writeInstructionByte(address++, static_cast<uint8_t>(instruction.address));
+        }
+        // Loop forever: JMP to 0xFFFD resumes at 0x0000
+        ram.writeInstructionByte(address++, JMP);
+        ram.writeInstructionByte(address++, 0xFF);
+        ram.writeInstructionByte(address++, 0xFD);
+    }
+
+    // Best of three timed runs, in operations per second
+    template <typename Body>
+    double bestRate(uint64_t operations, Body body)
+    {
+        double best = 0;
+        for (int run = 0; run < 3; run++)
+        {
+            Clock::time_point started = Clock::now();
+            body();
+            double seconds = std::chrono::duration<double>(Clock::now() - started).count();
+            best = std::max(best, operations / std::max(seconds, 1e-9));
+        }
+        return best;
+    }
+
+    double benchMix(const std::vector<Instruction> &program, ExecutionEngine engine, bool fused, uint64_t instructions)
+    {
+        RAM ram(DumpMode::Disabled);
+        for (uint16_t address = 0x200; address < ram.size(); address++)
+            ram.writeByte(address, static_cast<uint8_t>(address * 7));
+        loadProgram(ram, program);
+        CPU cpu;
+        cpu.engine = engine;
+        cpu.decoded.setFusion(fused ? FusionTable::all() : FusionTable::none());
+        cpu.PC = 0;
+        cpu.run(ram, 0x100, 1000); // Warm the decode cache
+        return bestRate(instructions, [&] { cpu.run(ram, 0x100, instructions); });
+    }
+
+    // Keeps the optimizer from discarding benchmark loops
+    volatile uint64_t sink;
+
+    double benchReads(uint64_t operations)
+    {
+        RAM ram(DumpMode::Disabled);
+        return bestRate(operations, [&]
+        {
+            uint64_t sum = 0;
+            for (uint64_t i = 0; i < operations; i++)
+                sum += ram.readByte(static_cast<uint16_t>(i & 0x7FF));
+            sink = sum;
+        });
+    }
+
+    double benchWrites(uint64_t operations)
+    {
+        RAM ram(DumpMode::Disabled);
+        return bestRate(operations, [&]
+        {
+            for (uint64_t i = 0; i < operations; i++)
+                ram.writeByte(static_cast<uint16_t>(0x200 + (i % 0x600)), static_cast<uint8_t>(i));
+        });
+    }
+
+    double benchCache(uint64_t operations, bool hits)
+    {
+        DataCache cache;
+        for (uint16_t address = 0x200; address < 0x200 + DataCache::ways; address++)
+            cache.update(address, static_cast<uint8_t>(address));
+        // Hits cycle through the cached bytes; misses probe addresses that are never cached
+        const uint16_t base = hits ? 0x200 : 0x600;
+        return bestRate(operations, [&]
+        {
+            uint64_t found = 0;
+            uint8_t value;
+            for (uint64_t i = 0; i < operations; i++)
+                found += cache.lookup(static_cast<uint16_t>(base + i % DataCache::ways), value);
+            sink = found;
+        });
+    }
+
+    // Write one byte, then roll CPU and RAM back: one dirty page per restore
+    double benchRestore(uint64_t operations)
+    {
+        RAM ram(DumpMode::Disabled);
+        CPU cpu;
+        MachineSnapshot start = takeSnapshot(cpu, ram);
+        return bestRate(operations, [&]
+        {
+            for (uint64_t i = 0; i < operations; i++)
+            {
+                ram.writeByte(static_cast<uint16_t>(0x200 + (i & 0xFF)), static_cast<uint8_t>(i));
+                restoreSnapshot(cpu, ram, start);
+            }
+        });
+    }
+
+    // Reads "name" / "value" pairs from a previous report, one result per line
+    std::map<std::string, double> readBaseline(const std::string &path)
+    {
+        std::map<std::string, double> baseline;
+        std::ifstream file(path);
+        std::string line;
+        while (std::getline(file, line))
+        {
+            size_t name = line.find("\"name\": \"");
+            size_t value = line.find("\"value\": ");
+            if (name == std::string::npos || value == std::string::npos)
+                continue;
+            name += 9;
+            baseline[line.substr(name, line.find('"', name) - name)] = std::strtod(line.c_str() + value + 9, nullptr);
+        }
+        return baseline;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    uint64_t scale = 10;
+    std::string baselinePath;
+    double failBelow = 0;
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "--quick")
+        {
+            scale = 1;
+        }
+        else if (arg == "--scale" && i + 1 < argc)
+        {
+            scale = std::max<uint64_t>(1, std::strtoull(argv[++i], nullptr, 10));
+        }
+        else if (arg == "--baseline" && i + 1 < argc)
+        {
+            baselinePath = argv[++i];
+        }
+        else if (arg == "--fail-below" && i + 1 < argc)
+        {
+            failBelow = std::strtod(argv[++i], nullptr);
+        }
+        else
+        {
+            std::cerr << "Usage: bench_emulator [--quick | --scale N] [--baseline report.json] [--fail-below ratio]" << std::endl;
+            return 1;
+        }
+    }
+
+    const uint64_t instructions = 200000 * scale;
+    const uint64_t accesses = 1000000 * scale;
+    std::mt19937 random(250);
+    const struct
+    {
+        const char *name;
+        std::vector<Instruction> program;
+    } mixes[] = {{"alu", aluMix(random)}, {"load", loadMix(random)}, {"stack", stackMix(random)}, {"jump", jumpMix(random)}};
+    const struct
+    {
+        const char *name;
+        ExecutionEngine engine;
+        bool fused;
+    } engines[] = {{"reference", ExecutionEngine::Reference, true},     {"decoded", ExecutionEngine::Decoded, true},
+                   {"threaded", ExecutionEngine::Threaded, true},       {"threaded-unfused", ExecutionEngine::Threaded, false},
+                   {"jit", ExecutionEngine::Jit, true}};
+
+    std::vector<BenchResult> results;
+    for (const auto &mix : mixes)
+    {
+        for (const auto &engine : engines)
+        {
+            results.push_back({std::string("mix/") + mix.name + "/" + engine.name, "MIPS",
+                               benchMix(mix.program, engine.engine, engine.fused, instructions) / 1e6});
+        }
+    }
+    results.push_back({"ram/read_byte", "Mops/s", benchReads(accesses) / 1e6});
+    results.push_back({"ram/write_byte", "Mops/s", benchWrites(accesses) / 1e6});
+    results.push_back({"cache/lookup_hit", "Mops/s", benchCache(accesses, true) / 1e6});
+    results.push_back({"cache/lookup_miss", "Mops/s", benchCache(accesses, false) / 1e6});
+    results.push_back({"snapshot/restore_dirty_page", "Mops/s", benchRestore(accesses / 100) / 1e6});
+
+    std::map<std::string, double> baseline;
+    if (!baselinePath.empty())
+    {
+        baseline = readBaseline(baselinePath);
+        if (baseline.empty())
+        {
+            std::cerr << "Error reading baseline " << baselinePath << std::endl;
+            return 1;
+        }
+    }
+
+    bool regressed = false;
+    std::cout << "{\n";
+    std::cout << "  \"trace_level\": " << EMULATOR_TRACE_LEVEL << ",\n";
+    std::cout << "  \"cache\": {\"sets\": " << DataCache::sets << ", \"ways\": " << DataCache::ways
+              << ", \"line_size\": " << DataCache::lineSize << "},\n";
+    std::cout << "  \"results\": [\n";
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        const BenchResult &result = results[i];
+        std::cout << "    {\"name\": \"" << result.name << "\", \"unit\": \"" << result.unit << "\", \"value\": " << result.value;
+        auto previous = baseline.find(result.name);
+        if (previous != baseline.end() && previous->second > 0)
+        {
+            double ratio = result.value / previous->second;
+            regressed = regressed || (failBelow > 0 && ratio < failBelow);
+            std::cout << ", \"baseline\": " << previous->second << ", \"ratio\": " << ratio;
+        }
+        std::cout << '}' << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    std::cout << "  ]\n";
+    std::cout << "}\n";
+    return regressed ? 2 : 0;
+}
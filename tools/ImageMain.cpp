@@ -0,0 +1,41 @@
+// ImageMain.cpp : Converts a text program and its data into a binary program
+// image for SCC --image and scc_batch, or describes an existing image.
+
+#include "Loader.h"
+#include "ProgramImage.h"
+#include <iostream>
+#include <string>
+
+int main(int argc, char *argv[])
+{
+    if (argc == 3 && std::string(argv[1]) == "--info")
+    {
+        ProgramImage image;
+        std::string error;
+        if (!image.open(argv[2], error))
+        {
+            std::cerr << error << std::endl;
+            return 1;
+        }
+        const char *kinds[] = {"code", "stack", "data"};
+        std::cout << std::hex << "entry 0x" << image.getEntry() << ", end 0x" << image.getEnd() << std::endl;
+        for (const ImageSegment &segment : image.getSegments())
+        {
+            std::cout << kinds[static_cast<int>(segment.kind)] << " segment at 0x" << segment.address
+                      << ", 0x" << segment.length << " bytes" << std::endl;
+        }
+        return 0;
+    }
+    if (argc == 4)
+    {
+        std::string error;
+        if (!ProgramLoader::convertText(argv[1], argv[2], argv[3], error))
+        {
+            std::cerr << error << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+    std::cerr << "Usage: scc_image <program.txt> <data.txt> <image.sccimg> | scc_image --info <image.sccimg>" << std::endl;
+    return 1;
+}
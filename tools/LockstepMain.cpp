@@ -0,0 +1,92 @@
+// LockstepMain.cpp : Differential testing of an execution engine against the
+// reference interpreter on random programs (see headers/Lockstep.h).
+// Built with EMULATOR_TRACE_LEVEL=0, so the CPUs never write to the console.
+
+#include "Lockstep.h"
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+
+int main(int argc, char *argv[])
+{
+    LockstepOptions options;
+    options.threadCount = std::max(1u, std::thread::hardware_concurrency());
+    std::string outPrefix = "lockstep_repro";
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "--engine" && i + 1 < argc)
+        {
+            if (!parseEngine(argv[++i], options.engine))
+            {
+                std::cerr << "Error: Unknown engine " << argv[i] << " (reference, decoded, threaded or jit)." << std::endl;
+                return 2;
+            }
+        }
+        else if (arg == "--programs" && i + 1 < argc)
+        {
+            options.programs = std::strtoull(argv[++i], nullptr, 0);
+        }
+        else if (arg == "--seed" && i + 1 < argc)
+        {
+            options.seed = std::strtoull(argv[++i], nullptr, 0);
+        }
+        else if (arg == "--threads" && i + 1 < argc)
+        {
+            options.threadCount = static_cast<unsigned>(std::max(1, std::atoi(argv[++i])));
+        }
+        else if (arg == "--length" && i + 1 < argc)
+        {
+            options.maxLength = std::strtoull(argv[++i], nullptr, 0);
+        }
+        else if (arg == "--budget" && i + 1 < argc)
+        {
+            options.budget = std::strtoull(argv[++i], nullptr, 0);
+        }
+        else if (arg == "--block" && i + 1 < argc)
+        {
+            options.blockSize = std::strtoull(argv[++i], nullptr, 0);
+        }
+        else if (arg == "--out" && i + 1 < argc)
+        {
+            outPrefix = argv[++i];
+        }
+        else
+        {
+            std::cerr << "Usage: scc_lockstep [--engine jit] [--programs N] [--seed S] [--threads N] [--length N]"
+                         " [--budget N] [--block N] [--out PREFIX]" << std::endl;
+            return 2;
+        }
+    }
+
+    LockstepHarness harness(options);
+    LockstepReport report = harness.run();
+    double perMinute = report.seconds > 0 ? report.programs / report.seconds * 60 : 0;
+    std::cout << "Compared " << report.programs << " programs (" << report.instructions << " instructions) in "
+              << report.seconds << " s: " << static_cast<uint64_t>(perMinute) << " programs/minute on "
+              << options.threadCount << " threads" << std::endl;
+    if (!report.diverged)
+    {
+        return 0;
+    }
+
+    const LockstepDivergence &divergence = report.divergence;
+    std::cout << "Program " << divergence.index << " (seed " << options.seed << ") diverged: " << divergence.reason
+              << " after " << divergence.instruction << " instructions" << std::endl;
+    std::cout << "Reduced from " << divergence.original.program.size() / 3 << " to " << divergence.reduced.program.size() / 3
+              << " instructions and " << divergence.reduced.data.size() << " data bytes:" << std::endl;
+    LockstepHarness::writeProgram(std::cout, divergence.reduced);
+
+    std::string error;
+    if (!LockstepHarness::writeReproducer(outPrefix + ".sccimg", outPrefix + ".manifest", divergence.reduced, error))
+    {
+        std::cerr << error << std::endl;
+    }
+    else
+    {
+        std::cout << "Reproducer: scc_batch " << outPrefix << ".manifest --engine reference|<engine>" << std::endl;
+    }
+    return 1;
+}
@@ -0,0 +1,160 @@
+// RAMViewer.cpp : Live view of a RAM image published with SCC --shm <name>.
+// Maps the image read-only and redraws only the bytes that changed since the
+// previous frame, so watching memory costs the emulator nothing.
+
+#include "SharedRAM.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    const char hexDigits[] = "0123456789abcdef";
+
+    uint8_t loadShared(const uint8_t *data, int index)
+    {
+        return std::atomic_ref<uint8_t>(const_cast<uint8_t &>(data[index])).load(std::memory_order_relaxed);
+    }
+
+    struct ViewerOptions
+    {
+        std::string name = "scc_ram";
+        int width = 16; // Bytes per row
+        int hz = 60;    // Refresh rate
+    };
+
+    // Screen positions are 1-based; row 1 is the status line
+    int rowOf(int index, int width) { return 2 + index / width; }
+    int hexColumnOf(int index, int width) { return 9 + (index % width) * 3; }
+    int asciiColumnOf(int index, int width) { return 9 + width * 3 + 2 + (index % width); }
+
+    void moveTo(std::string &out, int row, int column)
+    {
+        out += "\x1b[" + std::to_string(row) + ";" + std::to_string(column) + "H";
+    }
+
+    void appendByte(std::string &out, uint8_t byte, int index, int width)
+    {
+        moveTo(out, rowOf(index, width), hexColumnOf(index, width));
+        out += hexDigits[byte >> 4];
+        out += hexDigits[byte & 0xF];
+        moveTo(out, rowOf(index, width), asciiColumnOf(index, width));
+        out += (byte >= 32 && byte <= 126) ? static_cast<char>(byte) : '.';
+    }
+
+    void appendStatus(std::string &out, const ViewerOptions &options, const SharedRAMHeader *header)
+    {
+        char status[128];
+        std::snprintf(status, sizeof(status), "SCC shared RAM /%s | size 0x%x | generation %llu%s",
+                      options.name.c_str(), header->size,
+                      static_cast<unsigned long long>(header->generation.load(std::memory_order_acquire)),
+                      header->attached.load(std::memory_order_acquire) ? "" : " | emulator exited");
+        moveTo(out, 1, 1);
+        out += status;
+        out += "\x1b[K";
+    }
+
+    void drawFull(const ViewerOptions &options, const SharedRAMHeader *header, const uint8_t *data, std::vector<uint8_t> &shown)
+    {
+        std::string out = "\x1b[2J";
+        appendStatus(out, options, header);
+        for (int index = 0; index < static_cast<int>(shown.size()); index++)
+        {
+            if (index % options.width == 0)
+            {
+                char label[16];
+                std::snprintf(label, sizeof(label), "0x%04x: ", index);
+                moveTo(out, rowOf(index, options.width), 1);
+                out += label;
+                moveTo(out, rowOf(index, options.width), asciiColumnOf(index, options.width) - 2);
+                out += "| ";
+            }
+            shown[index] = loadShared(data, index);
+            appendByte(out, shown[index], index, options.width);
+        }
+        std::fwrite(out.data(), 1, out.size(), stdout);
+        std::fflush(stdout);
+    }
+
+    // Redraw the bytes that differ from what is on screen. Returns false once the emulator detaches
+    bool drawChanges(const ViewerOptions &options, const SharedRAMHeader *header, const uint8_t *data, std::vector<uint8_t> &shown)
+    {
+        std::string out;
+        for (int index = 0; index < static_cast<int>(shown.size()); index++)
+        {
+            uint8_t byte = loadShared(data, index);
+            if (byte != shown[index])
+            {
+                shown[index] = byte;
+                appendByte(out, byte, index, options.width);
+            }
+        }
+        appendStatus(out, options, header);
+        moveTo(out, rowOf(static_cast<int>(shown.size()) - 1, options.width) + 1, 1);
+        std::fwrite(out.data(), 1, out.size(), stdout);
+        std::fflush(stdout);
+        return header->attached.load(std::memory_order_acquire) != 0;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    ViewerOptions options;
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "--width" && i + 1 < argc)
+        {
+            options.width = std::max(1, std::atoi(argv[++i]));
+        }
+        else if (arg == "--hz" && i + 1 < argc)
+        {
+            options.hz = std::max(1, std::atoi(argv[++i]));
+        }
+        else if (!arg.empty() && arg[0] != '-')
+        {
+            options.name = arg;
+        }
+        else
+        {
+            std::cerr << "Usage: scc_view [name] [--width bytes] [--hz rate]" << std::endl;
+            return 1;
+        }
+    }
+
+    const std::chrono::microseconds framePeriod(1000000 / options.hz);
+    SharedRAMImage image;
+    while (true)
+    {
+        // Wait for the emulator to publish the image
+        if (!image.attach(options.name))
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(200));
+            continue;
+        }
+
+        const SharedRAMHeader *header = image.getHeader();
+        std::vector<uint8_t> shown(header->size);
+        drawFull(options, header, image.getData(), shown);
+
+        uint64_t drawnGeneration = header->generation.load(std::memory_order_acquire);
+        bool attached = true;
+        while (attached)
+        {
+            std::this_thread::sleep_for(framePeriod);
+            uint64_t generation = header->generation.load(std::memory_order_acquire);
+            attached = header->attached.load(std::memory_order_acquire) != 0;
+            if (generation != drawnGeneration || !attached)
+            {
+                drawnGeneration = generation;
+                attached = drawChanges(options, header, image.getData(), shown);
+            }
+        }
+        image.close();
+    }
+}
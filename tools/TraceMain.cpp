@@ -0,0 +1,74 @@
+// TraceMain.cpp : Decodes a binary execution trace written by SCC --trace into
+// text, or into Chrome/Perfetto trace event JSON for a timeline viewer.
+
+#include "BinaryTrace.h"
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+int main(int argc, char *argv[])
+{
+    std::string tracePath;
+    std::string format = "text";
+    std::string outPath;
+    uint64_t limit = UINT64_MAX;
+    bool valid = true;
+    for (int i = 1; i < argc && valid; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "--format" && i + 1 < argc)
+        {
+            format = argv[++i];
+            valid = format == "text" || format == "chrome";
+        }
+        else if (arg == "--out" && i + 1 < argc)
+        {
+            outPath = argv[++i];
+        }
+        else if (arg == "--limit" && i + 1 < argc)
+        {
+            limit = std::strtoull(argv[++i], nullptr, 0);
+        }
+        else if (tracePath.empty() && arg.rfind("--", 0) != 0)
+        {
+            tracePath = arg;
+        }
+        else
+        {
+            valid = false;
+        }
+    }
+    if (!valid || tracePath.empty())
+    {
+        std::cerr << "Usage: scc_trace <trace.scctrace> [--format text|chrome] [--out file] [--limit records]" << std::endl;
+        return 1;
+    }
+
+    TraceReader reader;
+    std::string error;
+    if (!reader.open(tracePath, error))
+    {
+        std::cerr << error << std::endl;
+        return 1;
+    }
+    std::ofstream outFile;
+    if (!outPath.empty())
+    {
+        outFile.open(outPath, std::ofstream::out | std::ofstream::trunc);
+        if (!outFile.is_open())
+        {
+            std::cerr << "Error: cannot write " << outPath << std::endl;
+            return 1;
+        }
+    }
+    std::ostream &out = outPath.empty() ? std::cout : outFile;
+
+    uint64_t records = format == "chrome" ? writeChromeTrace(reader, out, limit) : writeTraceText(reader, out, limit);
+    out.flush();
+    if (reader.truncated())
+    {
+        std::cerr << "Warning: " << tracePath << " ends inside a record after " << records << " records" << std::endl;
+    }
+    return out ? 0 : 1;
+}
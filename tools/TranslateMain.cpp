@@ -0,0 +1,55 @@
+// TranslateMain.cpp : Translates a program's instruction space into C++ for
+// SCC --native, optionally compiling it into a shared object.
+
+#include "DecodeCache.h"
+#include "Loader.h"
+#include "Translator.h"
+#include <fstream>
+#include <iostream>
+#include <string>
+
+int main(int argc, char *argv[])
+{
+    if (argc != 3 && !(argc == 5 && std::string(argv[3]) == "--compile"))
+    {
+        std::cerr << "Usage: scc_translate <instructions.txt|image.sccimg> <output.cpp> [--compile <output.so>]" << std::endl;
+        return 1;
+    }
+    std::string programPath = argv[1];
+    std::string sourcePath = argv[2];
+
+    // Load the program the same way SCC would and translate what ends up in instruction space
+    RAM ram(DumpMode::Disabled);
+    std::string error;
+    uint16_t entry = 0;
+    uint16_t end_address = 0;
+    bool isImage = programPath.size() >= 7 && programPath.compare(programPath.size() - 7, 7, ".sccimg") == 0;
+    bool loaded = isImage ? ProgramLoader::loadImage(ram, programPath, entry, end_address, error)
+                          : ProgramLoader::loadTextProgram(ram, programPath, end_address, error);
+    if (!loaded)
+    {
+        std::cerr << error << std::endl;
+        return 1;
+    }
+    uint8_t program[DecodeCache::programSize];
+    for (uint16_t i = 0; i < DecodeCache::programSize; i++)
+    {
+        program[i] = ram.readByte(i);
+    }
+
+    std::ofstream out(sourcePath, std::ofstream::out | std::ofstream::trunc);
+    if (!out.is_open())
+    {
+        std::cerr << "Error: Cannot write " << sourcePath << std::endl;
+        return 1;
+    }
+    ProgramTranslator::translate(program, programPath, out);
+    out.close();
+
+    if (argc == 5 && !ProgramTranslator::compile(sourcePath, argv[4], error))
+    {
+        std::cerr << error << std::endl;
+        return 1;
+    }
+    return 0;
+}
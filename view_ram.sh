@@ -1,7 +1,13 @@
 #!/bin/bash
+# ./view_ram.sh          Poll RAM.txt every 2 seconds
+# ./view_ram.sh <name>   Live view of the RAM image published with SCC --shm <name>
+
+if [ $# -gt 0 ]; then
+    exec "${SCC_VIEW:-./build/scc_view}" "$@"
+fi
 
 while true; do
     clear
 	cat RAM.txt
 	sleep 2
-done
\ No newline at end of file
+done